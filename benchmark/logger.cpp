@@ -3,14 +3,20 @@
 
 #include <benchmark/benchmark.h>
 
+#include <atomic>
 #include <cerrno>
 #include <cstddef>
 #include <cstdio>
 #include <cstdlib>
 #include <ctime>
+#include <filesystem>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
 
 #include <pthread.h>
 #if __has_include(<pthread_np.h>)
@@ -65,6 +71,8 @@ namespace
     std::string str_arg32{"12345678901234567890123456789012"};
     std::string str_arg64{
         "1234567890123456789012345678901234567890123456789012345678901234"};
+    std::string str_arg256(256, 'x');
+    const char* c_str_arg256{str_arg256.c_str()};
     int int_arg = 42;
     long long_arg = 42L;
     double double_arg = 42.0;
@@ -112,36 +120,39 @@ struct fmt::formatter<variable_length_struct>
 
 // The logger has a fixed size ring buffer, msgsize is to ensure that
 // the test isn't bottlenecked on I/O to the log file.
-#define LOG_BENCH(NAME, X, MSGSIZE)                                       \
-    void NAME(benchmark::State& state)                                    \
-    {                                                                     \
-        FILE* fp = ::fopen("/dev/null", "w");                             \
-        xtr::logger log{fp};                                              \
-                                                                          \
-        if (const int cpu = getenv_int("PRODUCER_CPU"); cpu != -1)        \
-            set_thread_attrs(::pthread_self(), cpu);                      \
-                                                                          \
-        if (const int cpu = getenv_int("CONSUMER_CPU"); cpu != -1)        \
-            set_thread_attrs(log.consumer_thread_native_handle(), cpu);   \
-                                                                          \
-        xtr::sink p = log.get_sink("Name");                               \
-        std::size_t n = 0;                                                \
-        constexpr std::size_t sync_every = XTR_SINK_CAPACITY / (MSGSIZE); \
-        for (auto _ : state)                                              \
-        {                                                                 \
-            X;                                                            \
-            if (++n % sync_every == 0)                                    \
-            {                                                             \
-                state.PauseTiming();                                      \
-                p.sync();                                                 \
-                state.ResumeTiming();                                     \
-            }                                                             \
-        }                                                                 \
-                                                                          \
-        ::fclose(fp);                                                     \
-    }                                                                     \
+#define LOG_BENCH_SINK(NAME, X, MSGSIZE, CAPACITY, FLAGS)                \
+    void NAME(benchmark::State& state)                                  \
+    {                                                                   \
+        FILE* fp = ::fopen("/dev/null", "w");                           \
+        xtr::logger log{fp};                                            \
+                                                                        \
+        if (const int cpu = getenv_int("PRODUCER_CPU"); cpu != -1)      \
+            set_thread_attrs(::pthread_self(), cpu);                    \
+                                                                        \
+        if (const int cpu = getenv_int("CONSUMER_CPU"); cpu != -1)      \
+            set_thread_attrs(log.consumer_thread_native_handle(), cpu); \
+                                                                        \
+        xtr::sink p = log.get_sink("Name", CAPACITY, FLAGS);            \
+        std::size_t n = 0;                                              \
+        const std::size_t sync_every = p.capacity() / (MSGSIZE);        \
+        for (auto _ : state)                                            \
+        {                                                               \
+            X;                                                          \
+            if (++n % sync_every == 0)                                  \
+            {                                                           \
+                state.PauseTiming();                                    \
+                p.sync();                                               \
+                state.ResumeTiming();                                   \
+            }                                                           \
+        }                                                               \
+                                                                        \
+        ::fclose(fp);                                                   \
+    }                                                                   \
     BENCHMARK(NAME);
 
+#define LOG_BENCH(NAME, X, MSGSIZE) \
+    LOG_BENCH_SINK(NAME, X, MSGSIZE, XTR_SINK_CAPACITY, xtr::sink_flags_t::none)
+
 LOG_BENCH(logger_benchmark, XTR_LOG(p, "Test"), 8)
 LOG_BENCH(
     logger_benchmark_int,
@@ -171,6 +182,10 @@ LOG_BENCH(
     logger_benchmark_c_str_64,
     (benchmark::DoNotOptimize(c_str_arg64), XTR_LOG(p, "Test {}", c_str_arg64)),
     88)
+LOG_BENCH(
+    logger_benchmark_c_str_256,
+    (benchmark::DoNotOptimize(c_str_arg256), XTR_LOG(p, "Test {}", c_str_arg256)),
+    280)
 LOG_BENCH(
     logger_benchmark_str_view_8,
     (benchmark::DoNotOptimize(sv_arg8), XTR_LOG(p, "Test {}", sv_arg8)),
@@ -203,6 +218,22 @@ LOG_BENCH(
     logger_benchmark_str_64,
     (benchmark::DoNotOptimize(str_arg64), XTR_LOG(p, "Test {}", str_arg64)),
     88)
+LOG_BENCH(
+    logger_benchmark_sso_8,
+    (benchmark::DoNotOptimize(str_arg8), XTR_LOG(p, "Test {}", xtr::sso<8>(str_arg8))),
+    24)
+LOG_BENCH(
+    logger_benchmark_sso_16,
+    (benchmark::DoNotOptimize(str_arg16), XTR_LOG(p, "Test {}", xtr::sso<16>(str_arg16))),
+    32)
+LOG_BENCH(
+    logger_benchmark_sso_32,
+    (benchmark::DoNotOptimize(str_arg32), XTR_LOG(p, "Test {}", xtr::sso<32>(str_arg32))),
+    48)
+LOG_BENCH(
+    logger_benchmark_sso_64,
+    (benchmark::DoNotOptimize(str_arg64), XTR_LOG(p, "Test {}", xtr::sso<64>(str_arg64))),
+    80)
 LOG_BENCH(
     logger_benchmark_vcopy_64,
     (benchmark::DoNotOptimize(vcopy_arg64),
@@ -302,3 +333,163 @@ LOG_BENCH(
     296)
 LOG_BENCH(logger_benchmark_clock_realtime_coarse, XTR_LOG_RTC(p, "Test"), 24)
 LOG_BENCH(logger_benchmark_non_blocking, XTR_TRY_LOG(p, "Test"), 8)
+
+// Large sinks, where TLB misses may be significant as the producer and
+// consumer traverse the queue
+LOG_BENCH_SINK(
+    logger_benchmark_16m,
+    (benchmark::DoNotOptimize(int_arg), XTR_LOG(p, "Test {}", int_arg)),
+    16,
+    16UL << 20,
+    xtr::sink_flags_t::none)
+LOG_BENCH_SINK(
+    logger_benchmark_16m_huge_pages,
+    (benchmark::DoNotOptimize(int_arg), XTR_LOG(p, "Test {}", int_arg)),
+    16,
+    16UL << 20,
+    xtr::sink_flags_t::huge_pages)
+LOG_BENCH_SINK(
+    logger_benchmark_16m_huge_pages_locked,
+    (benchmark::DoNotOptimize(int_arg), XTR_LOG(p, "Test {}", int_arg)),
+    16,
+    16UL << 20,
+    xtr::sink_flags_t::huge_pages | xtr::sink_flags_t::lock_memory)
+
+// A busy sink alongside many idle sinks, where the consumer may spend most of
+// its time checking the idle sinks for data instead of reading the busy sink.
+void logger_benchmark_idle_sinks(benchmark::State& state)
+{
+    FILE* fp = ::fopen("/dev/null", "w");
+    xtr::logger log{fp};
+
+    if (const int cpu = getenv_int("PRODUCER_CPU"); cpu != -1)
+        set_thread_attrs(::pthread_self(), cpu);
+
+    if (const int cpu = getenv_int("CONSUMER_CPU"); cpu != -1)
+        set_thread_attrs(log.consumer_thread_native_handle(), cpu);
+
+    std::vector<std::unique_ptr<xtr::sink>> idle;
+    for (std::int64_t i = 0; i != state.range(0); ++i)
+        idle.emplace_back(new xtr::sink(log.get_sink("Idle" + std::to_string(i), 4096)));
+
+    xtr::sink p = log.get_sink("Name");
+    p.sync();
+    std::size_t n = 0;
+    const std::size_t sync_every = p.capacity() / 16;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(int_arg);
+        XTR_LOG(p, "Test {}", int_arg);
+        if (++n % sync_every == 0)
+        {
+            state.PauseTiming();
+            p.sync();
+            state.ResumeTiming();
+        }
+    }
+
+    ::fclose(fp);
+}
+BENCHMARK(logger_benchmark_idle_sinks)->Arg(0)->Arg(10000);
+
+// One sink per producer thread, where the producers may contend with each
+// other and with the consumer for cache lines shared between sinks. Only the
+// benchmark thread is timed, the other producers log until it finishes.
+void logger_benchmark_producers(benchmark::State& state)
+{
+    FILE* fp = ::fopen("/dev/null", "w");
+    xtr::logger log{fp};
+
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> producers;
+    for (std::int64_t i = 1; i < state.range(0); ++i)
+    {
+        producers.emplace_back(
+            [&, s = log.get_sink("Producer" + std::to_string(i))]() mutable
+            {
+                while (!stop.load(std::memory_order_relaxed))
+                    XTR_LOG(s, "Test {}", int_arg);
+            });
+    }
+
+    xtr::sink p = log.get_sink("Name");
+    p.sync();
+    std::size_t n = 0;
+    const std::size_t sync_every = p.capacity() / 16;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(int_arg);
+        XTR_LOG(p, "Test {}", int_arg);
+        if (++n % sync_every == 0)
+        {
+            state.PauseTiming();
+            p.sync();
+            state.ResumeTiming();
+        }
+    }
+
+    stop = true;
+    for (auto& t : producers)
+        t.join();
+
+    ::fclose(fp);
+}
+BENCHMARK(logger_benchmark_producers)->Arg(1)->Arg(2)->Arg(4)->Arg(8);
+
+namespace
+{
+    unsigned cpu_numa_node(int cpu)
+    {
+        const std::filesystem::path dir{
+            "/sys/devices/system/cpu/cpu" + std::to_string(cpu)};
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::directory_iterator(dir, ec))
+        {
+            const std::string name = entry.path().filename().string();
+            if (name.starts_with("node"))
+                return unsigned(std::strtoul(name.c_str() + 4, nullptr, 10));
+        }
+        return 0;
+    }
+}
+
+// Sink placement relative to the producer and consumer. Arg 0 uses the default
+// placement, 1 places the sink on the producer's node and 2 on the consumer's
+// node. Run with PRODUCER_CPU and CONSUMER_CPU set to CPUs on different nodes.
+void logger_benchmark_numa(benchmark::State& state)
+{
+    FILE* fp = ::fopen("/dev/null", "w");
+    xtr::logger log{fp};
+
+    if (const int cpu = getenv_int("PRODUCER_CPU"); cpu != -1)
+        set_thread_attrs(::pthread_self(), cpu);
+
+    const int consumer_cpu = getenv_int("CONSUMER_CPU");
+    if (consumer_cpu != -1)
+        log.set_consumer_affinity({consumer_cpu});
+
+    xtr::sink_flags_t flags = xtr::sink_flags_t::none;
+    if (state.range(0) == 1)
+        flags = xtr::sink_flags_t::numa_local;
+    else if (state.range(0) == 2)
+        flags = xtr::numa_node(cpu_numa_node(consumer_cpu == -1 ? 0 : consumer_cpu));
+
+    xtr::sink p = log.get_sink("Name", 1UL << 20, flags);
+    p.sync();
+    std::size_t n = 0;
+    const std::size_t sync_every = p.capacity() / 16;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(int_arg);
+        XTR_LOG(p, "Test {}", int_arg);
+        if (++n % sync_every == 0)
+        {
+            state.PauseTiming();
+            p.sync();
+            state.ResumeTiming();
+        }
+    }
+
+    ::fclose(fp);
+}
+BENCHMARK(logger_benchmark_numa)->Arg(0)->Arg(1)->Arg(2);
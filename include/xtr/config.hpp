@@ -47,4 +47,29 @@
 #define XTR_IO_URING_POLL 0
 #endif
 
+/**
+ * Set to an unqualified log level name, for example simply "info" or "error",
+ * to remove log statements made via the log level macros (@ref XTR_LOGL,
+ * @ref XTR_LOGL_TSC etc) with lower importance than the given level at compile
+ * time. Removed statements have no run-time cost, the sink's log level is not
+ * read and the arguments to the statement are not evaluated. Defaults to
+ * "debug", which removes nothing. May be overridden for part of a program
+ * by defining @ref XTR_MODULE_LEVEL.
+ */
+#if !defined(XTR_MIN_LEVEL)
+#define XTR_MIN_LEVEL debug
+#endif
+
+/**
+ * Per-module override of @ref XTR_MIN_LEVEL, may be set to an unqualified log
+ * level name either higher or lower than @ref XTR_MIN_LEVEL. The setting is
+ * read wherever a log macro is expanded, so it may be defined for a single
+ * translation unit (or a group of them, via compiler flags) or for part of a
+ * translation unit by undefining and redefining it. Defaults to @ref
+ * XTR_MIN_LEVEL.
+ */
+#if !defined(XTR_MODULE_LEVEL)
+#define XTR_MODULE_LEVEL XTR_MIN_LEVEL
+#endif
+
 #endif
@@ -29,6 +29,8 @@
 
 namespace xtr::detail
 {
+    inline constexpr std::size_t cacheline_size = 64;
+
     // value is unchanged if it is already aligned
     template<typename T>
     constexpr T align(T value, T alignment) noexcept
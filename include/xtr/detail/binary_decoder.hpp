@@ -0,0 +1,38 @@
+// Copyright 2026 Chris E. Holloway
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef XTR_DETAIL_BINARY_DECODER_HPP
+#define XTR_DETAIL_BINARY_DECODER_HPP
+
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace xtr::detail::binary
+{
+    // Decodes the binary log read from fp (see binary_format.hpp), passing
+    // the text of each record to write as it is decoded. Returns an empty
+    // string on success, otherwise a description of the first error found,
+    // at which point decoding stops. Used by xtrdecode.
+    std::string decode(std::FILE* fp, const std::function<void(std::string_view)>& write);
+}
+
+#endif
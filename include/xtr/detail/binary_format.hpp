@@ -0,0 +1,362 @@
+// Copyright 2026 Chris E. Holloway
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef XTR_DETAIL_BINARY_FORMAT_HPP
+#define XTR_DETAIL_BINARY_FORMAT_HPP
+
+#include "string_ref.hpp"
+#include "tsc.hpp"
+#include "xtr/log_level.hpp"
+#include "xtr/sso.hpp"
+#include "xtr/timespec.hpp"
+
+#include <fmt/format.h>
+
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+// Binary log format, written if option_flags_t::binary_format is passed to
+// the logger and read by xtrdecode. Integers are written in host byte order.
+// The log is a sequence of records, each beginning with a record_type byte:
+//
+//   header: 'X' 'T' 'R' version(u8)            resets all tables below
+//   style:  6 x string                         level styles, none..debug
+//   site:   id(u32) string                     format string of a log site
+//   name:   id(u32) string                     sink name
+//   text:   string                             pre-formatted log line
+//   event:  site(u32) name(u32) level(u8) sec(i64) nsec(i64) nargs(u8) args
+//
+// A string is a u32 length followed by that many bytes. Each event argument
+// is an arg_type byte followed by the value. Events are written for log
+// statements whose arguments are all of types understood by arg_encoder,
+// anything else is formatted by the logger and written as a text record.
+
+namespace xtr::detail::binary
+{
+    inline constexpr char magic[] = {'X', 'T', 'R'};
+    inline constexpr std::uint8_t version = 1;
+    inline constexpr std::size_t n_levels = 6;
+
+    enum class record_type : std::uint8_t
+    {
+        style = 1,
+        site,
+        name,
+        text,
+        event,
+        header = 0x7F
+    };
+
+    enum class arg_type : std::uint8_t
+    {
+        i64 = 1,
+        u64,
+        boolean,
+        character,
+        f32,
+        f64,
+        pointer,
+        timespec,
+        string,
+        sanitized_string
+    };
+
+    class writer;
+
+    std::uint32_t next_site_id() noexcept;
+
+    // Site ids are process wide, each distinct format string type (i.e. each
+    // log statement) is assigned an id the first time it is written.
+    template<typename Format>
+    std::uint32_t site_id() noexcept
+    {
+        static const std::uint32_t id = next_site_id();
+        return id;
+    }
+
+    template<typename T>
+    void put(std::string& out, T value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    inline void put_string(std::string& out, std::string_view str)
+    {
+        put(out, std::uint32_t(str.size()));
+        out.append(str);
+    }
+
+    inline void put_timespec(std::string& out, const std::timespec& ts)
+    {
+        put(out, std::int64_t(ts.tv_sec));
+        put(out, std::int64_t(ts.tv_nsec));
+    }
+
+    template<typename T>
+    struct arg_encoder;
+
+    template<typename T>
+        requires std::signed_integral<T> && (!std::same_as<T, char>) &&
+                 (sizeof(T) <= sizeof(std::int64_t))
+    struct arg_encoder<T>
+    {
+        static void encode(std::string& out, T value)
+        {
+            put(out, arg_type::i64);
+            put(out, std::int64_t(value));
+        }
+    };
+
+    template<typename T>
+        requires std::unsigned_integral<T> && (!std::same_as<T, char>) &&
+                 (!std::same_as<T, bool>) && (sizeof(T) <= sizeof(std::uint64_t))
+    struct arg_encoder<T>
+    {
+        static void encode(std::string& out, T value)
+        {
+            put(out, arg_type::u64);
+            put(out, std::uint64_t(value));
+        }
+    };
+
+    template<>
+    struct arg_encoder<bool>
+    {
+        static void encode(std::string& out, bool value)
+        {
+            put(out, arg_type::boolean);
+            put(out, std::uint8_t(value));
+        }
+    };
+
+    template<>
+    struct arg_encoder<char>
+    {
+        static void encode(std::string& out, char value)
+        {
+            put(out, arg_type::character);
+            put(out, value);
+        }
+    };
+
+    template<>
+    struct arg_encoder<float>
+    {
+        static void encode(std::string& out, float value)
+        {
+            put(out, arg_type::f32);
+            put(out, value);
+        }
+    };
+
+    template<>
+    struct arg_encoder<double>
+    {
+        static void encode(std::string& out, double value)
+        {
+            put(out, arg_type::f64);
+            put(out, value);
+        }
+    };
+
+    template<typename T>
+        requires std::same_as<T, void*> || std::same_as<T, const void*>
+    struct arg_encoder<T>
+    {
+        static void encode(std::string& out, const void* value)
+        {
+            put(out, arg_type::pointer);
+            put(out, std::uint64_t(reinterpret_cast<std::uintptr_t>(value)));
+        }
+    };
+
+    template<>
+    struct arg_encoder<xtr::timespec>
+    {
+        static void encode(std::string& out, const xtr::timespec& value)
+        {
+            put(out, arg_type::timespec);
+            put_timespec(out, value);
+        }
+    };
+
+    template<>
+    struct arg_encoder<tsc>
+    {
+        static void encode(std::string& out, tsc value)
+        {
+            put(out, arg_type::timespec);
+            put_timespec(out, tsc::to_timespec(value));
+        }
+    };
+
+    template<>
+    struct arg_encoder<std::string>
+    {
+        static void encode(std::string& out, const std::string& value)
+        {
+            put(out, arg_type::string);
+            put_string(out, value);
+        }
+    };
+
+    template<>
+    struct arg_encoder<string_ref<std::string_view>>
+    {
+        static void encode(std::string& out, string_ref<std::string_view> value)
+        {
+            put(out, arg_type::sanitized_string);
+            put_string(out, value.str);
+        }
+    };
+
+    template<std::size_t N>
+    struct arg_encoder<sso<N>>
+    {
+        static void encode(std::string& out, const sso<N>& value)
+        {
+            put(out, arg_type::sanitized_string);
+            put_string(out, value.str());
+        }
+    };
+
+    template<>
+    struct arg_encoder<string_ref<const char*>>
+    {
+        static void encode(std::string& out, string_ref<const char*> value)
+        {
+            put(out, arg_type::sanitized_string);
+            put_string(out, value.str);
+        }
+    };
+
+    template<typename T>
+    concept encodable = requires(std::string& out, const T& value) {
+        arg_encoder<std::remove_cvref_t<T>>::encode(out, value);
+    };
+
+    // Log statements without an explicit timestamp are passed the consumer's
+    // pre-formatted timestamp string, the writer's copy of the clock reading
+    // that string was produced from is written instead.
+    inline std::timespec to_timespec(const char*, const std::timespec& now)
+    {
+        return now;
+    }
+
+    inline std::timespec to_timespec(const xtr::timespec& ts, const std::timespec&)
+    {
+        return ts;
+    }
+
+    inline std::timespec to_timespec(tsc ts, const std::timespec&)
+    {
+        return tsc::to_timespec(ts);
+    }
+
+    template<typename T>
+    concept encodable_timestamp =
+        requires(const T& ts, const std::timespec& now) { to_timespec(ts, now); };
+}
+
+class xtr::detail::binary::writer
+{
+public:
+    template<typename Format, typename Timestamp, typename... Args>
+    void write(
+        std::string& out,
+        log_level_style_t lstyle,
+        const Format& fmt,
+        log_level_t level,
+        const Timestamp& ts,
+        const std::string& name,
+        const Args&... args);
+
+    // Forgets all sites, names and styles written so far and causes a header
+    // to be written before the next record, called when the log is reopened.
+    void reset() noexcept;
+
+    // Time of the consumer's most recent clock reading
+    std::timespec now{};
+
+private:
+    void begin_record(std::string& out, log_level_style_t lstyle);
+    void define_site(std::string& out, std::uint32_t id, fmt::string_view fmt);
+    std::uint32_t name_id(std::string& out, const std::string& name);
+
+    bool header_written_ = false;
+    log_level_style_t lstyle_ = nullptr;
+    std::vector<bool> sites_;
+    std::unordered_map<std::string, std::uint32_t> names_;
+    std::string last_name_;
+    std::uint32_t last_name_id_ = 0;
+};
+
+template<typename Format, typename Timestamp, typename... Args>
+void xtr::detail::binary::writer::write(
+    std::string& out,
+    log_level_style_t lstyle,
+    const Format& fmt,
+    log_level_t level,
+    const Timestamp& ts,
+    const std::string& name,
+    const Args&... args)
+{
+    begin_record(out, lstyle);
+
+    // Compiled format strings are empty classes with a distinct type per log
+    // statement, which is what allows them to be assigned a site id.
+    if constexpr (
+        std::is_empty_v<Format> && encodable_timestamp<Timestamp> &&
+        (encodable<Args> && ...) && sizeof...(Args) <= UINT8_MAX)
+    {
+        const std::uint32_t site = site_id<Format>();
+        define_site(out, site, fmt::string_view(fmt));
+        const std::uint32_t nid = name_id(out, name);
+        put(out, record_type::event);
+        put(out, site);
+        put(out, nid);
+        put(out, std::uint8_t(level));
+        put_timespec(out, to_timespec(ts, now));
+        put(out, std::uint8_t(sizeof...(Args)));
+        (arg_encoder<std::remove_cvref_t<Args>>::encode(out, args), ...);
+    }
+    else
+    {
+        put(out, record_type::text);
+        const std::size_t len_pos = out.size();
+        put(out, std::uint32_t(0));
+        fmt::format_to(std::back_inserter(out), fmt, lstyle(level), ts, name, args...);
+        const auto len =
+            std::uint32_t(out.size() - len_pos - sizeof(std::uint32_t));
+        std::memcpy(&out[len_pos], &len, sizeof(len));
+    }
+}
+
+#endif
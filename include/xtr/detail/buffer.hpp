@@ -27,13 +27,24 @@
 #include <fmt/core.h>
 
 #include <algorithm>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
 #include <cstring>
 #include <iterator>
+#include <memory>
+#include <string_view>
 
 namespace xtr::detail
 {
     class buffer;
+    class latency_histogram;
+    class reorder_buffer;
+
+    namespace binary
+    {
+        class writer;
+    }
 }
 
 class xtr::detail::buffer
@@ -41,7 +52,10 @@ class xtr::detail::buffer
 public:
     using value_type = char;
 
-    explicit buffer(storage_interface_ptr storage, log_level_style_t ls);
+    explicit buffer(
+        storage_interface_ptr storage,
+        log_level_style_t ls,
+        bool binary_format = false);
 
     buffer(buffer&&) = default;
 
@@ -59,11 +73,38 @@ public:
 
     void append_line();
 
+    void append(std::string_view s);
+
+    // Enables ordering of records by timestamp if window is non-zero, or
+    // disables it otherwise, see reorder_buffer.
+    void set_reorder_window(std::chrono::nanoseconds window);
+
+    // Number of bytes written to this buffer, including bytes not yet
+    // submitted to storage.
+    std::size_t n_bytes_written() const noexcept
+    {
+        return n_bytes_submitted + std::size_t(pos_ - begin_);
+    }
+
     std::string line;
     log_level_style_t lstyle;
+    // Bytes submitted to storage and TSC ticks spent submitting and flushing,
+    // see consumer::run_once.
+    std::size_t n_bytes_submitted = 0;
+    std::uint64_t io_ticks = 0;
+    // Non-null if log records are written in binary format (see
+    // binary_format.hpp) rather than being formatted as text.
+    std::unique_ptr<binary::writer> binary;
+    // Non-null if records are written in timestamp order rather than in the
+    // order that they are read in.
+    std::unique_ptr<reorder_buffer> reorder;
+    // Histogram of the sink whose records are being read, or null if the sink
+    // does not measure latency, see trampoline_enqueue_time.
+    latency_histogram* latency = nullptr;
 
 private:
     void next_buffer();
+    void submit_buffer();
 
     storage_interface_ptr storage_;
     char* pos_ = nullptr;
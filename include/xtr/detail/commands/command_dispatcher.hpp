@@ -55,16 +55,20 @@ private:
 
     struct buffer
     {
-        buffer(const void* srcbuf, std::size_t srcsize);
+        buffer(const void* srcbuf, std::size_t srcsize, int srcfd);
 
         std::unique_ptr<char[]> buf;
         std::size_t size;
+        // Passed to the client along with buf if open, see command_send
+        detail::file_descriptor fd;
     };
 
     struct callback_result
     {
         std::vector<buffer> bufs;
         std::size_t pos = 0;
+        // See defer_reply
+        bool deferred = false;
     };
 
     struct callback
@@ -92,18 +96,36 @@ public:
             sizeof(frame_type)};
     }
 
-    void send(int fd, const void* buf, std::size_t nbytes);
+    // If pass_fd is not -1 then a duplicate of it is passed to the client
+    // along with the frame.
+    void send(int fd, const void* buf, std::size_t nbytes, int pass_fd = -1);
 
     template<typename FrameType>
-    void send(int fd, const FrameType& frame)
+    void send(int fd, const FrameType& frame, int pass_fd = -1)
     {
-        send(fd, &frame, sizeof(frame));
+        send(fd, &frame, sizeof(frame), pass_fd);
     }
 
     void send_error(int fd, std::string_view reason);
 
+    // May be called by a callback to keep the connection open after the
+    // callback returns, so that replies may be sent later. Replies are sent,
+    // and the connection closed, once complete_reply is called. The
+    // connection is not closed before then even if the client disconnects,
+    // so that fd cannot be reused by another connection in the meantime.
+    void defer_reply(int fd);
+
+    void complete_reply(int fd) noexcept;
+
     void process_commands(int timeout) noexcept;
 
+    // process_commands in two steps, so that callers can avoid timing idle
+    // polls. poll_commands returns the number of ready sockets, to be passed
+    // to dispatch_commands if non-zero.
+    int poll_commands(int timeout) noexcept;
+
+    void dispatch_commands(int nfds) noexcept;
+
     bool is_open() const noexcept
     {
         return !pollfds_.empty();
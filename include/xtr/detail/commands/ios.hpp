@@ -53,6 +53,37 @@ namespace xtr::detail
                   << "K capacity, " << si.buf_nbytes / 1024 << "K used, "
                   << si.dropped_count << " dropped";
     }
+
+    inline std::ostream& operator<<(std::ostream& os, site_state_t state)
+    {
+        switch (state)
+        {
+        case site_state_t::normal:
+            return os << "normal";
+        case site_state_t::enabled:
+            return os << "enabled";
+        case site_state_t::disabled:
+            return os << "disabled";
+        }
+        return os << "<invalid>";
+    }
+
+    inline std::ostream& operator<<(std::ostream& os, const site_info& si)
+    {
+        return os << si.file << ":" << si.line << " (" << si.level << ", "
+                  << si.state << ") \"" << si.format << "\"";
+    }
+
+    inline std::ostream& operator<<(std::ostream& os, const latency_info& li)
+    {
+        if (li.kind == latency_kind_t::write)
+            os << "Writes (" << li.name << ")";
+        else
+            os << li.name;
+        return os << ": " << li.count << " samples, p50 " << li.p50 << "ns, p90 "
+                  << li.p90 << "ns, p99 " << li.p99 << "ns, p99.9 " << li.p999
+                  << "ns, max " << li.max << "ns";
+    }
 }
 
 #endif
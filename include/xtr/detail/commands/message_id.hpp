@@ -30,7 +30,16 @@ namespace xtr::detail
         sink_info,
         success,
         error,
-        reopen
+        reopen,
+        site_status,
+        set_site_state,
+        site_info,
+        latency,
+        latency_info,
+        metrics,
+        metrics_text,
+        stats_region,
+        stats_region_info
     };
 }
 
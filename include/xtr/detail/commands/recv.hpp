@@ -22,17 +22,24 @@
 #define XTR_DETAIL_COMMANDS_RECV_HPP
 
 #include "xtr/detail/commands/frame.hpp"
+#include "xtr/detail/file_descriptor.hpp"
 #include "xtr/detail/retry.hpp"
 
+#include <cstring>
+
 #include <sys/socket.h>
 #include <sys/types.h>
 
 namespace xtr::detail
 {
-    [[nodiscard]] ::ssize_t command_recv(int fd, frame_buf& buf);
+    // If passed_fd is not null then any file descriptor passed by the sender
+    // (see command_send) is stored in it, otherwise the descriptor is closed.
+    [[nodiscard]] ::ssize_t command_recv(
+        int fd, frame_buf& buf, file_descriptor* passed_fd = nullptr);
 }
 
-inline ::ssize_t xtr::detail::command_recv(int fd, frame_buf& buf)
+inline ::ssize_t xtr::detail::command_recv(
+    int fd, frame_buf& buf, file_descriptor* passed_fd)
 {
     ::msghdr hdr{};
     ::iovec iov;
@@ -43,7 +50,33 @@ inline ::ssize_t xtr::detail::command_recv(int fd, frame_buf& buf)
     iov.iov_base = &buf;
     iov.iov_len = sizeof(buf);
 
-    return XTR_TEMP_FAILURE_RETRY(::recvmsg(fd, &hdr, 0));
+    alignas(::cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+
+    if (passed_fd != nullptr)
+    {
+        hdr.msg_control = control;
+        hdr.msg_controllen = sizeof(control);
+    }
+
+    const ::ssize_t nbytes =
+        XTR_TEMP_FAILURE_RETRY(::recvmsg(fd, &hdr, MSG_CMSG_CLOEXEC));
+
+    if (nbytes <= 0 || passed_fd == nullptr)
+        return nbytes;
+
+    for (::cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr); cmsg != nullptr;
+         cmsg = CMSG_NXTHDR(&hdr, cmsg))
+    {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS &&
+            cmsg->cmsg_len == CMSG_LEN(sizeof(int)))
+        {
+            int received;
+            std::memcpy(&received, CMSG_DATA(cmsg), sizeof(int));
+            passed_fd->reset(received);
+        }
+    }
+
+    return nbytes;
 }
 
 #endif
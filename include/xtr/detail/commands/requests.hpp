@@ -24,6 +24,7 @@
 #include "frame.hpp"
 #include "message_id.hpp"
 #include "pattern.hpp"
+#include "xtr/detail/log_site.hpp"
 #include "xtr/log_level.hpp"
 
 namespace xtr::detail
@@ -47,6 +48,38 @@ namespace xtr::detail
     {
         static constexpr auto frame_id = frame_id_t(message_id::reopen);
     };
+
+    struct site_status
+    {
+        static constexpr auto frame_id = frame_id_t(message_id::site_status);
+
+        struct pattern pattern;
+    };
+
+    struct set_site_state
+    {
+        static constexpr auto frame_id = frame_id_t(message_id::set_site_state);
+
+        site_state_t state;
+        struct pattern pattern;
+    };
+
+    struct latency
+    {
+        static constexpr auto frame_id = frame_id_t(message_id::latency);
+
+        struct pattern pattern;
+    };
+
+    struct metrics
+    {
+        static constexpr auto frame_id = frame_id_t(message_id::metrics);
+    };
+
+    struct stats_region
+    {
+        static constexpr auto frame_id = frame_id_t(message_id::stats_region);
+    };
 }
 
 #endif
@@ -26,6 +26,11 @@ namespace xtr::detail
     struct status;
     struct set_level;
     struct reopen;
+    struct site_status;
+    struct set_site_state;
+    struct latency;
+    struct metrics;
+    struct stats_region;
 }
 
 #endif
@@ -23,8 +23,11 @@
 
 #include "frame.hpp"
 #include "message_id.hpp"
+#include "xtr/detail/log_site.hpp"
 #include "xtr/log_level.hpp"
 
+#include <cstdint>
+
 namespace xtr::detail
 {
     struct sink_info
@@ -35,9 +38,65 @@ namespace xtr::detail
         std::size_t buf_capacity;
         std::size_t buf_nbytes;
         std::size_t dropped_count;
+        // Totals since the sink was created, for computing rates (see xtrctl
+        // top).
+        std::size_t n_records;
+        std::size_t n_bytes;
         char name[128];
     };
 
+    struct site_info
+    {
+        static constexpr auto frame_id = frame_id_t(message_id::site_info);
+
+        log_level_t level;
+        site_state_t state;
+        std::uint32_t line;
+        char file[128];
+        char format[256];
+    };
+
+    enum class latency_kind_t : std::uint8_t
+    {
+        // Time spent by log statements in a sink's queue
+        queue,
+        // Time from formatting to the completion of writes to storage
+        write
+    };
+
+    // Latencies are in nanoseconds. For write latencies the name is that of
+    // the consumer shard.
+    struct latency_info
+    {
+        static constexpr auto frame_id = frame_id_t(message_id::latency_info);
+
+        latency_kind_t kind;
+        std::uint64_t count;
+        std::uint64_t p50;
+        std::uint64_t p90;
+        std::uint64_t p99;
+        std::uint64_t p999;
+        std::uint64_t max;
+        char name[128];
+    };
+
+    // Part of a metrics response, which is sent as a sequence of metrics_text
+    // frames whose text is concatenated by the client.
+    struct metrics_text
+    {
+        static constexpr auto frame_id = frame_id_t(message_id::metrics_text);
+
+        std::uint32_t size;
+        char text[496];
+    };
+
+    // Sent with the memfd of the logger's shared_stats region attached, see
+    // command_recv.
+    struct stats_region_info
+    {
+        static constexpr auto frame_id = frame_id_t(message_id::stats_region_info);
+    };
+
     struct success
     {
         static constexpr auto frame_id = frame_id_t(message_id::success);
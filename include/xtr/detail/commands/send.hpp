@@ -23,15 +23,21 @@
 
 #include "xtr/detail/retry.hpp"
 
+#include <cstring>
+
 #include <sys/socket.h>
 #include <sys/types.h>
 
 namespace xtr::detail
 {
-    [[nodiscard]] ::ssize_t command_send(int fd, const void* buf, std::size_t nbytes);
+    // If pass_fd is not -1 then it is passed to the receiver (see
+    // command_recv) via SCM_RIGHTS.
+    [[nodiscard]] ::ssize_t command_send(
+        int fd, const void* buf, std::size_t nbytes, int pass_fd = -1);
 }
 
-inline ::ssize_t xtr::detail::command_send(int fd, const void* buf, std::size_t nbytes)
+inline ::ssize_t xtr::detail::command_send(
+    int fd, const void* buf, std::size_t nbytes, int pass_fd)
 {
     ::msghdr hdr{};
     ::iovec iov;
@@ -42,6 +48,19 @@ inline ::ssize_t xtr::detail::command_send(int fd, const void* buf, std::size_t
     iov.iov_base = const_cast<void*>(buf);
     iov.iov_len = nbytes;
 
+    alignas(::cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+
+    if (pass_fd != -1)
+    {
+        hdr.msg_control = control;
+        hdr.msg_controllen = sizeof(control);
+        ::cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        std::memcpy(CMSG_DATA(cmsg), &pass_fd, sizeof(int));
+    }
+
     return XTR_TEMP_FAILURE_RETRY(::sendmsg(fd, &hdr, MSG_NOSIGNAL | MSG_EOR));
 }
 
@@ -9,4 +9,12 @@
 #endif
 #endif
 
+#if defined(__SANITIZE_ADDRESS__)
+#define XTR_ADDRESS_SANITIZER_ENABLED
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define XTR_ADDRESS_SANITIZER_ENABLED
+#endif
+#endif
+
 #endif
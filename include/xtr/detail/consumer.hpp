@@ -24,13 +24,20 @@
 #include "xtr/detail/buffer.hpp"
 #include "xtr/detail/commands/command_dispatcher_fwd.hpp"
 #include "xtr/detail/commands/requests_fwd.hpp"
+#include "xtr/detail/doorbell.hpp"
+#include "xtr/detail/format_pool.hpp"
+#include "xtr/detail/shared_stats.hpp"
+#include "xtr/detail/synchronized_ring_buffer.hpp"
 #include "xtr/pump_io_stats.hpp"
 
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
 #include <ctime>
 #include <functional>
 #include <latch>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -43,24 +50,88 @@ namespace xtr
     namespace detail
     {
         class consumer;
+
+        // How the consumer thread waits while all sinks are empty, see
+        // consumer::idle.
+        enum class idle_strategy
+        {
+            spin,
+            backoff,
+            sleep,
+            umwait
+        };
+
+        void add_io_stats(pump_io_stats& to, const pump_io_stats& from) noexcept;
     }
 }
 
 class xtr::detail::consumer
 {
 private:
+    // Data for each sink that is only needed once the sink has been found to
+    // be non-empty, see sinks_.
     struct sink_handle
     {
-        sink* operator->()
-        {
-            return p;
-        }
-
-        sink* p;
         std::string name;
         std::size_t dropped_count = 0;
+        std::uint32_t slot = doorbell::npos;
+        // Number of records and bytes of records read from the sink. Written
+        // only by the thread running this consumer, but also read by other
+        // shards' consumers (see status_handler), so are written and read by
+        // other threads via std::atomic_ref, see add_relaxed.
+        std::size_t n_records = 0;
+        std::size_t n_bytes = 0;
+        // Slot of the sink in shared_stats_, see publish_sink_stats
+        std::uint32_t stats_slot = shared_stats::npos;
+    };
+
+    // Statistics accumulated since the consumer was constructed, see
+    // get_io_stats. Times are in TSC ticks. Byte counts and I/O time are
+    // held by buf, see snapshot.
+    struct counters
+    {
+        std::size_t n_events = 0;
+        std::size_t n_bytes_formatted = 0;
+        std::size_t n_bytes_submitted = 0;
+        std::size_t n_dropped = 0;
+        std::uint64_t format_ticks = 0;
+        std::uint64_t io_ticks = 0;
+        std::uint64_t command_ticks = 0;
+    };
+
+    // Totals reported by the metrics command, which may be read by other
+    // shards' consumers (see add_shard). Updated by the thread running this
+    // consumer, see publish_metrics.
+    struct published_counters
+    {
+        std::atomic<std::size_t> n_events{0};
+        std::atomic<std::size_t> n_bytes_written{0};
+        std::atomic<std::size_t> n_errors{0};
     };
 
+    // Records of one sink to be formatted by a format_pool thread. Records
+    // are read from begin up to the first command (which is left for the
+    // consumer thread to run), or up to end.
+    struct batch
+    {
+        std::size_t sink;
+        std::byte* begin = nullptr;
+        std::byte* pos = nullptr;
+        std::byte* end = nullptr;
+        std::byte* span_end = nullptr;
+        std::size_t n_events = 0;
+        bool deferred = false;
+    };
+
+    // Number of passes over the sinks between passes that visit all sinks
+    // instead of only those whose doorbell slot has been rung.
+    static constexpr std::size_t full_scan_interval = 64;
+
+    // Number of sinks at which the doorbell is enabled. With fewer sinks
+    // every sink is visited on each pass, which is cheaper than producers
+    // ringing a doorbell shared with other sinks after every write.
+    static constexpr std::size_t doorbell_min_sinks = 32;
+
 public:
     void run() noexcept;
     bool run_once(pump_io_stats* stats = nullptr) noexcept;
@@ -68,17 +139,29 @@ public:
 
     consumer(
         buffer bf,
-        sink* control,
         std::string command_path,
-        std::function<std::timespec()> clock) :
-        buf(std::move(bf)),
-        clock_(std::move(clock)),
-        sinks_({{control, "control", 0}})
+        std::function<std::timespec()> clock,
+        idle_strategy idle = idle_strategy::spin);
+
+    ~consumer();
+
+    // True once run_once has returned false
+    bool is_stopped() const noexcept
     {
-        set_command_path(std::move(command_path));
+        return destruct_latch_.try_wait();
     }
 
-    ~consumer();
+    void wait_stopped() const
+    {
+        destruct_latch_.wait();
+    }
+
+    // Marks a consumer that will never be run as stopped, so that it may be
+    // destroyed. None of its sinks may be open.
+    void abandon() noexcept
+    {
+        destruct_latch_.count_down();
+    }
 
     consumer(const consumer&) = delete;
     consumer(consumer&&) = delete;
@@ -88,6 +171,56 @@ public:
 
     void add_sink(sink& s, const std::string& name);
 
+    // Called while reading the sink being closed, see sink::close.
+    void close_current_sink() noexcept;
+
+    void set_sink_name(std::string& name, std::string new_name);
+
+    // Adds a consumer of another shard of the same logger, whose sinks are
+    // then also visible to the status and set_level commands, and which is
+    // reopened by the reopen command (see logger::logger). The other consumer
+    // must outlive this consumer's thread.
+    void add_shard(consumer& c);
+
+    std::atomic<std::uint32_t>* park_word() noexcept
+    {
+        return &parked_;
+    }
+
+    doorbell* sink_doorbell() noexcept
+    {
+        return &doorbell_;
+    }
+
+    // Sets the threads used to format log records in addition to the
+    // consumer thread, see read_sinks_parallel. Null disables the pool. The
+    // pool is created by the caller of logger::set_format_threads, so that
+    // errors starting its threads are reported to that caller.
+    void set_format_pool(std::unique_ptr<format_pool> pool) noexcept
+    {
+        format_pool_ = std::move(pool);
+    }
+
+    // Publishes statistics of sinks added after this call to stats, which
+    // may be shared with other shards. Must be called before the consumer
+    // is run.
+    void set_shared_stats(std::shared_ptr<shared_stats> stats) noexcept
+    {
+        shared_stats_ = std::move(stats);
+    }
+
+    // True while records are formatted by format_pool threads, see
+    // trampolineN.
+    bool deferring_commands() const noexcept
+    {
+        return deferring_commands_;
+    }
+
+    // Adds the statistics of this consumer to total and appends the
+    // statistics of each of its sinks to sinks. Must be called by the thread
+    // running this consumer.
+    void get_io_stats(pump_io_stats& total, std::vector<sink_io_stats>& sinks) const;
+
     buffer buf;
     bool destroy = false;
 
@@ -95,12 +228,84 @@ private:
     void status_handler(int fd, detail::status&);
     void set_level_handler(int fd, detail::set_level&);
     void reopen_handler(int fd, detail::reopen&);
+    void site_status_handler(int fd, detail::site_status&);
+    void set_site_state_handler(int fd, detail::set_site_state&);
+    void latency_handler(int fd, detail::latency&);
+    void metrics_handler(int fd, detail::metrics&);
+    void stats_region_handler(int fd, detail::stats_region&);
+    void idle(std::size_t n_idle) noexcept;
+    bool read_sink(std::size_t i, char* ts, bool& ts_stale, std::size_t& n_events) noexcept;
+    void read_clock(char* ts, bool& ts_stale) noexcept;
+    void read_sinks_parallel(
+        bool full_scan, char* ts, bool& ts_stale, std::size_t& n_events) noexcept;
+    void format_batch(batch& b, buffer& out, const char* ts) noexcept;
+    bool read_overwrite_sink(
+        std::size_t i, std::size_t nbytes, const char* ts, std::size_t& n_events) noexcept;
+    void remove_sink(std::size_t i) noexcept;
+    void rearm_sink(std::size_t i) noexcept;
+    void assign_slot(std::size_t i) noexcept;
+    void print_dropped(std::size_t i, buffer& out, const char* ts) noexcept;
+    void wait_parked() noexcept;
+    void reopen_shard() noexcept;
+    void check_reopen_reply() noexcept;
+    template<typename Func>
+    void for_each_sink(Func&& func);
+    counters snapshot() const noexcept;
+    void publish_metrics() noexcept;
+    void publish_sink_stats(std::size_t i) noexcept;
+    static pump_io_stats make_stats(const counters& now, const counters& since) noexcept;
 
     std::function<std::timespec()> clock_;
-    std::vector<sink_handle> sinks_;
+    // sinks_ and sink_info_ are indexed together. Only sinks_ is accessed
+    // when visiting a sink that turns out to be empty, so that each such visit
+    // touches as few cache lines as possible.
+    std::vector<sink*> sinks_;
+    std::vector<sink_handle> sink_info_;
+    // Locked while this consumer modifies sinks_ or sink_info_, and while
+    // other shards' consumers read them (see add_shard).
+    std::mutex sinks_mutex_;
+    std::size_t current_sink_ = 0;
+    std::vector<consumer*> shards_{this};
+    // Reopen requests made by the first shard's consumer, see reopen_handler.
+    // The request with generation reopen_requested_ is complete once
+    // reopen_completed_ is equal to it, at which point reopen_errno_ holds
+    // its result.
+    std::atomic<std::uint64_t> reopen_requested_{0};
+    std::atomic<std::uint64_t> reopen_completed_{0};
+    std::atomic<int> reopen_errno_{0};
+    // Connection waiting for the other shards to reopen, and the generation
+    // of the request made to each shard (indexed as shards_)
+    int reopen_reply_fd_ = -1;
+    std::vector<std::uint64_t> reopen_generations_;
+    // Index in sinks_ of the sink assigned to each doorbell slot, or npos
+    std::vector<std::uint32_t> slot_index_;
+    std::vector<std::uint32_t> free_slots_;
+    // Number of sinks that could not be assigned a doorbell slot
+    std::size_t n_unslotted_ = 0;
+    // Set once doorbell_min_sinks sinks have been added, remains set if
+    // sinks are later removed
+    bool doorbell_enabled_ = false;
+    std::size_t n_passes_ = 0;
+    // TSC ticks at which the first non-empty sink of the current pass was
+    // found, see read_clock. Formatting time is measured from here.
+    std::uint64_t read_start_ = 0;
     std::unique_ptr<detail::command_dispatcher, detail::command_dispatcher_deleter> cmds_;
-    std::size_t flush_count_ = 0;
+    bool flush_pending_ = false;
+    std::unique_ptr<format_pool> format_pool_;
+    std::vector<batch> batches_;
+    std::vector<buffer> groups_;
+    bool deferring_commands_ = false;
+    counters counters_;
+    published_counters published_;
+    std::shared_ptr<shared_stats> shared_stats_;
     std::latch destruct_latch_{1};
+    idle_strategy idle_;
+    int sleep_timeout_ms_ = 0;
+    // Park word, see synchronized_ring_buffer::wake_reader. Written by
+    // producers only while the consumer is parked.
+    alignas(cacheline_size) std::atomic<std::uint32_t> parked_{};
+    // Rung by producers after writing to a sink, see doorbell
+    doorbell doorbell_;
 };
 
 #endif
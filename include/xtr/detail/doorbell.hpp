@@ -0,0 +1,102 @@
+// Copyright 2026 Chris E. Holloway
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef XTR_DETAIL_DOORBELL_HPP
+#define XTR_DETAIL_DOORBELL_HPP
+
+#include "align.hpp"
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace xtr::detail
+{
+    class doorbell;
+}
+
+// A two level bitmap with one bit per slot, used by writers to tell the reader
+// which of its buffers may have become non-empty so that the reader does not
+// need to probe every buffer on each pass. Each summary bit covers one word
+// of slot bits.
+//
+// Writers check whether a bit is already set before setting it, so a busy
+// writer only loads the word. As that load is not ordered after the store
+// publishing the writer's data, a writer may observe its bit as set just
+// before the reader clears it, so the reader must occasionally visit every
+// buffer regardless of the doorbell (see consumer::run_once).
+class xtr::detail::doorbell
+{
+public:
+    static constexpr std::uint32_t capacity = 1U << 16;
+    static constexpr std::uint32_t npos = std::numeric_limits<std::uint32_t>::max();
+
+    void ring(std::uint32_t slot) noexcept
+    {
+        const std::uint64_t bit = std::uint64_t(1) << (slot % word_bits);
+        std::atomic<std::uint64_t>& word = words_[slot / word_bits];
+        if ((word.load(std::memory_order_relaxed) & bit) != 0)
+            return;
+        // The word must be set before the summary, as the reader clears the
+        // summary before the word.
+        word.fetch_or(bit, std::memory_order_release);
+        summary_[slot / summary_bits].fetch_or(
+            std::uint64_t(1) << ((slot / word_bits) % word_bits),
+            std::memory_order_release);
+    }
+
+    // Clears all bits for slots less than limit, calling func for each slot
+    // whose bit was set.
+    template<typename Func>
+    void drain(std::uint32_t limit, Func&& func)
+    {
+        const std::uint32_t n_summary = (limit + summary_bits - 1) / summary_bits;
+        for (std::uint32_t i = 0; i != n_summary; ++i)
+        {
+            if (summary_[i].load(std::memory_order_relaxed) == 0)
+                continue;
+            // The acquires pair with the releases in ring()
+            std::uint64_t words = summary_[i].exchange(0, std::memory_order_acquire);
+            while (words != 0)
+            {
+                const std::uint32_t w =
+                    i * word_bits + std::uint32_t(std::countr_zero(words));
+                words &= words - 1;
+                std::uint64_t bits = words_[w].exchange(0, std::memory_order_acquire);
+                while (bits != 0)
+                {
+                    func(w * word_bits + std::uint32_t(std::countr_zero(bits)));
+                    bits &= bits - 1;
+                }
+            }
+        }
+    }
+
+private:
+    static constexpr std::uint32_t word_bits = 64;
+    static constexpr std::uint32_t summary_bits = word_bits * word_bits;
+
+    alignas(cacheline_size) std::atomic<std::uint64_t> summary_[capacity / summary_bits]{};
+    alignas(cacheline_size) std::atomic<std::uint64_t> words_[capacity / word_bits]{};
+};
+
+#endif
@@ -0,0 +1,138 @@
+// Copyright 2026 Chris E. Holloway
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef XTR_DETAIL_FORMAT_POOL_HPP
+#define XTR_DETAIL_FORMAT_POOL_HPP
+
+#include "xtr/io/storage_interface.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace xtr::detail
+{
+    class format_pool;
+    class memory_storage;
+}
+
+// Threads used by the consumer to format log records in parallel, see
+// consumer::read_sinks_parallel. Work is handed out in rounds: run() invokes
+// a function for each index in a range, spread over the pool's threads and
+// the calling thread, and returns once every invocation has completed. Only
+// as many threads as there are indices beyond the first are woken, and run()
+// does not wait for threads that were not handed an index.
+class xtr::detail::format_pool
+{
+public:
+    explicit format_pool(std::size_t n_threads);
+
+    format_pool(const format_pool&) = delete;
+    format_pool& operator=(const format_pool&) = delete;
+
+    ~format_pool();
+
+    template<typename Func>
+    void run(std::size_t n, Func&& func) noexcept
+    {
+        run(
+            n,
+            [](void* f, std::size_t i)
+            { (*static_cast<std::remove_reference_t<Func>*>(f))(i); },
+            &func);
+    }
+
+    std::size_t size() const noexcept
+    {
+        return threads_.size();
+    }
+
+private:
+    using job_t = void (*)(void*, std::size_t);
+
+    void run(std::size_t n, job_t job, void* ctx) noexcept;
+    std::size_t work(std::uint32_t round, std::size_t n, job_t job, void* ctx) noexcept;
+    void worker() noexcept;
+    void stop() noexcept;
+
+    std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable done_cv_;
+    std::uint32_t round_ = 0;
+    std::size_t n_done_ = 0;
+    bool stop_ = false;
+    job_t job_ = nullptr;
+    void* ctx_ = nullptr;
+    std::size_t n_ = 0;
+    // The round number in the upper 32 bits and the next index to be handed
+    // out in the lower 32 bits. Indices are only claimed while the round
+    // matches, so a thread that wakes after its round has ended cannot claim
+    // an index of the next round with the job and context of its own.
+    std::atomic<std::uint64_t> next_{0};
+    std::vector<std::thread> threads_;
+};
+
+// Storage that collects output in memory, so that records formatted by a
+// format_pool thread can be copied to the consumer's buffer in order.
+class xtr::detail::memory_storage : public storage_interface
+{
+public:
+    std::span<char> allocate_buffer() override;
+
+    void submit_buffer(char* buf, std::size_t size) override;
+
+    void flush() override
+    {
+    }
+
+    void sync() noexcept override
+    {
+    }
+
+    int reopen() noexcept override
+    {
+        return 0;
+    }
+
+    std::string_view data() const noexcept
+    {
+        return {data_.data(), size_};
+    }
+
+    void clear() noexcept
+    {
+        size_ = 0;
+    }
+
+private:
+    static constexpr std::size_t chunk_size = 64 * 1024;
+
+    std::vector<char> data_;
+    std::size_t size_ = 0;
+};
+
+#endif
@@ -0,0 +1,71 @@
+// Copyright 2026 Chris E. Holloway
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef XTR_DETAIL_FUTEX_HPP
+#define XTR_DETAIL_FUTEX_HPP
+
+#include <atomic>
+#include <cstdint>
+
+namespace xtr::detail
+{
+    // Values of a park word, which a thread sets to a non-zero value before
+    // it waits for another thread to make progress. The other thread calls
+    // unpark() if it observes a non-zero value.
+    //
+    // parked_spinning: The waiting thread is spinning or waiting via umwait
+    // on the park word, so storing to the word is sufficient to wake it.
+    //
+    // parked_sleeping: The waiting thread is sleeping in futex_wait on the
+    // park word, so a system call is required to wake it.
+    inline constexpr std::uint32_t parked_spinning = 1;
+    inline constexpr std::uint32_t parked_sleeping = 2;
+
+    // Sleeps while word == expected, for at most timeout_ms milliseconds.
+    // Spurious wake ups are possible.
+    void futex_wait(
+        std::atomic<std::uint32_t>& word, std::uint32_t expected, int timeout_ms) noexcept;
+
+    // Wakes all threads waiting in futex_wait on word.
+    void futex_wake(std::atomic<std::uint32_t>& word) noexcept;
+
+    // Clears the park word and wakes the parked thread, if any.
+    [[gnu::cold]] void unpark(std::atomic<std::uint32_t>& word) noexcept;
+
+    // An asymmetric memory barrier. Calling membarrier() causes all other
+    // threads in the process to execute a full memory barrier, allowing a
+    // thread that parks rarely to synchronize with threads that check the park
+    // word frequently without those threads needing any barrier instructions
+    // of their own (only compiler barriers). The process is registered for
+    // membarrier on first use, membarrier_available() returns false if the
+    // facility is unavailable (in which case membarrier() does nothing).
+    bool membarrier_available() noexcept;
+    void membarrier() noexcept;
+
+    // Timeout for futex_wait calls that rely upon membarrier to avoid missed
+    // wake ups. If membarrier is unavailable then wake ups may be missed, so
+    // a short timeout is used to bound the resulting delay.
+    inline int park_timeout_ms() noexcept
+    {
+        return membarrier_available() ? 100 : 1;
+    }
+}
+
+#endif
@@ -0,0 +1,124 @@
+// Copyright 2026 Chris E. Holloway
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef XTR_DETAIL_INTERN_TABLE_HPP
+#define XTR_DETAIL_INTERN_TABLE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <string_view>
+
+namespace xtr::detail
+{
+    // Argument wrapper created by xtr::interned
+    struct interned_string
+    {
+        std::string_view str;
+    };
+
+    class intern_table;
+
+    // Returns the process-wide table shared by all producers and consumers
+    intern_table& global_intern_table() noexcept;
+}
+
+// Append-only concurrent table mapping strings to 32-bit ids. Producers look
+// up strings without locking, the first producer to use a string copies it
+// into the table and publishes its id with release semantics before the id
+// is written to a sink, so the consumer can always resolve ids it reads.
+// Strings are never removed, so the table is bounded by capacity.
+class xtr::detail::intern_table
+{
+public:
+    static constexpr std::uint32_t capacity = 1U << 14;
+    static constexpr std::uint32_t npos = std::numeric_limits<std::uint32_t>::max();
+
+    intern_table() = default;
+    ~intern_table();
+    intern_table(const intern_table&) = delete;
+    intern_table& operator=(const intern_table&) = delete;
+
+    // Returns the id of the given string, adding it to the table if it is not
+    // present, or npos if the string is not present and the table is full.
+    std::uint32_t intern(std::string_view str) noexcept
+    {
+        const std::size_t hash = std::hash<std::string_view>{}(str);
+        for (std::size_t i = hash;; ++i)
+        {
+            std::atomic<entry*>& slot = slots_[i % n_slots];
+            const entry* e = slot.load(std::memory_order_acquire);
+            if (e == nullptr) [[unlikely]]
+                return insert(i, hash, str);
+            if (e->hash == hash && e->size == str.size() &&
+                std::memcmp(e->data, str.data(), str.size()) == 0)
+            {
+                const std::uint32_t id = e->id.load(std::memory_order_acquire);
+                if (id == pending) [[unlikely]]
+                    return wait_id(*e);
+                return id;
+            }
+        }
+    }
+
+    // Returns the string with the given id, which must have been returned by
+    // intern.
+    std::string_view lookup(std::uint32_t id) const noexcept
+    {
+        const entry* e = ids_[id].load(std::memory_order_acquire);
+        return {e->data, e->size};
+    }
+
+    std::uint32_t size() const noexcept
+    {
+        return std::min(size_.load(std::memory_order_relaxed), capacity);
+    }
+
+private:
+    struct entry
+    {
+        std::size_t hash;
+        // pending until assigned by the producer that added the entry, see
+        // insert
+        std::atomic<std::uint32_t> id;
+        std::uint32_t size;
+        __extension__ char data[];
+    };
+
+    // Slots are kept at most half full to bound the length of probes
+    static constexpr std::size_t n_slots = 2 * std::size_t(capacity);
+
+    static constexpr std::uint32_t pending = npos - 1;
+
+    [[gnu::cold, gnu::noinline]] std::uint32_t insert(
+        std::size_t slot, std::size_t hash, std::string_view str) noexcept;
+
+    [[gnu::cold, gnu::noinline]] static std::uint32_t wait_id(const entry& e) noexcept;
+
+    std::atomic<entry*> slots_[n_slots] = {};
+    std::atomic<entry*> ids_[capacity] = {};
+    std::atomic<std::uint32_t> size_{0};
+};
+
+#endif
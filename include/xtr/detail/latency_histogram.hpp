@@ -0,0 +1,96 @@
+// Copyright 2026 Chris E. Holloway
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef XTR_DETAIL_LATENCY_HISTOGRAM_HPP
+#define XTR_DETAIL_LATENCY_HISTOGRAM_HPP
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+namespace xtr::detail
+{
+    class latency_histogram;
+}
+
+// Histogram of latencies, measured in TSC ticks. As in HdrHistogram, values
+// below 2 * sub_bucket_count are counted exactly, while larger values are
+// counted in buckets whose width doubles with each power of two, so every
+// value is recorded with a relative error of at most 1 / sub_bucket_count.
+// Values are recorded by a single thread, but may be read by other threads
+// at any time (e.g. by the xtrctl latency command), hence the relaxed atomics.
+class xtr::detail::latency_histogram
+{
+public:
+    static constexpr unsigned sub_bucket_bits = 5;
+    static constexpr std::size_t sub_bucket_count = std::size_t(1) << sub_bucket_bits;
+    // Values of more than max_value_bits bits are counted in the last bucket
+    static constexpr unsigned max_value_bits = 48;
+    static constexpr std::size_t bucket_count =
+        2 * sub_bucket_count + (max_value_bits - sub_bucket_bits - 1) * sub_bucket_count;
+
+    void record(std::uint64_t value) noexcept
+    {
+        increment(counts_[bucket_index(value)]);
+        if (value > max_.load(std::memory_order_relaxed))
+            max_.store(value, std::memory_order_relaxed);
+    }
+
+    std::uint64_t count() const noexcept;
+
+    std::uint64_t max() const noexcept
+    {
+        return max_.load(std::memory_order_relaxed);
+    }
+
+    // Returns an upper bound of the smallest value that is greater than or
+    // equal to fraction q of recorded values, or zero if no values have been
+    // recorded.
+    std::uint64_t percentile(double q) const noexcept;
+
+    static std::size_t bucket_index(std::uint64_t value) noexcept
+    {
+        if (value < 2 * sub_bucket_count)
+            return std::size_t(value);
+        const auto width = unsigned(std::bit_width(value));
+        if (width > max_value_bits) [[unlikely]]
+            return bucket_count - 1;
+        // The top sub_bucket_bits + 1 bits of value select the sub-bucket
+        const unsigned shift = width - sub_bucket_bits - 1;
+        return sub_bucket_count * shift + std::size_t(value >> shift);
+    }
+
+    // Returns the largest value counted in the given bucket
+    static std::uint64_t bucket_max(std::size_t index) noexcept;
+
+private:
+    // Only one thread writes, so no atomic read-modify-write is needed
+    static void increment(std::atomic<std::uint64_t>& n) noexcept
+    {
+        n.store(n.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    std::array<std::atomic<std::uint64_t>, bucket_count> counts_{};
+    std::atomic<std::uint64_t> max_{};
+};
+
+#endif
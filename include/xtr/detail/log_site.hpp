@@ -0,0 +1,134 @@
+// Copyright 2026 Chris E. Holloway
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef XTR_DETAIL_LOG_SITE_HPP
+#define XTR_DETAIL_LOG_SITE_HPP
+
+#include "xtr/log_level.hpp"
+
+#include <atomic>
+#include <cstdint>
+
+namespace xtr::detail
+{
+    // State of a log statement, set via the xtrctl site command.
+    //
+    // normal: The statement logs if the sink's log level permits.
+    //
+    // enabled: The statement logs regardless of the sink's log level.
+    //
+    // disabled: The statement never logs.
+    enum class site_state_t : std::uint8_t
+    {
+        normal,
+        enabled,
+        disabled
+    };
+
+    struct log_site_info
+    {
+        const char* file;
+        std::uint32_t line;
+        log_level_t level;
+        const char* format;
+    };
+
+    class log_site;
+
+    void register_log_site(log_site& site) noexcept;
+
+    // Returns the most recently registered site, the remaining sites may be
+    // found by following log_site::next.
+    log_site* log_sites() noexcept;
+}
+
+// A log site exists for every log statement in the program. Sites are
+// registered during static initialisation (see log_site_v below), so all
+// statements are listed by xtrctl, including those that have not yet run.
+class xtr::detail::log_site
+{
+public:
+    constexpr log_site(const log_site_info& info) noexcept :
+        file(info.file),
+        line(info.line),
+        level(info.level),
+        format(info.format)
+    {
+    }
+
+    log_site(const log_site&) = delete;
+    log_site& operator=(const log_site&) = delete;
+
+    bool admits(log_level_t sink_level) const noexcept
+    {
+        const site_state_t st = state_.load(std::memory_order_relaxed);
+        return (sink_level >= level && st != site_state_t::disabled) ||
+               st == site_state_t::enabled;
+    }
+
+    site_state_t state() const noexcept
+    {
+        return state_.load(std::memory_order_relaxed);
+    }
+
+    void set_state(site_state_t st) noexcept
+    {
+        state_.store(st, std::memory_order_relaxed);
+    }
+
+    log_site* next() const noexcept
+    {
+        return next_;
+    }
+
+    const char* const file;
+    const std::uint32_t line;
+    const log_level_t level;
+    const char* const format;
+
+private:
+    std::atomic<site_state_t> state_{site_state_t::normal};
+    log_site* next_ = nullptr;
+
+    friend void register_log_site(log_site&) noexcept;
+};
+
+namespace xtr::detail
+{
+    // Info is a captureless lambda type returning a log_site_info, unique to
+    // each log statement. The site is constant-initialised so that accessing
+    // it does not require a guard variable.
+    template<typename Info>
+    inline log_site log_site_v{Info{}()};
+
+    template<typename Info>
+    inline const bool log_site_registered_v =
+        (register_log_site(log_site_v<Info>), true);
+
+    template<typename Info>
+    log_site& get_log_site() noexcept
+    {
+        // Referencing the flag instantiates it, registering the site
+        (void)log_site_registered_v<Info>;
+        return log_site_v<Info>;
+    }
+}
+
+#endif
@@ -37,6 +37,32 @@
 namespace xtr::detail
 {
     class mirrored_memory_mapping;
+
+    // Options for mirrored_memory_mapping, passed separately from the mmap(2)
+    // flags as they are implemented by the class rather than by mmap.
+    //
+    // mirror_huge_pages: Back the mapping with explicit huge pages
+    // (hugetlbfs) if any are available and the length is a multiple of the
+    // huge page size, otherwise request transparent huge pages via madvise.
+    //
+    // mirror_lock_memory: Lock the mapping into memory via mlock(2).
+    //
+    // mirror_numa_local: Prefer to allocate the mapping's pages on the NUMA
+    // node of the calling thread, via mbind(2).
+    //
+    // mirror_numa_node(node): Prefer to allocate the mapping's pages on the
+    // given NUMA node. The node is stored in the bits from
+    // mirror_numa_node_shift upwards (as with MAP_HUGE_SHIFT for mmap), and
+    // takes precedence over mirror_numa_local.
+    inline constexpr int mirror_huge_pages = 1 << 0;
+    inline constexpr int mirror_lock_memory = 1 << 1;
+    inline constexpr int mirror_numa_local = 1 << 2;
+    inline constexpr int mirror_numa_node_shift = 8;
+
+    constexpr int mirror_numa_node(unsigned node) noexcept
+    {
+        return int(node + 1) << mirror_numa_node_shift;
+    }
 }
 
 class xtr::detail::mirrored_memory_mapping
@@ -50,7 +76,8 @@ public:
         std::size_t length, // must be multiple of page size
         int fd = -1,
         std::size_t offset = 0, // must be multiple of page size
-        int flags = 0);
+        int flags = 0,
+        int mirror_flags = 0);
 
     ~mirrored_memory_mapping();
 
@@ -75,6 +102,8 @@ public:
     }
 
 private:
+    void populate(int mirror_flags);
+
     memory_mapping m_;
 };
 
@@ -21,7 +21,9 @@
 #ifndef XTR_DETAIL_PRINT_HPP
 #define XTR_DETAIL_PRINT_HPP
 
+#include "binary_format.hpp"
 #include "buffer.hpp"
+#include "reorder_buffer.hpp"
 #include "xtr/log_level.hpp"
 
 #include <fmt/compile.h>
@@ -47,6 +49,20 @@ namespace xtr::detail
         try
         {
 #endif
+            if (buf.binary != nullptr) [[unlikely]]
+            {
+                buf.binary->write(
+                    buf.line,
+                    buf.lstyle,
+                    fmt,
+                    level,
+                    ts,
+                    name,
+                    args...);
+                buf.append_line();
+                return;
+            }
+
             fmt::format_to(
                 std::back_inserter(buf.line),
                 fmt,
@@ -55,6 +71,13 @@ namespace xtr::detail
                 name,
                 args...);
 
+            if (buf.reorder != nullptr) [[unlikely]]
+            {
+                buf.reorder->push(
+                    reorder_key(ts, buf.reorder->now), buf.line, buf);
+                return;
+            }
+
             buf.append_line();
 #if __cpp_exceptions
         }
@@ -68,6 +91,10 @@ namespace xtr::detail
                 ts,
                 e.what());
             buf.line.clear();
+            // The partially written record may have defined sites or names,
+            // so start afresh with a new header.
+            if (buf.binary != nullptr)
+                buf.binary->reset();
         }
 #endif
     }
@@ -0,0 +1,164 @@
+// Copyright 2026 Chris E. Holloway
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef XTR_DETAIL_RATE_LIMIT_HPP
+#define XTR_DETAIL_RATE_LIMIT_HPP
+
+#include "tsc.hpp"
+
+#include <fmt/format.h>
+
+#include <atomic>
+#include <cstdint>
+
+namespace xtr::detail
+{
+    // Number of calls to a rate limited log statement that were suppressed
+    // since the statement last logged. Formatted as an empty string if zero,
+    // so that it can be appended to every record emitted by the statement.
+    struct suppressed_count
+    {
+        std::uint64_t n;
+    };
+
+    // Result of asking a rate limiter whether a log statement may log,
+    // converts to true if it may.
+    struct admission
+    {
+        explicit operator bool() const noexcept
+        {
+            return admitted;
+        }
+
+        bool admitted;
+        suppressed_count suppressed;
+    };
+
+    // The rate limiters below hold the state for a single call site, an
+    // instance is created in static storage by each rate limited log macro.
+    // All counters are relaxed atomics as the limits only need to be
+    // approximately observed when a call site is shared between threads.
+
+    class every_n_limiter
+    {
+    public:
+        admission admit(std::uint64_t n) noexcept
+        {
+            const std::uint64_t i = count_.fetch_add(1, std::memory_order_relaxed);
+            if (n <= 1)
+                return {true, {0}};
+            return {i % n == 0, {i == 0 ? 0 : n - 1}};
+        }
+
+    private:
+        std::atomic<std::uint64_t> count_{0};
+    };
+
+    class first_n_limiter
+    {
+    public:
+        admission admit(std::uint64_t n) noexcept
+        {
+            // Load first so that once the limit is reached the call site only
+            // reads the counter, avoiding contention on its cache line.
+            if (count_.load(std::memory_order_relaxed) >= n)
+                return {false, {0}};
+            return {count_.fetch_add(1, std::memory_order_relaxed) < n, {0}};
+        }
+
+    private:
+        std::atomic<std::uint64_t> count_{0};
+    };
+
+    class every_ms_limiter
+    {
+    public:
+        admission admit(std::uint64_t ms) noexcept
+        {
+            const std::uint64_t now = tsc::now().ticks;
+            std::uint64_t next = next_.load(std::memory_order_relaxed);
+            if (now < next ||
+                !next_.compare_exchange_strong(
+                    next,
+                    now + ms * get_tsc_hz() / 1000,
+                    std::memory_order_relaxed))
+            {
+                suppressed_.fetch_add(1, std::memory_order_relaxed);
+                return {false, {0}};
+            }
+            return {true, {suppressed_.exchange(0, std::memory_order_relaxed)}};
+        }
+
+    private:
+        std::atomic<std::uint64_t> next_{0};
+        std::atomic<std::uint64_t> suppressed_{0};
+    };
+
+    // Returns a pseudo-random number from a per-thread xorshift generator,
+    // which is seeded from the timestamp counter on first use.
+    inline std::uint64_t sample_random() noexcept
+    {
+        thread_local std::uint64_t state = 0;
+        if (state == 0) [[unlikely]]
+            state = tsc::now().ticks | 1;
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+
+    class sampled_limiter
+    {
+    public:
+        admission admit(double p) noexcept
+        {
+            if (!(p >= 1.0) &&
+                (p <= 0.0 || sample_random() >= std::uint64_t(p * 0x1p64)))
+            {
+                suppressed_.fetch_add(1, std::memory_order_relaxed);
+                return {false, {0}};
+            }
+            return {true, {suppressed_.exchange(0, std::memory_order_relaxed)}};
+        }
+
+    private:
+        std::atomic<std::uint64_t> suppressed_{0};
+    };
+}
+
+template<>
+struct fmt::formatter<xtr::detail::suppressed_count>
+{
+    template<typename ParseContext>
+    constexpr auto parse(ParseContext& ctx)
+    {
+        return ctx.begin();
+    }
+
+    template<typename FormatContext>
+    auto format(xtr::detail::suppressed_count count, FormatContext& ctx) const
+    {
+        if (count.n == 0)
+            return ctx.out();
+        return fmt::format_to(ctx.out(), " ({} suppressed)", count.n);
+    }
+};
+
+#endif
@@ -0,0 +1,96 @@
+// Copyright 2026 Chris E. Holloway
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef XTR_DETAIL_RECORD_INDEX_HPP
+#define XTR_DETAIL_RECORD_INDEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace xtr::detail
+{
+    class record_index;
+}
+
+// Tracks the positions of records written to a ring buffer, so that the writer
+// of a buffer in overwrite mode can find record boundaries when discarding the
+// oldest records (see synchronized_ring_buffer::discard_oldest). Records begin
+// at multiples of slot_size bytes, and each slot has two bits, one indicating
+// whether a record begins in the slot and one indicating whether that record
+// is pinned (may not be discarded). Only the writer accesses the index.
+class xtr::detail::record_index
+{
+public:
+    static constexpr std::size_t slot_size = sizeof(void (*)());
+
+    struct discard_range
+    {
+        // Position of the first record that is not discarded
+        std::size_t end;
+        // Number of records discarded
+        std::size_t count;
+    };
+
+    explicit record_index(std::size_t capacity);
+
+    // Marks [pos, pos + nbytes) as containing a single record
+    void mark(std::size_t pos, std::size_t nbytes, bool pinned) noexcept
+    {
+        const std::size_t s = pos / slot_size;
+        const std::size_t e = (pos + nbytes) / slot_size;
+        clear(starts_.get(), s, e);
+        clear(pinned_.get(), s, e);
+        set(starts_.get(), s);
+        if (pinned)
+            set(pinned_.get(), s);
+    }
+
+    // Returns the range of records that must be discarded so that the oldest
+    // record begins at or after target, given that the oldest record begins
+    // at head and that records end at limit. Discarding stops early at the
+    // first pinned record. Positions are absolute (not wrapped).
+    discard_range find_discard_range(
+        std::size_t head, std::size_t target, std::size_t limit) const noexcept;
+
+private:
+    static constexpr std::size_t word_bits = 64;
+
+    void set(std::uint64_t* bits, std::size_t slot) noexcept
+    {
+        const std::size_t i = slot & slot_mask_;
+        bits[i / word_bits] |= std::uint64_t(1) << (i % word_bits);
+    }
+
+    void clear(std::uint64_t* bits, std::size_t first, std::size_t last) noexcept;
+
+    std::size_t find_first(
+        const std::uint64_t* bits, std::size_t first, std::size_t last) const noexcept;
+
+    std::size_t count(
+        const std::uint64_t* bits, std::size_t first, std::size_t last) const noexcept;
+
+    // Number of slots minus one, the number of slots is a power of two
+    std::size_t slot_mask_;
+    std::unique_ptr<std::uint64_t[]> starts_;
+    std::unique_ptr<std::uint64_t[]> pinned_;
+};
+
+#endif
@@ -0,0 +1,119 @@
+// Copyright 2026 Chris E. Holloway
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef XTR_DETAIL_REORDER_BUFFER_HPP
+#define XTR_DETAIL_REORDER_BUFFER_HPP
+
+#include "binary_format.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace xtr::detail
+{
+    class buffer;
+    class reorder_buffer;
+
+    inline std::int64_t to_nanos(const std::timespec& ts) noexcept
+    {
+        return std::int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+
+    // Returns the time used to order a log record, which is the record's own
+    // timestamp if it has one (see XTR_LOG_TS and similar), or otherwise the
+    // time at which the consumer read it.
+    template<typename Timestamp>
+    std::int64_t reorder_key(const Timestamp& ts, const std::timespec& now) noexcept
+    {
+        if constexpr (binary::encodable_timestamp<Timestamp>)
+            return to_nanos(binary::to_timespec(ts, now));
+        else
+            return to_nanos(now);
+    }
+}
+
+// Holds formatted log records so that they can be written in timestamp order
+// rather than in the order that sinks are read in. Records are kept in a
+// min-heap ordered by timestamp, and each record is released once the
+// consumer's clock has passed the record's timestamp plus the reorder window,
+// or once more than max_records are held. Records with equal timestamps are
+// released in the order they were read. The strings holding records are
+// reused, so no memory is allocated once enough strings have been created.
+class xtr::detail::reorder_buffer
+{
+public:
+    static constexpr std::size_t max_records = 64 * 1024;
+
+    explicit reorder_buffer(std::int64_t window_nanos) noexcept :
+        window_(window_nanos)
+    {
+    }
+
+    // Takes the record in line, leaving line empty. If the buffer is full
+    // then the oldest record is first written to out.
+    void push(std::int64_t key, std::string& line, buffer& out);
+
+    // Writes records that are older than the reorder window to out
+    void drain(buffer& out);
+
+    // Writes all records to out
+    void drain_all(buffer& out);
+
+    bool empty() const noexcept
+    {
+        return heap_.empty();
+    }
+
+    void set_window(std::int64_t window_nanos) noexcept
+    {
+        window_ = window_nanos;
+    }
+
+    // The time that the consumer last read its clock, see reorder_key
+    std::timespec now{};
+
+private:
+    struct entry
+    {
+        std::int64_t key;
+        std::uint64_t seq;
+        std::size_t index;
+    };
+
+    // std::push_heap builds a max-heap, so the comparison is reversed
+    static bool later(const entry& x, const entry& y) noexcept
+    {
+        return x.key > y.key || (x.key == y.key && x.seq > y.seq);
+    }
+
+    void pop(buffer& out);
+
+    std::int64_t window_;
+    std::uint64_t seq_ = 0;
+    std::vector<entry> heap_;
+    std::vector<std::string> lines_;
+    std::vector<std::size_t> free_;
+};
+
+#endif
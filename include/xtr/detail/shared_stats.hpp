@@ -0,0 +1,172 @@
+// Copyright 2026 Chris E. Holloway
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef XTR_DETAIL_SHARED_STATS_HPP
+#define XTR_DETAIL_SHARED_STATS_HPP
+
+#include "xtr/detail/align.hpp"
+#include "xtr/detail/file_descriptor.hpp"
+#include "xtr/detail/memory_mapping.hpp"
+#include "xtr/log_level.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+namespace xtr::detail
+{
+    struct sink_stats;
+    struct shared_stats_header;
+    struct shared_stats_slot;
+    class shared_stats;
+    class shared_stats_reader;
+
+    // Copies the statistics and name of the sink in the given slot to stats
+    // and name. Returns false if the slot is not in use, or if a consistent
+    // copy could not be taken.
+    bool read_sink_stats(
+        const shared_stats_slot& slot,
+        sink_stats& stats,
+        char (&name)[128]) noexcept;
+}
+
+// Statistics of one sink, see shared_stats
+struct xtr::detail::sink_stats
+{
+    log_level_t level;
+    std::size_t buf_capacity;
+    std::size_t buf_nbytes;
+    std::size_t dropped_count;
+    std::size_t n_records;
+    std::size_t n_bytes;
+};
+
+struct xtr::detail::shared_stats_header
+{
+    static constexpr std::uint32_t magic_value = 0x53525458; // "XTRS"
+    static constexpr std::uint32_t version_value = 1;
+
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t slot_size;
+    // Slots at or beyond this index have never been used
+    std::atomic<std::uint32_t> n_slots;
+};
+
+// Each slot is protected by a sequence lock. The single writer of a slot
+// (the consumer thread reading the slot's sink) makes seq odd, writes the
+// fields and then makes seq even again, while readers retry if seq was odd or
+// changed while the fields were being read. The fields are relaxed atomics so
+// that reads which race with the writer are well defined, and the name is
+// stored as words for the same reason.
+struct alignas(xtr::detail::cacheline_size) xtr::detail::shared_stats_slot
+{
+    std::atomic<std::uint64_t> seq;
+    std::atomic<std::uint64_t> in_use;
+    std::atomic<std::uint64_t> level;
+    std::atomic<std::uint64_t> buf_capacity;
+    std::atomic<std::uint64_t> buf_nbytes;
+    std::atomic<std::uint64_t> dropped_count;
+    std::atomic<std::uint64_t> n_records;
+    std::atomic<std::uint64_t> n_bytes;
+    std::atomic<std::uint64_t> name[16];
+};
+
+// Statistics of every sink of a logger, published in a memfd so that they can
+// be read by other processes (via the xtrctl stats command) without a round
+// trip through the consumer thread. The memfd contains a shared_stats_header
+// followed, at offset slots_offset, by an array of shared_stats_slot. Address
+// space for max_slots slots is reserved up front, and the memfd is grown as
+// slots are allocated, so slots never move.
+class xtr::detail::shared_stats
+{
+public:
+    static constexpr std::uint32_t npos = ~std::uint32_t(0);
+    static constexpr std::size_t slots_offset = cacheline_size;
+    static constexpr std::size_t max_slots = 65536;
+
+    shared_stats();
+
+    // Returns a slot for a sink with the given name, or npos if no slot could
+    // be allocated. May be called by any thread.
+    std::uint32_t allocate(std::string_view name) noexcept;
+
+    // Must only be called by the writer of the slot, after which the slot
+    // may be allocated by any thread
+    void release(std::uint32_t slot) noexcept;
+
+    // Must only be called by the writer of the slot
+    void set_name(std::uint32_t slot, std::string_view name) noexcept;
+
+    // Must only be called by the writer of the slot
+    void publish(std::uint32_t slot, const sink_stats& stats) noexcept;
+
+    int fd() const noexcept
+    {
+        return fd_.get();
+    }
+
+private:
+    shared_stats_header& header() noexcept
+    {
+        return *static_cast<shared_stats_header*>(mapping_.get());
+    }
+
+    shared_stats_slot& slot(std::uint32_t i) noexcept
+    {
+        return static_cast<shared_stats_slot*>(
+            static_cast<void*>(static_cast<char*>(mapping_.get()) + slots_offset))[i];
+    }
+
+    file_descriptor fd_;
+    memory_mapping mapping_;
+    std::mutex mutex_;
+    std::vector<std::uint32_t> free_slots_;
+    // Number of slots ever allocated, and number of slots backed by fd_
+    std::uint32_t n_slots_ = 0;
+    std::uint32_t n_backed_slots_ = 0;
+};
+
+// Read only mapping of a shared_stats memfd, for example one received via
+// the xtrctl stats command.
+class xtr::detail::shared_stats_reader
+{
+public:
+    explicit shared_stats_reader(int fd);
+
+    // Number of slots that may be read. Slots allocated after the reader was
+    // constructed are not visible.
+    std::size_t size() const noexcept;
+
+    const shared_stats_slot& operator[](std::size_t i) const noexcept
+    {
+        return static_cast<const shared_stats_slot*>(static_cast<const void*>(
+            static_cast<const char*>(mapping_.get()) + shared_stats::slots_offset))[i];
+    }
+
+private:
+    memory_mapping mapping_;
+    std::size_t n_mapped_slots_ = 0;
+};
+
+#endif
@@ -75,6 +75,24 @@ namespace xtr::detail
         return s[i] == c ? i : std::size_t(-1);
     }
 
+    // True if the format string refers to an argument by index, e.g. "{0}".
+    // Log statements prepend fields that use automatic indexing to the format
+    // string, and fmt does not allow the two to be mixed.
+    constexpr bool uses_manual_indexing(std::string_view fmt) noexcept
+    {
+        for (std::size_t i = 0; i + 1 < fmt.size(); ++i)
+        {
+            if (fmt[i] == '{')
+            {
+                if (fmt[i + 1] == '{')
+                    ++i;
+                else if (fmt[i + 1] >= '0' && fmt[i + 1] <= '9')
+                    return true;
+            }
+        }
+        return false;
+    }
+
 #if defined(XTR_ENABLE_TEST_STATIC_ASSERTIONS)
     static_assert((string<3>{"foo"} + string{"bar"}).str[0] == 'f');
     static_assert((string<3>{"foo"} + string{"bar"}).str[1] == 'o');
@@ -100,6 +118,12 @@ namespace xtr::detail
     static_assert(rindex("./foo", '/') == 1);
     static_assert(rindex("/foo/bar", '/') == 4);
     static_assert(rindex("/", '/') == 0);
+
+    static_assert(!uses_manual_indexing(""));
+    static_assert(!uses_manual_indexing("{} {:x} {:>{}}"));
+    static_assert(!uses_manual_indexing("{{0}} {{{}}}"));
+    static_assert(uses_manual_indexing("{0}"));
+    static_assert(uses_manual_indexing("{} {{ {1:x}"));
 #endif
 }
 
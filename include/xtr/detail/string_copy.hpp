@@ -0,0 +1,194 @@
+// Copyright 2026 Chris E. Holloway
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef XTR_DETAIL_STRING_COPY_HPP
+#define XTR_DETAIL_STRING_COPY_HPP
+
+#include "config.hpp"
+
+#if defined(__x86_64__)
+#include "cpuid.hpp"
+
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Kernels which copy a NUL terminated string into a buffer while scanning for
+// the terminator, so that the string is only traversed once instead of once by
+// strlen and again by memcpy.
+//
+// The source string is read in aligned blocks, which cannot cross a page
+// boundary and so cannot fault even if they extend past the terminator. Whole
+// blocks are stored to the destination, so up to one block of bytes following
+// the string may be written, but never more than the destination capacity.
+// Reading past the terminator is reported by AddressSanitizer, so the scalar
+// kernel is used when it is enabled.
+
+namespace xtr::detail
+{
+    // Copies min(strlen(src), n) bytes from src to dst, possibly writing up
+    // to n bytes, and returns strlen(src).
+    inline std::size_t copy_c_string_scalar(
+        std::byte* dst, std::size_t n, const char* src, std::size_t copied = 0)
+    {
+        const std::size_t length = copied + std::strlen(src + copied);
+        std::memcpy(dst + copied, src + copied, std::min(length, n) - copied);
+        return length;
+    }
+
+#if defined(__x86_64__)
+    inline bool has_avx2() noexcept
+    {
+        // See https://www.felixcloutier.com/x86/cpuid, leaf 1 ECX bits 27
+        // (OSXSAVE) and 28 (AVX), and leaf 7 EBX bit 5 (AVX2). XGETBV is also
+        // checked to confirm that the OS saves YMM state.
+        if (cpuid(0x0)[0] < 0x7)
+            return false;
+        const std::uint32_t osxsave_avx = (1U << 27) | (1U << 28);
+        if ((cpuid(0x1)[2] & osxsave_avx) != osxsave_avx)
+            return false;
+        std::uint32_t xcr0_lo;
+        std::uint32_t xcr0_hi;
+        asm("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+        if ((xcr0_lo & 0x6) != 0x6)
+            return false;
+        return (cpuid(0x7, 0)[1] & (1U << 5)) != 0;
+    }
+
+    // Dynamically initialized, so it reads as false (selecting the SSE2
+    // kernel) if a string is logged before static initialization completes.
+    inline const bool cpu_has_avx2 = has_avx2();
+
+    inline std::size_t copy_c_string_sse2(
+        std::byte* dst, std::size_t n, const char* src)
+    {
+        constexpr std::size_t block = 16;
+        const std::size_t misalign = std::uintptr_t(src) & (block - 1);
+        const __m128i zero = _mm_setzero_si128();
+        const auto* p = reinterpret_cast<const __m128i*>(src - misalign);
+        std::uint32_t mask =
+            std::uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128(p), zero))) >>
+            misalign;
+
+        if (mask != 0)
+        {
+            const std::size_t length = std::size_t(std::countr_zero(mask));
+            // An unaligned load is safe if it does not cross a page
+            if (n >= block && (std::uintptr_t(src) & 4095) <= 4096 - block) [[likely]]
+            {
+                _mm_storeu_si128(
+                    reinterpret_cast<__m128i*>(dst),
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(src)));
+                return length;
+            }
+            std::memcpy(dst, src, std::min(length, n));
+            return length;
+        }
+
+        // There is no terminator before the next aligned block, so the string
+        // extends into it and an unaligned load from src cannot fault.
+        std::size_t i = block - misalign;
+        if (n < block) [[unlikely]]
+            return copy_c_string_scalar(dst, n, src);
+        _mm_storeu_si128(
+            reinterpret_cast<__m128i*>(dst),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(src)));
+
+        while (i + block <= n)
+        {
+            const __m128i v = _mm_load_si128(reinterpret_cast<const __m128i*>(src + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), v);
+            mask = std::uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero)));
+            if (mask != 0)
+                return i + std::size_t(std::countr_zero(mask));
+            i += block;
+        }
+
+        return copy_c_string_scalar(dst, n, src, i);
+    }
+
+    __attribute__((target("avx2"))) inline std::size_t copy_c_string_avx2(
+        std::byte* dst, std::size_t n, const char* src)
+    {
+        constexpr std::size_t block = 32;
+        const std::size_t misalign = std::uintptr_t(src) & (block - 1);
+        const __m256i zero = _mm256_setzero_si256();
+        const auto* p = reinterpret_cast<const __m256i*>(src - misalign);
+        std::uint32_t mask =
+            std::uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_load_si256(p), zero))) >>
+            misalign;
+
+        if (mask != 0)
+        {
+            const std::size_t length = std::size_t(std::countr_zero(mask));
+            if (n >= block && (std::uintptr_t(src) & 4095) <= 4096 - block) [[likely]]
+            {
+                _mm256_storeu_si256(
+                    reinterpret_cast<__m256i*>(dst),
+                    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src)));
+                return length;
+            }
+            std::memcpy(dst, src, std::min(length, n));
+            return length;
+        }
+
+        std::size_t i = block - misalign;
+        if (n < block) [[unlikely]]
+            return copy_c_string_scalar(dst, n, src);
+        _mm256_storeu_si256(
+            reinterpret_cast<__m256i*>(dst),
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src)));
+
+        while (i + block <= n)
+        {
+            const __m256i v =
+                _mm256_load_si256(reinterpret_cast<const __m256i*>(src + i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), v);
+            mask = std::uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, zero)));
+            if (mask != 0)
+                return i + std::size_t(std::countr_zero(mask));
+            i += block;
+        }
+
+        return copy_c_string_scalar(dst, n, src, i);
+    }
+#endif
+
+    // Copies min(strlen(src), n) bytes from src to dst, possibly writing up
+    // to n bytes, and returns strlen(src). If the returned length is greater
+    // than n then the remainder of the string must be copied by the caller.
+    inline std::size_t copy_c_string(std::byte* dst, std::size_t n, const char* src)
+    {
+#if defined(__x86_64__) && !defined(XTR_ADDRESS_SANITIZER_ENABLED)
+        if (cpu_has_avx2)
+            return copy_c_string_avx2(dst, n, src);
+        return copy_c_string_sse2(dst, n, src);
+#else
+        return copy_c_string_scalar(dst, n, src);
+#endif
+    }
+}
+
+#endif
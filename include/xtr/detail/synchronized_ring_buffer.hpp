@@ -21,18 +21,26 @@
 #ifndef XTR_DETAIL_SYNCHRONIZED_RING_BUFFER_HPP
 #define XTR_DETAIL_SYNCHRONIZED_RING_BUFFER_HPP
 
+#include "align.hpp"
 #include "config.hpp"
+#include "doorbell.hpp"
+#include "futex.hpp"
 #include "mirrored_memory_mapping.hpp"
 #include "pagesize.hpp"
 #include "pause.hpp"
+#include "record_index.hpp"
 #include "tags.hpp"
 
+#include <algorithm>
 #include <atomic>
 #include <bit>
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <limits>
+#include <memory>
+#include <thread>
 #include <type_traits>
 #include <version>
 
@@ -40,6 +48,19 @@ namespace xtr::detail
 {
     inline constexpr std::size_t dynamic_capacity = std::size_t(-1);
 
+    // How writers wait for the reader to make space when the buffer is full,
+    // see synchronized_ring_buffer::wait_for_reader.
+    enum class writer_wait : std::uint8_t
+    {
+        spin,
+        yield,
+        sleep,
+        drop
+    };
+
+    // Number of times a writer spins before yielding, sleeping or dropping
+    inline constexpr std::size_t writer_spin_limit = 1024;
+
 #if defined(MAP_POPULATE)
     inline constexpr int srb_flags = MAP_POPULATE;
 #else
@@ -67,8 +88,6 @@ namespace xtr::detail
     template<std::size_t N>
     using least_uint_t = typename least_uint<N>::type;
 
-    inline constexpr std::size_t cacheline_size = 64;
-
 #if defined(XTR_ENABLE_TEST_STATIC_ASSERTIONS)
     static_assert(std::is_same_v<std::uint8_t, least_uint_t<0UL>>);
     static_assert(std::is_same_v<std::uint8_t, least_uint_t<255UL>>);
@@ -162,7 +181,11 @@ public:
     }
 
     explicit synchronized_ring_buffer(
-        size_type min_capacity, int fd = -1, std::size_t offset = 0, int flags = srb_flags)
+        size_type min_capacity,
+        int fd = -1,
+        std::size_t offset = 0,
+        int flags = srb_flags,
+        int mirror_flags = 0)
         requires is_dynamic
         :
         m_(align_to_page_size(
@@ -173,7 +196,8 @@ public:
 #endif
            fd,
            offset,
-           flags)
+           flags,
+           mirror_flags)
     {
         assert(capacity() <= std::numeric_limits<size_type>::max());
         wrbase_ = begin();
@@ -187,6 +211,8 @@ public:
         wrnread_plus_capacity_ = capacity();
         wrnwritten_ = 0;
         nread_plus_capacity_ = capacity();
+        head_ = 0;
+        doorbell_slot_.store(doorbell::npos, std::memory_order_relaxed);
     }
 
     constexpr size_type capacity() const noexcept
@@ -197,6 +223,16 @@ public:
             return Capacity;
     }
 
+    // As capacity(), but read from the writer's cache line rather than the
+    // reader's, so should be preferred by writers.
+    constexpr size_type wrcapacity() const noexcept
+    {
+        if constexpr (is_dynamic)
+            return wrcapacity_;
+        else
+            return Capacity;
+    }
+
     // write_span() returns a contiguous span of bytes currently available
     // for writing into the buffer.
     template<typename Tags = void()>
@@ -213,10 +249,37 @@ public:
         size_type sz = wrnread_plus_capacity_ - wrnwritten_;
         const auto b = wrbase_ + clamp(wrnwritten_, wrcapacity());
 
-        while (sz < minsize) [[unlikely]]
+        if constexpr (is_batch_v<Tags>)
+        {
+            // Writes that have not been published cannot be read, so they
+            // must be published before waiting for the reader to make space.
+            if (sz < minsize) [[unlikely]]
+                publish();
+        }
+
+        for (std::size_t n = 0; sz < minsize; ++n) [[unlikely]]
         {
-            if constexpr (!is_non_blocking_v<Tags>)
-                pause();
+            if (records_ != nullptr) [[unlikely]]
+            {
+                // Buffers in overwrite mode discard the oldest records
+                // instead of waiting, but must wait if the oldest record is
+                // being read or is pinned.
+                if (!discard_oldest(minsize))
+                    pause();
+            }
+            else if constexpr (!is_non_blocking_v<Tags>)
+            {
+                const bool wait = wait_for_reader<Tags>(
+                    n,
+                    [this, minsize]()
+                    {
+                        return nread_plus_capacity_.load(std::memory_order_acquire) -
+                                   wrnwritten_ >=
+                               minsize;
+                    });
+                if (!wait) [[unlikely]]
+                    break;
+            }
 
             wrnread_plus_capacity_ =
                 nread_plus_capacity_.load(std::memory_order_acquire);
@@ -226,7 +289,7 @@ public:
                 break;
         }
 
-        if (is_non_blocking_v<Tags> && sz < minsize) [[unlikely]]
+        if (is_droppable_v<Tags> && sz < minsize) [[unlikely]]
             return span{};
 
         // span must always begin in the first mapping
@@ -241,13 +304,303 @@ public:
         return write_span<add_tag_t<speculative_tag, Tags>>(minsize);
     }
 
-    void reduce_writable(size_type nbytes) noexcept
+    // If Tags contains batch_tag then the written data is not made visible
+    // to the reader until publish() is called, so that a series of writes
+    // can be published with a single store.
+    //
+    // If the buffer is in overwrite mode then each call to reduce_writable
+    // must write exactly one record, and pinned records are never discarded.
+    template<typename Tags = void()>
+    void reduce_writable(size_type nbytes, bool pinned = true) noexcept
+    {
+        assert(nbytes <= nread_plus_capacity_.load() - wrnwritten_);
+        if (records_ != nullptr) [[unlikely]]
+            records_->mark(wrnwritten_, nbytes, pinned);
+        wrnwritten_ += nbytes;
+        if constexpr (!is_batch_v<Tags>)
+            publish();
+    }
+
+    void publish() noexcept
     {
-        assert(nbytes <= nread_plus_capacity_.load() - nwritten_.load());
         // This release pairs with the acquire in read_span(). No reads or
         // writes in the current thread can be reordered after this store.
-        wrnwritten_ += nbytes;
         nwritten_.store(wrnwritten_, std::memory_order_release);
+        wake_reader();
+    }
+
+    // The reader may park itself (e.g. sleep on a futex) while the buffer is
+    // empty, in which case it sets the park word set via
+    // set_reader_park_word() to a non-zero value. Writers check the park word
+    // after publishing data and wake the reader only if it is parked, so that
+    // in the common case waking costs a single load of a cache line that is
+    // rarely written to.
+    void wake_reader() noexcept
+    {
+        ring_doorbell();
+        // Prevents the compiler from reordering the load of the park word
+        // before the store publishing data. The CPU may still reorder them,
+        // the reader accounts for this by issuing a membarrier after parking
+        // (see consumer::idle).
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+        if (reader_parked_->load(std::memory_order_relaxed) != 0) [[unlikely]]
+            unpark(*reader_parked_);
+    }
+
+    void set_reader_park_word(std::atomic<std::uint32_t>* word) noexcept
+    {
+        reader_parked_ = word;
+    }
+
+    // The reader assigns each buffer a slot in its doorbell, which writers
+    // ring after publishing data so that the reader only needs to visit
+    // buffers that may be non-empty. The doorbell is set by the writer before
+    // the buffer is passed to the reader, the slot is set by the reader.
+    void ring_doorbell() noexcept
+    {
+        const std::uint32_t slot = doorbell_slot_.load(std::memory_order_relaxed);
+        if (slot != doorbell::npos) [[likely]]
+            reader_doorbell_->ring(slot);
+    }
+
+    void set_reader_doorbell(doorbell* d) noexcept
+    {
+        reader_doorbell_ = d;
+    }
+
+    doorbell* reader_doorbell() const noexcept
+    {
+        return reader_doorbell_;
+    }
+
+    void set_doorbell_slot(std::uint32_t slot) noexcept
+    {
+        doorbell_slot_.store(slot, std::memory_order_relaxed);
+    }
+
+    void set_writer_wait(writer_wait w) noexcept
+    {
+        wrwait_ = w;
+    }
+
+    writer_wait get_writer_wait() const noexcept
+    {
+        return wrwait_;
+    }
+
+    // Called by writers while the buffer is too full to write to, n is the
+    // number of times that the writer has already waited. has_space() must
+    // return true once the reader has made enough space for the writer.
+    // Returns false if the write should be dropped instead, which is only
+    // possible if Tags contains droppable_tag.
+    template<typename Tags, typename HasSpace>
+    bool wait_for_reader(std::size_t n, HasSpace&& has_space) noexcept
+    {
+        if (wrwait_ == writer_wait::spin || n < writer_spin_limit) [[likely]]
+        {
+            pause();
+            return true;
+        }
+
+        switch (wrwait_)
+        {
+        case writer_wait::sleep:
+            park_writer(has_space);
+            return true;
+        case writer_wait::drop:
+            if constexpr (is_droppable_v<Tags>)
+                return false;
+            [[fallthrough]];
+        default:
+            std::this_thread::yield();
+            return true;
+        }
+    }
+
+    std::atomic<std::uint32_t>* reader_park_word() const noexcept
+    {
+        return reader_parked_;
+    }
+
+    // Multi-producer interface. Any number of threads may call reserve()
+    // concurrently, each reservation is claimed with a single fetch_add (or a
+    // compare-and-swap loop if non-blocking) of nwritten_. As nwritten_ then
+    // no longer indicates how much data is readable, each reservation begins
+    // with a commit word which is zero until the producer has finished
+    // writing. The consumer must check the commit word via committed() before
+    // reading a reservation, and must zero all data it has read by calling
+    // reduce_readable_and_zero() instead of reduce_readable(). The
+    // single-producer functions (write_span, reduce_writable) must not be
+    // used on a buffer used in this way.
+    template<typename Tags = void()>
+    span reserve(size_type nbytes) noexcept
+    {
+        assert(nbytes <= capacity());
+
+        // Signed arithmetic is needed as blocking reservations may lie further
+        // ahead than the consumer has yet made space for. The acquires of
+        // nread_plus_capacity_ pair with the release in reduce_readable().
+        using ssize_type = std::make_signed_t<size_type>;
+        const auto available = [this](size_type nw)
+        { return ssize_type(nread_plus_capacity_.load(std::memory_order_acquire) - nw); };
+
+        size_type nw;
+
+        if constexpr (is_non_blocking_v<Tags>)
+        {
+            nw = nwritten_.load(std::memory_order_relaxed);
+            do
+            {
+                if (available(nw) < ssize_type(nbytes))
+                    return span{};
+            } while (!nwritten_.compare_exchange_weak(
+                nw,
+                nw + nbytes,
+                std::memory_order_relaxed));
+        }
+        else if (is_droppable_v<Tags> && wrwait_ == writer_wait::drop) [[unlikely]]
+        {
+            // Space can only be claimed once it is known to be available, as
+            // claimed space cannot be given back.
+            std::size_t n = 0;
+            nw = nwritten_.load(std::memory_order_relaxed);
+            do
+            {
+                while (available(nw) < ssize_type(nbytes))
+                {
+                    if (!wait_for_reader<Tags>(n++, []() { return false; }))
+                        return span{};
+                    nw = nwritten_.load(std::memory_order_relaxed);
+                }
+            } while (!nwritten_.compare_exchange_weak(
+                nw,
+                nw + nbytes,
+                std::memory_order_relaxed));
+        }
+        else
+        {
+            nw = nwritten_.fetch_add(nbytes, std::memory_order_relaxed);
+            for (std::size_t n = 0; available(nw) < ssize_type(nbytes); ++n) [[unlikely]]
+            {
+                // Claimed space must be written to, so the write cannot be
+                // dropped here.
+                (void)wait_for_reader<void()>(
+                    n,
+                    [&]() { return available(nw) >= ssize_type(nbytes); });
+            }
+        }
+
+        const auto b = begin() + clamp(nw, capacity());
+        return {b, b + nbytes};
+    }
+
+    // Publishes a reservation by storing its first word, which must be
+    // non-zero.
+    template<typename T>
+    static void commit(std::byte* pos, T value) noexcept
+    {
+        static_assert(sizeof(T) == sizeof(void*));
+        assert(std::uintptr_t(pos) % alignof(T) == 0);
+        // This release pairs with the acquire in committed()
+        __atomic_store_n(reinterpret_cast<T*>(pos), value, __ATOMIC_RELEASE);
+    }
+
+    // Returns the first word of a reservation, or zero if it has not yet been
+    // committed.
+    template<typename T>
+    static T committed(const std::byte* pos) noexcept
+    {
+        static_assert(sizeof(T) == sizeof(void*));
+        assert(std::uintptr_t(pos) % alignof(T) == 0);
+        return __atomic_load_n(reinterpret_cast<const T*>(pos), __ATOMIC_ACQUIRE);
+    }
+
+    void reduce_readable_and_zero(size_type nbytes) noexcept
+    {
+        // The data is zeroed via the first mapping only, so that it is
+        // written to at the same addresses that producers will write to.
+        const size_type nr =
+            nread_plus_capacity_.load(std::memory_order_relaxed) - capacity();
+        const size_type offset = clamp(nr, capacity());
+        const size_type n = std::min(nbytes, capacity() - offset);
+        std::memset(begin() + offset, 0, n);
+        std::memset(begin(), 0, nbytes - n);
+        reduce_readable(nbytes);
+    }
+
+    // Overwrite mode. If the buffer is full then instead of waiting for the
+    // reader to make space, the writer discards the oldest records by
+    // advancing head_, which is the position of the oldest unread record.
+    // The reader must therefore claim each record before reading it via
+    // claim_oldest(), which sets the low bit of head_ to prevent the writer
+    // from discarding the record, then call release_oldest() once it has
+    // finished with the record. The count of discarded records is added to
+    // *discarded. reduce_readable() must not be used on a buffer in overwrite
+    // mode. read_span() may still be used to check the size or emptiness of
+    // the unread data, as release_to() advances the read position whenever
+    // records are released or discarded, but the span's contents must only
+    // be read via claim_oldest().
+    void enable_overwrite(std::atomic<std::size_t>* discarded)
+    {
+        records_ = std::make_unique<record_index>(capacity());
+        discarded_ = discarded;
+    }
+
+    bool overwrites() const noexcept
+    {
+        return records_ != nullptr;
+    }
+
+    // Discards the oldest records until minsize bytes are available for
+    // writing. Returns false if the oldest record could not be discarded.
+    [[gnu::cold]] bool discard_oldest(size_type minsize) noexcept
+    {
+        assert(minsize <= capacity());
+        size_type h = head_.load(std::memory_order_acquire);
+        if ((h & reader_busy) != 0)
+            return false;
+        const size_type target = wrnwritten_ + minsize - capacity();
+        if (h >= target) // The reader has made space
+            return true;
+        const auto [end, count] = records_->find_discard_range(h, target, wrnwritten_);
+        if (end == h)
+            return false;
+        // This acquire pairs with the release in release_oldest, so that the
+        // reader has finished reading any data before it is overwritten.
+        if (!head_.compare_exchange_strong(h, end, std::memory_order_acquire))
+            return false;
+        release_to(end);
+        discarded_->fetch_add(count, std::memory_order_relaxed);
+        return true;
+    }
+
+    // As discard_oldest, but makes space for writing up to the given address
+    [[gnu::cold]] bool discard_until(const std::byte* e) noexcept
+    {
+        const auto b = wrbase_ + clamp(wrnwritten_, wrcapacity());
+        const auto minsize = size_type(e - b);
+        return minsize <= capacity() && discard_oldest(minsize);
+    }
+
+    // Returns the oldest record, or nullptr if there are no records to read
+    std::byte* claim_oldest() noexcept
+    {
+        size_type h = head_.load(std::memory_order_relaxed);
+        do
+        {
+            // This acquire pairs with the release in publish()
+            if (h == nwritten_.load(std::memory_order_acquire))
+                return nullptr;
+        } while (!head_.compare_exchange_weak(h, h | reader_busy, std::memory_order_relaxed));
+        return begin() + clamp(h, capacity());
+    }
+
+    void release_oldest(size_type nbytes) noexcept
+    {
+        // The writer cannot modify head_ while the busy bit is set
+        const size_type h = head_.load(std::memory_order_relaxed) & ~reader_busy;
+        head_.store(h + nbytes, std::memory_order_release);
+        release_to(h + nbytes);
     }
 
     const_span read_span() const noexcept
@@ -279,6 +632,11 @@ public:
             nread_plus_capacity_.load(std::memory_order_relaxed) + nbytes,
             std::memory_order_release);
 
+        // See wake_reader
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+        if (writer_parked_.load(std::memory_order_relaxed) != 0) [[unlikely]]
+            unpark(writer_parked_);
+
 #if !defined(XTR_THREAD_SANITIZER_ENABLED)
         assert(nread_plus_capacity_.load() - nwritten_.load() <= capacity());
 #endif
@@ -316,12 +674,31 @@ private:
     static_assert(is_dynamic || Capacity > 0);
     static_assert(is_dynamic || Capacity <= std::numeric_limits<size_type>::max());
 
-    size_type wrcapacity() const noexcept
+    // Raises nread_plus_capacity_ to pos + capacity(), in overwrite mode
+    // both the reader and the writer advance it.
+    void release_to(size_type pos) noexcept
     {
-        if constexpr (is_dynamic)
-            return wrcapacity_;
-        else
-            return Capacity;
+        size_type n = nread_plus_capacity_.load(std::memory_order_relaxed);
+        while (n < pos + capacity() &&
+               !nread_plus_capacity_.compare_exchange_weak(
+                   n,
+                   pos + capacity(),
+                   std::memory_order_release,
+                   std::memory_order_relaxed))
+        {
+        }
+    }
+
+    template<typename HasSpace>
+    [[gnu::cold]] void park_writer(HasSpace& has_space) noexcept
+    {
+        // The membarrier pairs with the signal fence in reduce_readable,
+        // either the reader observes the park word being set or has_space()
+        // observes the space made by the reader. See wake_reader.
+        writer_parked_.store(parked_sleeping, std::memory_order_seq_cst);
+        membarrier();
+        if (!has_space())
+            futex_wait(writer_parked_, parked_sleeping, park_timeout_ms());
     }
 
     size_type clamp(size_type n, size_type capacity)
@@ -350,9 +727,26 @@ private:
     [[no_unique_address]] capacity_type wrcapacity_;
     size_type wrnread_plus_capacity_;
     size_type wrnwritten_{};
+    std::atomic<std::uint32_t>* reader_parked_ = &never_parked_;
+    doorbell* reader_doorbell_ = nullptr;
+    // Written by the reader once, when the buffer is passed to it
+    std::atomic<std::uint32_t> doorbell_slot_{doorbell::npos};
+    writer_wait wrwait_ = writer_wait::spin;
+    // Writer data for overwrite mode
+    std::unique_ptr<record_index> records_;
+    std::atomic<std::size_t>* discarded_ = nullptr;
+
+    // Park word used by buffers that have no reader yet
+    inline static std::atomic<std::uint32_t> never_parked_{};
 
     // Shared, but written by the reader only:
     alignas(cacheline_size) std::atomic<size_type> nread_plus_capacity_{};
+    // Written by writers, but only while they are waiting for the reader
+    // (with writer_wait::sleep):
+    std::atomic<std::uint32_t> writer_parked_{};
+    // Shared, used in overwrite mode only:
+    static constexpr size_type reader_busy = 1;
+    std::atomic<size_type> head_{};
     // Reader data, note that the first member of mirrored_memory_mapping
     // is a pointer to the mapping:
     mirrored_memory_mapping m_;
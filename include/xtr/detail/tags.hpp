@@ -49,6 +49,15 @@ namespace xtr::detail
     using add_tag_t = typename add_tag<Tag, Tags...>::type;
 
     struct speculative_tag;
+    struct multi_producer_tag;
+    struct batch_tag;
+    // Marks log records (as opposed to commands sent to the consumer, which
+    // must never be dropped), which may be dropped if the sink is full and
+    // the sink's wait policy is writer_wait::drop.
+    struct droppable_tag;
+    // Marks log records that are prefixed by the time at which they were
+    // written if the sink measures latency, see trampoline_enqueue_time.
+    struct enqueue_time_tag;
 
     template<typename Tags>
     inline constexpr bool is_non_blocking_v =
@@ -60,6 +69,21 @@ namespace xtr::detail
 
     template<typename Tags>
     inline constexpr bool is_timestamp_v = detect_tag<timestamp_tag, Tags>::value;
+
+    template<typename Tags>
+    inline constexpr bool is_multi_producer_v =
+        detect_tag<multi_producer_tag, Tags>::value;
+
+    template<typename Tags>
+    inline constexpr bool is_batch_v = detect_tag<batch_tag, Tags>::value;
+
+    template<typename Tags>
+    inline constexpr bool is_enqueue_time_v =
+        detect_tag<enqueue_time_tag, Tags>::value;
+
+    template<typename Tags>
+    inline constexpr bool is_droppable_v =
+        is_non_blocking_v<Tags> || detect_tag<droppable_tag, Tags>::value;
 }
 
 #endif
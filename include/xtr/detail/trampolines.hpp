@@ -23,9 +23,12 @@
 
 #include "align.hpp"
 #include "buffer.hpp"
+#include "latency_histogram.hpp"
+#include "tsc.hpp"
 
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <string>
 
@@ -79,11 +82,19 @@ namespace xtr::detail
 
         // Invoke lambda, the first call is for commands sent to the consumer
         // thread such as adding a new producer or modifying the output stream.
+        // Commands are left unread while records are being formatted by
+        // format_pool threads, and are then run by the consumer thread.
         auto& func = *reinterpret_cast<Func*>(func_pos);
         if constexpr (std::is_same_v<decltype(Format), std::nullptr_t>)
+        {
+            if (st.deferring_commands()) [[unlikely]]
+                return record;
             func(st, name);
+        }
         else
+        {
             func(buf, record, Format, Level, timestamp, name);
+        }
 
         static_assert(noexcept(func.~Func()));
         std::destroy_at(std::addressof(func));
@@ -91,6 +102,62 @@ namespace xtr::detail
         return func_pos + align(sizeof(Func), alignof(fptr_t));
     }
 
+    // Padding---multi-producer sinks reserve space for a record before its
+    // exact size is known. Any space left over is filled with pointers to
+    // this trampoline, which skips over itself:
+    //
+    //    +---------------------------+
+    //    | function pointer (fptr_t) |---> trampoline_skip<State>
+    //    +---------------------------+
+    template<typename State>
+    std::byte* trampoline_skip(
+        buffer&, std::byte* record, State&, const char*, std::string&) noexcept
+    {
+        return record + sizeof(void (*)());
+    }
+
+    // Enqueue time---log records written to sinks that measure latency are
+    // prefixed with the time at which they were written. The time between
+    // writing and reading the record is recorded in the histogram of the sink
+    // being read (see buffer::latency), then the record itself is processed,
+    // so that the prefix and record are read (or dropped) together as a
+    // single record:
+    //
+    //    +---------------------------+
+    //    | function pointer (fptr_t) |---> trampoline_enqueue_time<State>
+    //    +---------------------------+          |
+    //    | enqueue_time              |          | [ trampoline invokes
+    //    +---------------------------+          |   record's trampoline ]
+    //    | function pointer (fptr_t) | <--------+
+    //    /    record                 /
+    //    +---------------------------+
+    struct enqueue_time
+    {
+        std::uint64_t ticks;
+    };
+
+    template<typename State>
+    std::byte* trampoline_enqueue_time(
+        buffer& buf,
+        std::byte* record,
+        State& st,
+        const char* timestamp,
+        std::string& name) noexcept
+    {
+        using fptr_t = std::byte* (*)(
+            buffer&, std::byte*, State&, const char*, std::string&) noexcept;
+
+        record += sizeof(fptr_t);
+        const auto& et = *reinterpret_cast<const enqueue_time*>(record);
+        assert(buf.latency != nullptr);
+        buf.latency->record(tsc::now().ticks - et.ticks);
+        record += sizeof(enqueue_time);
+        static_assert(sizeof(enqueue_time) % alignof(fptr_t) == 0);
+
+        const fptr_t fptr = *reinterpret_cast<const fptr_t*>(record);
+        return fptr(buf, record, st, timestamp, name);
+    }
+
     // String capture---log has arguments, some of which are strings whose
     // length is only known at run time. A function pointer, lambda, record
     // size and string table are written to the queue:
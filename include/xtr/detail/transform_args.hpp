@@ -22,8 +22,10 @@
 #define XTR_DETAIL_TRANSFORM_ARGS_HPP
 
 #include "align.hpp"
+#include "intern_table.hpp"
 #include "is_c_string.hpp"
 #include "pause.hpp"
+#include "string_copy.hpp"
 #include "string_ref.hpp"
 #include "tags.hpp"
 #include "vcopy_wrapper.hpp"
@@ -46,7 +48,7 @@ namespace xtr::detail
             std::numeric_limits<std::uint32_t>::max();
 
         // This conversion is safe as sink cannot have a capacity greater
-        // than UINT_MAX (via a static assertion in sink.hpp). Additionally
+        // than UINT_MAX (see sink::max_capacity). Additionally
         // truncated having the value UINT_MAX is safe as the size of a log
         // record must be greater than zero.
         explicit string_table_entry(std::size_t sz) :
@@ -57,6 +59,15 @@ namespace xtr::detail
         std::uint32_t size;
     };
 
+    // Either the id of a string in the global intern table, or if the table
+    // was full, the size of a string copied as for string_table_entry.
+    struct interned_entry
+    {
+        static constexpr std::uint32_t copied = 1U << 31;
+
+        std::uint32_t value;
+    };
+
     template<typename T>
     struct variable_length_entry
     {
@@ -94,13 +105,49 @@ namespace xtr::detail
         return string_ref<std::string_view>(str);
     }
 
+    inline string_ref<std::string_view> reconstruct_args(
+        std::byte*& pos, interned_entry entry)
+    {
+        if (entry.value & interned_entry::copied) [[unlikely]]
+        {
+            const std::uint32_t size = entry.value == string_table_entry::truncated
+                                           ? entry.value
+                                           : entry.value & ~interned_entry::copied;
+            return reconstruct_args(pos, string_table_entry(size));
+        }
+        return string_ref<std::string_view>(global_intern_table().lookup(entry.value));
+    }
+
     template<typename Tags, typename Buffer>
     __attribute__((always_inline)) inline bool wait_for_capacity(
         std::byte*& end, std::byte* min_end, Buffer& buf)
     {
-        while (end < min_end) [[unlikely]]
+        // See synchronized_ring_buffer::write_span
+        if constexpr (is_batch_v<Tags>)
+        {
+            if (end < min_end) [[unlikely]]
+                buf.publish();
+        }
+
+        for (std::size_t n = 0; end < min_end; ++n) [[unlikely]]
         {
-            pause();
+            if (buf.overwrites()) [[unlikely]]
+            {
+                if (!buf.discard_until(min_end))
+                    pause();
+            }
+            else if constexpr (!is_non_blocking_v<Tags>)
+            {
+                const bool wait = buf.template wait_for_reader<Tags>(
+                    n,
+                    [&buf, min_end]() { return buf.write_span().end() >= min_end; });
+                if (!wait) [[unlikely]]
+                    return false;
+            }
+            else
+            {
+                pause();
+            }
             const auto s = buf.write_span();
             if (s.end() < min_end) [[unlikely]]
             {
@@ -178,13 +225,72 @@ namespace xtr::detail
         return string_table_entry(str.length());
     }
 
+    template<typename Tags, typename Buffer>
+    interned_entry transform_args(
+        std::byte*& pos, std::byte*& end, Buffer& buf, bool&, interned_string is)
+    {
+        const std::uint32_t id = global_intern_table().intern(is.str);
+        if (id != intern_table::npos) [[likely]]
+            return interned_entry{id};
+        // The table is full, so copy the string. Strings too long for their
+        // size to be encoded cannot fit in a sink anyway.
+        if (is.str.length() >= interned_entry::copied ||
+            !copy<Tags>(pos, end, buf, is.str.data(), is.str.length())) [[unlikely]]
+            return interned_entry{string_table_entry::truncated};
+        return interned_entry{std::uint32_t(is.str.length()) | interned_entry::copied};
+    }
+
+    // Upper bound on the number of bytes that transform_args will write to the
+    // variable length area for the given argument, used by multi-producer sinks
+    // which must reserve space for a record before writing it.
+    template<typename T>
+    std::size_t variable_length_bound(const T&)
+    {
+        return 0;
+    }
+
+    template<typename T>
+    std::size_t variable_length_bound(const vcopy_wrapper<T>& vc)
+    {
+        return vc.size + alignof(T) - 1;
+    }
+
+    template<typename String>
+        requires std::same_as<String, std::string> ||
+                 std::same_as<String, std::string_view>
+    std::size_t variable_length_bound(const String& str)
+    {
+        return str.length();
+    }
+
+    inline std::size_t variable_length_bound(const interned_string& is)
+    {
+        return is.str.length();
+    }
+
+    template<typename T>
+        requires is_c_string<T>::value
+    std::size_t variable_length_bound(const T& str)
+    {
+        return std::strlen(str);
+    }
+
     template<typename Tags, typename Buffer>
     string_table_entry transform_args(
         std::byte*& pos, std::byte*& end, Buffer& buf, bool&, const char* str)
     {
-        const std::size_t length = std::strlen(str);
-        if (!copy<Tags>(pos, end, buf, str, length)) [[unlikely]]
-            return string_table_entry{string_table_entry::truncated};
+        // The string is copied into whatever space is already available
+        // while its length is found, and only if that is insufficient is
+        // wait_for_capacity called to copy the remainder.
+        const std::size_t avail = pos < end ? std::size_t(end - pos) : 0;
+        const std::size_t length = copy_c_string(pos, avail, str);
+        if (length > avail) [[unlikely]]
+        {
+            if (!wait_for_capacity<Tags>(end, pos + length, buf)) [[unlikely]]
+                return string_table_entry{string_table_entry::truncated};
+            std::memcpy(pos + avail, str + avail, length - avail);
+        }
+        pos += length;
         return string_table_entry(length);
     }
 }
@@ -0,0 +1,85 @@
+// Copyright 2026 Chris E. Holloway
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef XTR_DETAIL_WAITPKG_HPP
+#define XTR_DETAIL_WAITPKG_HPP
+
+#if defined(__x86_64__)
+#include "cpuid.hpp"
+#endif
+
+#include <cstdint>
+
+// Wrappers for the WAITPKG instructions (umonitor/umwait), which allow a
+// thread to wait in a low power state until a monitored cache line is written
+// to or a TSC deadline passes. The instructions are emitted as bytes so that
+// -mwaitpkg is not required, and must only be executed if has_waitpkg()
+// returns true.
+
+namespace xtr::detail
+{
+    // umwait control values, C0.2 has a slower wake up than C0.1 but saves
+    // more power.
+    inline constexpr std::uint32_t umwait_c02 = 0;
+    inline constexpr std::uint32_t umwait_c01 = 1;
+
+    inline bool has_waitpkg() noexcept
+    {
+#if defined(__x86_64__)
+        // See https://www.felixcloutier.com/x86/cpuid, leaf 7 ECX bit 5
+        if (cpuid(0x0)[0] < 0x7)
+            return false;
+        return (cpuid(0x7, 0)[2] & (1U << 5)) != 0;
+#else
+        return false;
+#endif
+    }
+
+    inline void umonitor([[maybe_unused]] const volatile void* addr) noexcept
+    {
+#if defined(__x86_64__)
+        // umonitor %rax
+        asm volatile(".byte 0xf3, 0x0f, 0xae, 0xf0" : : "a"(addr) : "memory");
+#endif
+    }
+
+    // Returns true if the wait ended because the deadline passed, rather than
+    // because the monitored address was written to.
+    inline bool umwait(
+        [[maybe_unused]] std::uint32_t control,
+        [[maybe_unused]] std::uint64_t tsc_deadline) noexcept
+    {
+#if defined(__x86_64__)
+        bool timed_out;
+        // umwait %ecx, deadline is in edx:eax, CF is set on timeout
+        asm volatile(".byte 0xf2, 0x0f, 0xae, 0xf1"
+                     : "=@ccc"(timed_out)
+                     : "c"(control),
+                       "a"(std::uint32_t(tsc_deadline)),
+                       "d"(std::uint32_t(tsc_deadline >> 32))
+                     : "memory");
+        return timed_out;
+#else
+        return true;
+#endif
+    }
+}
+
+#endif
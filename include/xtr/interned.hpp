@@ -0,0 +1,48 @@
+// Copyright 2026 Chris E. Holloway
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef XTR_INTERNED_HPP
+#define XTR_INTERNED_HPP
+
+#include "detail/intern_table.hpp"
+
+#include <string_view>
+
+namespace xtr
+{
+    /**
+     * interned is used to specify that a string argument which is logged
+     * repeatedly (for example a symbol or venue name) should be interned, so
+     * that `arg` becomes `interned(arg)`. The first time a string is logged it
+     * is copied into a process-wide table, after which only a 4-byte id is
+     * written to the sink rather than the contents of the string. The table is
+     * never emptied and holds up to 16384 strings, once it is full strings
+     * that are not already in the table are copied as if they had not been
+     * interned. Accepts C strings, std::string and std::string_view. Please
+     * see the <a href="guide.html#string-arguments">string arguments</a>
+     * section of the user guide for further details.
+     */
+    inline auto interned(std::string_view str) noexcept
+    {
+        return detail::interned_string{str};
+    }
+}
+
+#endif
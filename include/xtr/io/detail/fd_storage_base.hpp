@@ -22,8 +22,10 @@
 #define XTR_IO_DETAIL_FD_STORAGE_BASE_HPP
 
 #include "xtr/detail/file_descriptor.hpp"
+#include "xtr/detail/latency_histogram.hpp"
 #include "xtr/io/storage_interface.hpp"
 
+#include <cstddef>
 #include <string>
 
 namespace xtr::detail
@@ -40,11 +42,25 @@ public:
 
     int reopen() noexcept override;
 
+    const latency_histogram* write_latency() const noexcept override
+    {
+        return &write_latency_;
+    }
+
+    std::size_t error_count() const noexcept override
+    {
+        return error_count_;
+    }
+
 protected:
     virtual void replace_fd(file_descriptor fd) noexcept;
 
     std::string reopen_path_;
     detail::file_descriptor fd_;
+    // Recorded by derived classes once each buffer has been written
+    latency_histogram write_latency_;
+    // Incremented by derived classes each time a write fails
+    std::size_t error_count_ = 0;
 };
 
 #endif
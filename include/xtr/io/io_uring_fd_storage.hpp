@@ -30,6 +30,7 @@
 #include <liburing.h>
 
 #include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <span>
 #include <string>
@@ -88,6 +89,7 @@ private:
         unsigned size_; // io_uring_cqe::res is an int
         std::size_t offset_;
         std::size_t file_offset_;
+        std::uint64_t allocate_tsc_; // See write_latency
         buffer* next_;
         __extension__ char data_[];
 
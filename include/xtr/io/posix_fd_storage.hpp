@@ -24,6 +24,7 @@
 #include "detail/fd_storage_base.hpp"
 
 #include <cstddef>
+#include <cstdint>
 #include <string>
 
 namespace xtr
@@ -79,6 +80,8 @@ protected:
 private:
     std::unique_ptr<char[]> buf_;
     std::size_t buffer_capacity_;
+    // Time at which buf_ was last allocated, see write_latency
+    std::uint64_t allocate_tsc_ = 0;
 };
 
 #endif
@@ -29,6 +29,11 @@ namespace xtr
 {
     struct storage_interface;
 
+    namespace detail
+    {
+        class latency_histogram;
+    }
+
     /**
      * Convenience typedef for std::unique_ptr<@ref storage_interface>
      */
@@ -83,6 +88,28 @@ struct xtr::storage_interface
      */
     virtual int reopen() noexcept = 0;
 
+    /**
+     * Returns a histogram of the time taken from the allocation of each
+     * buffer (i.e. from when data begins to be formatted into it) to the
+     * completion of its write, or null if the back-end does not measure this.
+     * Reported by the xtrctl <a href="xtrctl.html#latency">latency
+     * command</a>.
+     */
+    virtual const detail::latency_histogram* write_latency() const noexcept
+    {
+        return nullptr;
+    }
+
+    /**
+     * Returns the number of writes to the associated backing store that have
+     * failed. Reported by the xtrctl <a href="xtrctl.html#metrics">metrics
+     * command</a>.
+     */
+    virtual std::size_t error_count() const noexcept
+    {
+        return 0;
+    }
+
     virtual ~storage_interface() = default;
 };
 
@@ -21,12 +21,17 @@
 #ifndef XTR_LOG_MACROS_HPP
 #define XTR_LOG_MACROS_HPP
 
+#include "config.hpp"
 #include "detail/clock_ids.hpp"
 #include "detail/get_time.hpp"
+#include "detail/log_site.hpp"
+#include "detail/rate_limit.hpp"
 #include "detail/string.hpp"
 #include "detail/tags.hpp"
 #include "detail/tsc.hpp"
+#include "interned.hpp"
 #include "nocopy.hpp"
+#include "sso.hpp"
 #include "streamed.hpp"
 #include "vcopy.hpp"
 
@@ -71,7 +76,9 @@
  * xtr::sink::sync is invoked, then the program is terminated via abort(3).
  *
  * @note Log statements with the 'debug' level can be disabled at build time by
- * defining @ref XTR_NDEBUG.
+ * defining @ref XTR_NDEBUG. Log statements with lower importance than a given
+ * level can be removed at build time by defining @ref XTR_MIN_LEVEL or @ref
+ * XTR_MODULE_LEVEL.
  */
 #define XTR_LOGL(LEVEL, SINK, ...) \
     XTR_LOGL_TAGS(void(), LEVEL, SINK, __VA_ARGS__)
@@ -290,35 +297,271 @@
 #define XTR_TRY_LOGL_TSC(LEVEL, SINK, ...) \
     XTR_TRY_LOGL_TS(LEVEL, SINK, xtr::detail::tsc::now(), __VA_ARGS__)
 
+/**
+ * Thread sink log macro, logs the specified format string and arguments to the
+ * calling thread's sink for the given logger, blocking if the sink is full. The
+ * sink is created on first use by each thread and closed when the thread
+ * exits\---please see @ref xtr::logger::thread_sink for details. Timestamps
+ * are read in the same way as for @ref XTR_LOG. This macro will log regardless
+ * of the sink's log level. To use a thread sink with the other macro families,
+ * pass the result of @ref xtr::logger::thread_sink as the SINK argument, for
+ * example XTR_LOG_TSC(log.thread_sink(), "Hello").
+ *
+ * @param LOGGER: The @ref xtr::logger to log to.
+ */
+#define XTR_LOG_TLS(LOGGER, ...) XTR_LOG((LOGGER).thread_sink(), __VA_ARGS__)
+
+/**
+ * Log level variant of @ref XTR_LOG_TLS. If the specified log level has lower
+ * importance than the log level of the calling thread's sink, then the message
+ * is dropped (please see the <a href="guide.html#log-levels">log levels</a>
+ * section of the user guide for details).
+ *
+ * @param LEVEL: The unqualified log level name, for example simply "info" or "error".
+ *
+ * @param LOGGER: The @ref xtr::logger to log to.
+ */
+#define XTR_LOGL_TLS(LEVEL, LOGGER, ...)                        \
+    (__extension__({                                            \
+        if constexpr (                                          \
+            XTR_LEVEL_ENABLED(LEVEL) ||                         \
+            xtr::log_level_t::LEVEL == xtr::log_level_t::fatal) \
+        {                                                       \
+            xtr::sink& xtr_tls_sink = (LOGGER).thread_sink();   \
+            XTR_LOGL(LEVEL, xtr_tls_sink, __VA_ARGS__);         \
+        }                                                       \
+    }))
+
+/**
+ * Non-blocking variant of @ref XTR_LOG_TLS. The message will be discarded if
+ * the sink is full. If a message is dropped a warning will appear in the log.
+ *
+ * @param LOGGER: The @ref xtr::logger to log to.
+ */
+#define XTR_TRY_LOG_TLS(LOGGER, ...) \
+    XTR_TRY_LOG((LOGGER).thread_sink(), __VA_ARGS__)
+
+/**
+ * Non-blocking variant of @ref XTR_LOGL_TLS. The message will be discarded if
+ * the sink is full. If a message is dropped a warning will appear in the log.
+ *
+ * @param LEVEL: The unqualified log level name, for example simply "info" or "error".
+ *
+ * @param LOGGER: The @ref xtr::logger to log to.
+ */
+#define XTR_TRY_LOGL_TLS(LEVEL, LOGGER, ...)                    \
+    (__extension__({                                            \
+        if constexpr (                                          \
+            XTR_LEVEL_ENABLED(LEVEL) ||                         \
+            xtr::log_level_t::LEVEL == xtr::log_level_t::fatal) \
+        {                                                       \
+            xtr::sink& xtr_tls_sink = (LOGGER).thread_sink();   \
+            XTR_TRY_LOGL(LEVEL, xtr_tls_sink, __VA_ARGS__);     \
+        }                                                       \
+    }))
+
+/**
+ * Rate limited log macro, logs the specified format string and arguments to
+ * the given sink on the first and then every Nth call, blocking if the sink is
+ * full. Calls are counted per call site and across all threads. The number of
+ * calls suppressed since the previous message is appended to each message, for
+ * example "(9 suppressed)". This macro will log regardless of the sink's log
+ * level.
+ *
+ * @param SINK: The @ref xtr::sink to log to.
+ *
+ * @param N: The interval, in calls, between logged messages.
+ */
+#define XTR_LOG_EVERY_N(SINK, N, ...) XTR_LOGL_EVERY_N(info, SINK, N, __VA_ARGS__)
+
+/**
+ * Log level variant of @ref XTR_LOG_EVERY_N. If the specified log level has
+ * lower importance than the log level of the sink, then the message is dropped
+ * (please see the <a href="guide.html#log-levels">log levels</a> section of the
+ * user guide for details). Calls are counted regardless of the log level.
+ *
+ * @param LEVEL: The unqualified log level name, for example simply "info" or
+ * "error". The 'fatal' level cannot be used, as fatal statements must always
+ * terminate the program.
+ *
+ * @param SINK: The @ref xtr::sink to log to.
+ *
+ * @param N: The interval, in calls, between logged messages.
+ */
+#define XTR_LOGL_EVERY_N(LEVEL, SINK, N, ...) \
+    XTR_LOGL_LIMIT(xtr::detail::every_n_limiter, N, LEVEL, SINK, __VA_ARGS__)
+
+/**
+ * Rate limited log macro, logs the specified format string and arguments to
+ * the given sink on the first N calls only, blocking if the sink is full. Calls
+ * are counted per call site and across all threads. This macro will log
+ * regardless of the sink's log level.
+ *
+ * @param SINK: The @ref xtr::sink to log to.
+ *
+ * @param N: The number of calls to log.
+ */
+#define XTR_LOG_FIRST_N(SINK, N, ...) XTR_LOGL_FIRST_N(info, SINK, N, __VA_ARGS__)
+
+/**
+ * Log level variant of @ref XTR_LOG_FIRST_N. If the specified log level has
+ * lower importance than the log level of the sink, then the message is dropped
+ * (please see the <a href="guide.html#log-levels">log levels</a> section of the
+ * user guide for details). Calls are counted regardless of the log level.
+ *
+ * @param LEVEL: The unqualified log level name, for example simply "info" or
+ * "error". The 'fatal' level cannot be used, as fatal statements must always
+ * terminate the program.
+ *
+ * @param SINK: The @ref xtr::sink to log to.
+ *
+ * @param N: The number of calls to log.
+ */
+#define XTR_LOGL_FIRST_N(LEVEL, SINK, N, ...) \
+    XTR_LOGL_LIMIT(xtr::detail::first_n_limiter, N, LEVEL, SINK, __VA_ARGS__)
+
+/**
+ * Rate limited log macro, logs the specified format string and arguments to
+ * the given sink at most once every MS milliseconds, blocking if the sink is
+ * full. The interval is measured per call site and across all threads using the
+ * CPU timestamp counter. The number of calls suppressed since the previous
+ * message is appended to each message, for example "(9 suppressed)". This
+ * macro will log regardless of the sink's log level.
+ *
+ * @param SINK: The @ref xtr::sink to log to.
+ *
+ * @param MS: The minimum interval, in milliseconds, between logged messages.
+ */
+#define XTR_LOG_EVERY_MS(SINK, MS, ...) \
+    XTR_LOGL_EVERY_MS(info, SINK, MS, __VA_ARGS__)
+
+/**
+ * Log level variant of @ref XTR_LOG_EVERY_MS. If the specified log level has
+ * lower importance than the log level of the sink, then the message is dropped
+ * (please see the <a href="guide.html#log-levels">log levels</a> section of the
+ * user guide for details). Calls are counted regardless of the log level.
+ *
+ * @param LEVEL: The unqualified log level name, for example simply "info" or
+ * "error". The 'fatal' level cannot be used, as fatal statements must always
+ * terminate the program.
+ *
+ * @param SINK: The @ref xtr::sink to log to.
+ *
+ * @param MS: The minimum interval, in milliseconds, between logged messages.
+ */
+#define XTR_LOGL_EVERY_MS(LEVEL, SINK, MS, ...) \
+    XTR_LOGL_LIMIT(xtr::detail::every_ms_limiter, MS, LEVEL, SINK, __VA_ARGS__)
+
+/**
+ * Sampled log macro, logs the specified format string and arguments to the
+ * given sink with probability P, blocking if the sink is full. The number of
+ * calls suppressed since the previous message is appended to each message, for
+ * example "(9 suppressed)". This macro will log regardless of the sink's log
+ * level.
+ *
+ * @param SINK: The @ref xtr::sink to log to.
+ *
+ * @param P: The probability, between 0 and 1, that a call is logged.
+ */
+#define XTR_LOG_SAMPLED(SINK, P, ...) XTR_LOGL_SAMPLED(info, SINK, P, __VA_ARGS__)
+
+/**
+ * Log level variant of @ref XTR_LOG_SAMPLED. If the specified log level has
+ * lower importance than the log level of the sink, then the message is dropped
+ * (please see the <a href="guide.html#log-levels">log levels</a> section of the
+ * user guide for details). Calls are counted regardless of the log level.
+ *
+ * @param LEVEL: The unqualified log level name, for example simply "info" or
+ * "error". The 'fatal' level cannot be used, as fatal statements must always
+ * terminate the program.
+ *
+ * @param SINK: The @ref xtr::sink to log to.
+ *
+ * @param P: The probability, between 0 and 1, that a call is logged.
+ */
+#define XTR_LOGL_SAMPLED(LEVEL, SINK, P, ...) \
+    XTR_LOGL_LIMIT(xtr::detail::sampled_limiter, P, LEVEL, SINK, __VA_ARGS__)
+
 #define XTR_XSTR(s) XTR_STR(s)
 #define XTR_STR(s)  #s
 
-#define XTR_LOGL_TAGS(TAGS, LEVEL, SINK, ...)                                            \
-    (__extension__({                                                                     \
-        if constexpr (xtr::log_level_t::LEVEL != xtr::log_level_t::debug || !XTR_NDEBUG) \
-        {                                                                                \
-            if ((SINK).level() >= xtr::log_level_t::LEVEL)                               \
-                XTR_LOG_TAGS(TAGS, LEVEL, SINK, __VA_ARGS__);                            \
-            if constexpr (xtr::log_level_t::LEVEL == xtr::log_level_t::fatal)            \
-            {                                                                            \
-                (SINK).sync();                                                           \
-                std::abort();                                                            \
-            }                                                                            \
-        }                                                                                \
+// True if log statements with the given level are compiled in, see
+// XTR_MIN_LEVEL and XTR_MODULE_LEVEL in config.hpp
+#define XTR_LEVEL_ENABLED(LEVEL)                                      \
+    (xtr::log_level_t::LEVEL <= xtr::log_level_t::XTR_MODULE_LEVEL && \
+     (xtr::log_level_t::LEVEL != xtr::log_level_t::debug || !XTR_NDEBUG))
+
+// Fatal statements still terminate the program if removed by XTR_MIN_LEVEL
+#define XTR_LOGL_TAGS(TAGS, LEVEL, SINK, ...) \
+    XTR_LOGL_TAGS_SUFFIX(TAGS, LEVEL, "", SINK, __VA_ARGS__)
+
+// SUFFIX is appended to the format string after FORMAT, for fields that are
+// added to the statement's own arguments, see XTR_LOGL_LIMIT.
+#define XTR_LOGL_TAGS_SUFFIX(TAGS, LEVEL, SUFFIX, SINK, ...)                      \
+    (__extension__({                                                              \
+        if constexpr (XTR_LEVEL_ENABLED(LEVEL))                                   \
+        {                                                                         \
+            XTR_LOG_SITE(TAGS, LEVEL, SUFFIX, (SINK).level(), SINK, __VA_ARGS__); \
+        }                                                                         \
+        if constexpr (xtr::log_level_t::LEVEL == xtr::log_level_t::fatal)         \
+        {                                                                         \
+            (SINK).sync();                                                        \
+            std::abort();                                                         \
+        }                                                                         \
     }))
 
+// The suppressed count is passed after the statement's arguments and
+// formatted by a '{}' suffix, so the statement's format string is unchanged
+#define XTR_LOGL_LIMIT(LIMITER, LIMIT, LEVEL, SINK, ...) \
+    (__extension__({ XTR_LOGL_LIMIT_IMPL(LIMITER, LIMIT, LEVEL, SINK, __VA_ARGS__); }))
+
+#define XTR_LOGL_LIMIT_IMPL(LIMITER, LIMIT, LEVEL, SINK, FORMAT, ...) \
+    static_assert(                                                    \
+        xtr::log_level_t::LEVEL != xtr::log_level_t::fatal,           \
+        "Rate limited log statements cannot be fatal");               \
+    if constexpr (XTR_LEVEL_ENABLED(LEVEL))                           \
+    {                                                                 \
+        static LIMITER xtr_limiter;                                   \
+        if (const auto xtr_admission = xtr_limiter.admit(LIMIT))      \
+            XTR_LOGL_TAGS_SUFFIX(                                     \
+                void(),                                               \
+                LEVEL,                                                \
+                "{}",                                                 \
+                SINK,                                                 \
+                FORMAT,                                               \
+                __VA_ARGS__ __VA_OPT__(, ) xtr_admission.suppressed); \
+    }
+
 #define XTR_LOG_TAGS(TAGS, LEVEL, SINK, ...) \
-    (__extension__({ XTR_LOG_TAGS_IMPL(TAGS, LEVEL, SINK, __VA_ARGS__); }))
+    (__extension__({ XTR_LOG_SITE(TAGS, LEVEL, "", xtr::log_level_t::debug, SINK, __VA_ARGS__); }))
+
+// Checks the statement's site (see detail/log_site.hpp) before logging, which
+// is registered at start-up so that it can be enabled or disabled by xtrctl.
+// SINK_LEVEL is the sink's level for log level macros and 'debug' otherwise.
+#define XTR_LOG_SITE(TAGS, LEVEL, SUFFIX, SINK_LEVEL, SINK, FORMAT, ...) \
+    if (xtr::detail::get_log_site<decltype([] {                          \
+            return xtr::detail::log_site_info{                           \
+                __FILE__ + (xtr::detail::rindex(__FILE__, '/') + 1),     \
+                __LINE__,                                                \
+                xtr::log_level_t::LEVEL,                                 \
+                FORMAT};                                                 \
+        })>().admits(SINK_LEVEL))                                        \
+        XTR_LOG_TAGS_IMPL(TAGS, LEVEL, SUFFIX, SINK, FORMAT __VA_OPT__(, ) __VA_ARGS__)
 
 // '{}{} {} ' in the format string is for the level, timestamp and sink name
-#define XTR_LOG_TAGS_IMPL(TAGS, LEVEL, SINK, FORMAT, ...)                                   \
+#define XTR_LOG_TAGS_IMPL(TAGS, LEVEL, SUFFIX, SINK, FORMAT, ...)                           \
     (__extension__({                                                                        \
+        static_assert(                                                                      \
+            !xtr::detail::uses_manual_indexing(FORMAT),                                     \
+            "Log format strings must use automatic argument indexing, e.g. {} not {0}");    \
         static constexpr auto xtr_fmt =                                                     \
             xtr::detail::string{"{}{} {} "} +                                               \
             xtr::detail::rcut<xtr::detail::rindex(__FILE__, '/') + 1>(__FILE__) +           \
             xtr::detail::string{":"} +                                                      \
-            xtr::detail::string{XTR_XSTR(__LINE__) ": " FORMAT "\n"};                       \
+            xtr::detail::string{XTR_XSTR(__LINE__) ": " FORMAT SUFFIX "\n"};                \
+        using xtr::interned;                                                                \
         using xtr::nocopy;                                                                  \
+        using xtr::sso;                                                                     \
         using xtr::streamed_copy;                                                           \
         using xtr::streamed_ref;                                                            \
         using xtr::vcopy;                                                                   \
@@ -23,10 +23,12 @@
 
 #include "command_path.hpp"
 #include "detail/consumer.hpp"
+#include "detail/throw.hpp"
 #include "detail/tsc.hpp"
 #include "io/fd_storage.hpp"
 #include "io/storage_interface.hpp"
 #include "log_level.hpp"
+#include "mpsc_sink.hpp"
 #include "pump_io_stats.hpp"
 #include "sink.hpp"
 
@@ -34,10 +36,12 @@
 #include <chrono>
 #include <cstdio>
 #include <ctime>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <thread>
 #include <utility>
+#include <vector>
 
 #include <stdio.h>
 
@@ -50,7 +54,7 @@ namespace xtr
      */
     enum class option_flags_t
     {
-        none,
+        none = 0,
         /**
          * Disables the background worker thread. Users must call @ref
          * logger::pump_io to process log messages.
@@ -67,8 +71,88 @@ namespace xtr
          * @warning See notes attached to @ref logger::pump_io on shutting the
          * logger down when this option is enabled.
          */
-        disable_worker_thread
+        disable_worker_thread = 1 << 0,
+        /**
+         * Writes log records in a compact binary format instead of text.
+         * Formatting of log statements is deferred to the <a
+         * href="xtrdecode.html">xtrdecode</a> tool, which converts binary logs
+         * back into text. Statements with arguments of types that the binary
+         * format cannot represent (such as user defined types) are formatted
+         * by the logger as usual and stored as text records within the binary
+         * log. Please see the <a href="guide.html#binary-logs">binary logs</a>
+         * section of the user guide for details.
+         */
+        binary_format = 1 << 1,
+        /**
+         * While there are no log messages to process the background thread
+         * pauses for exponentially increasing periods (up to approximately
+         * 1024 `pause` instructions on x86) between checks of each sink,
+         * reducing power consumption and contention with hyper-threads.
+         * Wake up latency is increased by at most the length of one period.
+         *
+         * Only one of @ref idle_backoff, @ref idle_sleep and @ref
+         * idle_umwait may be passed. If none are passed then the background
+         * thread continuously polls sinks, which minimises latency but fully
+         * occupies one CPU core.
+         */
+        idle_backoff = 1 << 2,
+        /**
+         * The background thread sleeps (via a futex on Linux) after a short
+         * period without log messages to process, so that an idle logger
+         * consumes no CPU time. Producers check whether the background thread
+         * is sleeping after writing to a sink and wake it if so, which
+         * requires a system call; while the background thread is awake
+         * producers do not make any system calls. Commands sent via <a
+         * href="xtrctl.html">xtrctl</a> may be delayed by up to 100ms while
+         * the background thread is sleeping.
+         */
+        idle_sleep = 1 << 3,
+        /**
+         * The background thread waits in a low power state via the x86
+         * WAITPKG `umwait` instruction after a short period without log
+         * messages to process, and is woken by producers in the same way as
+         * @ref idle_sleep but without any system calls. Each wait lasts for at
+         * most approximately 100 microseconds. If the CPU does not support
+         * WAITPKG then this option behaves the same as @ref idle_backoff.
+         */
+        idle_umwait = 1 << 4,
+        /**
+         * Publishes statistics for each sink to a shared memory region that
+         * may be mapped by <a href="xtrctl.html#shared-statistics">xtrctl
+         * stats</a>, so that statistics can be read without a round trip to
+         * the background thread. Statistics are updated whenever the
+         * background thread reads a sink.
+         */
+        shared_stats = 1 << 5
     };
+
+    constexpr option_flags_t operator|(option_flags_t a, option_flags_t b) noexcept
+    {
+        return option_flags_t(int(a) | int(b));
+    }
+
+    constexpr option_flags_t operator&(option_flags_t a, option_flags_t b) noexcept
+    {
+        return option_flags_t(int(a) & int(b));
+    }
+}
+
+namespace xtr::detail
+{
+    // Caches the sink most recently returned by logger::thread_sink for the
+    // calling thread, so that the fast path is a single comparison. The sinks
+    // themselves are owned by a registry in logger.cpp. This struct is kept
+    // trivially destructible so that accessing it does not require a TLS
+    // initialization guard.
+    struct thread_sink_cache
+    {
+        const logger* owner;
+        sink* s;
+        // Set once the calling thread's registry has been destroyed
+        bool exited;
+    };
+
+    inline thread_local thread_sink_cache tls_sink_cache{};
 }
 
 /**
@@ -128,7 +212,8 @@ public:
      * log statement\---please refer to the @ref log_level_style_t documentation
      * for details.
      *
-     * @param options: Logger options, see @ref option_flags_t.
+     * @param options: Logger options, see @ref option_flags_t. Options may be
+     * combined using operator|.
      */
     template<typename Clock = std::chrono::system_clock>
     explicit logger(
@@ -259,25 +344,113 @@ public:
         std::string command_path = default_command_path(),
         log_level_style_t level_style = default_log_level_style,
         option_flags_t options = option_flags_t::none) :
-        consumer_(
-            detail::buffer(std::move(storage), level_style),
-            &control_,
+        logger(
+            storage_list(std::move(storage)),
+            std::forward<Clock>(clock),
             std::move(command_path),
-            make_clock(std::forward<Clock>(clock)))
+            level_style,
+            options)
+    {
+    }
+
+    /**
+     * Sharded back-end constructor. One consumer thread (a shard) is created
+     * for each storage object, and each shard formats the log records of its
+     * own subset of sinks and writes them to its own storage. This allows the
+     * formatting and I/O of a logger with many busy sinks to be spread over
+     * several cores. Sinks are assigned to shards by hashing the sink name,
+     * or explicitly via the shard argument of @ref get_sink. Records written
+     * to sinks on different shards are not ordered with respect to each
+     * other.
+     *
+     * Commands sent via <a href="xtrctl.html">xtrctl</a> are received by the
+     * first shard. The status and level commands apply to the sinks of all
+     * shards, and the reopen command reopens the storage of all shards.
+     *
+     * @param storages: One or more unique pointers to objects implementing
+     * the @ref storage_interface interface, such as separate files created
+     * via @ref make_fd_storage. Each storage object is only accessed by the
+     * consumer thread of its shard.
+     *
+     * @param clock: Please refer to the @ref clock_arg "description" above.
+     * Each shard reads the time from its own copy of the clock, so the clock
+     * must be copyable if more than one storage object is passed.
+     *
+     * @param command_path: Please refer to the @ref command_path_arg "description" above.
+     *
+     * @param level_style: The log level style that will be used to prefix each
+     * log statement\---please refer to the @ref log_level_style_t documentation for details.
+     *
+     * @param options: Logger options, see @ref option_flags_t. The options
+     * apply to every shard.
+     */
+    template<typename Clock = std::chrono::system_clock>
+    explicit logger(
+        std::vector<storage_interface_ptr> storages,
+        Clock&& clock = Clock(),
+        std::string command_path = default_command_path(),
+        log_level_style_t level_style = default_log_level_style,
+        option_flags_t options = option_flags_t::none)
     {
-        if (options != option_flags_t::disable_worker_thread)
+        if (storages.empty()) [[unlikely]]
+            detail::throw_invalid_argument("No storage given for logger");
+
+        // All shards publish to the same region, which is passed to xtrctl by
+        // the first shard
+        std::shared_ptr<detail::shared_stats> stats;
+        if ((options & option_flags_t::shared_stats) != option_flags_t::none)
+            stats = std::make_shared<detail::shared_stats>();
+
+#if __cpp_exceptions
+        try
+        {
+#endif
+            for (std::size_t i = 0; i != storages.size(); ++i)
+            {
+                // Commands are only processed by the first shard
+                shards_.push_back(std::make_unique<consumer_shard>(
+                    detail::buffer(
+                        std::move(storages[i]),
+                        level_style,
+                        (options & option_flags_t::binary_format) !=
+                            option_flags_t::none),
+                    i == 0 ? std::move(command_path) : std::string(null_command_path),
+                    i + 1 == storages.size() ? make_clock(std::forward<Clock>(clock))
+                                             : make_clock(clock),
+                    make_idle_strategy(options),
+                    stats));
+                if (i != 0)
+                    shards_.front()->consumer.add_shard(shards_.back()->consumer);
+            }
+
+            for (auto& s : shards_)
+            {
+                if ((options & option_flags_t::disable_worker_thread) ==
+                    option_flags_t::none)
+                {
+                    // Consumer threads must be started after all shards have
+                    // been constructed, as the first shard's consumer reads
+                    // the others.
+                    s->thread = jthread(&detail::consumer::run, &s->consumer);
+                }
+                // Passing the control sink to the consumer is equivalent to
+                // calling register_sink, so mark it as open.
+                s->control.open_ = true;
+            }
+
+            // On some CPUs the TSC frequency is obtained by estimation.
+            // get_tsc_hz is called here to force the estimation to run here
+            // rather than on the consumer thread, in order to prevent the
+            // consumer thread from stalling while the estimation runs.
+            (void)detail::get_tsc_hz();
+#if __cpp_exceptions
+        }
+        catch (...)
         {
-            // The consumer thread must be started after control_ has been constructed
-            consumer_thread_ = jthread(&detail::consumer::run, &consumer_);
+            abandon_shards();
+            throw;
         }
-        // Passing control_ to the consumer is equivalent to calling
-        // register_sink, so mark it as open.
-        control_.open_ = true;
-        // On some CPUs the TSC frequency is obtained by estimation. get_tsc_hz
-        // is called here to force the estimation to run here rather than on the
-        // consumer thread, in order to prevent the consumer thread from
-        // stalling while the estimation runs.
-        (void)detail::get_tsc_hz();
+#endif
     }
 
     /**
@@ -287,26 +460,97 @@ public:
      * block until all connected sinks disconnect from the logger. If the consumer
      * thread has been disabled via @ref option_flags_t::disable_worker_thread
      * then the destructor will similarly block until @ref logger::pump_io returns false.
+     *
+     * If the calling thread has a thread sink (see @ref thread_sink) then it
+     * is closed by the destructor. Thread sinks belonging to other threads
+     * are closed when those threads exit or call @ref close_thread_sink.
      */
-    ~logger() = default;
+    ~logger();
+
+    /**
+     * Passed as the shard argument of @ref get_sink and @ref register_sink to
+     * select the shard by hashing the sink name.
+     */
+    static constexpr std::size_t any_shard = std::size_t(-1);
+
+    /**
+     * Returns the native handle for the consumer thread of the given shard.
+     * This may be used for setting thread affinities or other thread
+     * attributes.
+     */
+    std::thread::native_handle_type consumer_thread_native_handle(std::size_t shard = 0)
+    {
+        return shards_[shard]->thread.native_handle();
+    }
 
     /**
-     * Returns the native handle for the logger's consumer thread. This may be
-     * used for setting thread affinities or other thread attributes.
+     * Returns the number of shards (consumer threads), equal to the number of
+     * storage objects passed to @ref logger::logger.
      */
-    std::thread::native_handle_type consumer_thread_native_handle()
+    std::size_t shard_count() const noexcept
     {
-        return consumer_thread_.native_handle();
+        return shards_.size();
     }
 
+    /**
+     * Sets the CPU affinity of the consumer thread of the given shard, or of
+     * the thread calling @ref pump_io if the @ref
+     * option_flags_t::disable_worker_thread option is enabled. The affinity
+     * is set by the consumer thread itself, so this function blocks until
+     * the consumer thread has processed the request.
+     *
+     * @param cpus: The CPUs that the thread may run on.
+     *
+     * @param shard: The index of the shard, see @ref shard_count.
+     *
+     * @throws std::system_error if the affinity could not be set, e.g. if
+     * none of the CPUs are available to the process.
+     */
+    void set_consumer_affinity(std::vector<int> cpus, std::size_t shard = 0);
+
+    /**
+     * Sets the scheduling policy and priority of the consumer thread of the
+     * given shard, see pthread_setschedparam(3). As with @ref
+     * set_consumer_affinity the change is made by the consumer thread itself.
+     *
+     * @param policy: The scheduling policy, e.g. SCHED_FIFO or SCHED_OTHER.
+     *
+     * @param priority: The static priority, which must be zero for
+     * SCHED_OTHER.
+     *
+     * @param shard: The index of the shard, see @ref shard_count.
+     *
+     * @throws std::system_error if the policy could not be set, e.g. due to
+     * the process lacking CAP_SYS_NICE for real-time policies.
+     */
+    void set_consumer_scheduling(int policy, int priority, std::size_t shard = 0);
+
     /**
      * Creates a sink with the specified name. Note that each call to this
      * function creates a new sink; if repeated calls are made with the same
      * name, separate sinks with the name name are created.
      *
      * @param name: The name for the given sink.
+     *
+     * @param capacity: The minimum capacity (in bytes) of the sink's queue.
+     * The capacity is rounded up to a power of two that is at least the
+     * system page size, and may be at most 2GiB. Sinks that log in large
+     * bursts benefit from a larger capacity, while a small capacity reduces
+     * the memory used by programs with many sinks. The actual capacity may be
+     * obtained via @ref sink::capacity.
+     *
+     * @param flags: Options for allocating the sink's queue, such as using
+     * huge pages or locking it into memory, see @ref sink_flags_t.
+     *
+     * @param shard: The shard that will consume the sink, modulo @ref
+     * shard_count. By default the shard is selected by hashing the sink
+     * name. Ignored if the logger has a single shard.
      */
-    [[nodiscard]] sink get_sink(std::string name);
+    [[nodiscard]] sink get_sink(
+        std::string name,
+        std::size_t capacity = XTR_SINK_CAPACITY,
+        sink_flags_t flags = sink_flags_t::none,
+        std::size_t shard = any_shard);
 
     /**
      * Registers the sink with the logger. Note that the sink name does not need
@@ -317,13 +561,76 @@ public:
      *
      * @param name: The name for the given sink.
      *
+     * @param shard: The shard that will consume the sink, see @ref get_sink.
+     *
+     * @pre The sink must be closed.
+     */
+    void register_sink(sink& s, std::string name, std::size_t shard = any_shard) noexcept;
+
+    /**
+     * Creates a multi-producer sink with the specified name, see @ref
+     * mpsc_sink. As with @ref get_sink, each call creates a new sink.
+     *
+     * @param name: The name for the given sink.
+     *
+     * @param capacity: The minimum capacity (in bytes) of the sink's queue,
+     * see @ref get_sink.
+     *
+     * @param flags: Options for allocating the sink's queue, see @ref
+     * sink_flags_t.
+     *
+     * @param shard: The shard that will consume the sink, see @ref get_sink.
+     */
+    [[nodiscard]] mpsc_sink get_mpsc_sink(
+        std::string name,
+        std::size_t capacity = XTR_SINK_CAPACITY,
+        sink_flags_t flags = sink_flags_t::none,
+        std::size_t shard = any_shard);
+
+    /**
+     * Registers the multi-producer sink with the logger, see @ref
+     * register_sink.
+     *
      * @pre The sink must be closed.
      */
-    void register_sink(sink& s, std::string name) noexcept;
+    void register_sink(
+        mpsc_sink& s, std::string name, std::size_t shard = any_shard) noexcept;
+
+    /**
+     * Returns the calling thread's sink for this logger. The sink is created
+     * and registered on the first call made by each thread, and is closed
+     * when the thread exits, so sinks need not be passed around or stored by
+     * the caller. Thread sinks are named "thread-<tid>" where tid is the
+     * operating system thread id; the name may be changed via @ref
+     * sink::set_name. After the first call this function only performs a
+     * thread-local comparison. The @ref XTR_LOG_TLS family of macros log to
+     * the sink returned by this function.
+     *
+     * @note The returned reference is valid until the thread exits or calls
+     * @ref close_thread_sink. It must not be used by other threads.
+     */
+    sink& thread_sink()
+    {
+        const detail::thread_sink_cache& cache = detail::tls_sink_cache;
+        if (cache.owner == this) [[likely]]
+            return *cache.s;
+        return make_thread_sink();
+    }
+
+    /**
+     * Closes the calling thread's sink for this logger, if one has been
+     * created by @ref thread_sink. A subsequent call to @ref thread_sink will
+     * create a new sink. This is useful for long-lived threads (such as
+     * those belonging to a thread pool) which would otherwise prevent the
+     * logger from being destroyed, as @ref logger::~logger blocks until all
+     * sinks have been closed.
+     */
+    void close_thread_sink();
 
     /**
      * Sets the logger command path\---please refer to the 'command_path'
-     * argument @ref command_path_arg "description" above for details.
+     * argument @ref command_path_arg "description" above for details. Commands
+     * are always received by the first shard.
      */
     void set_command_path(std::string path) noexcept;
 
@@ -333,6 +640,49 @@ public:
      */
     void set_log_level_style(log_level_style_t level_style) noexcept;
 
+    /**
+     * Sets the number of threads used to format log records in addition to
+     * the consumer thread (or, if the logger has more than one shard, the
+     * consumer thread of each shard). Records from different sinks are then
+     * formatted in parallel, and are written to the log in the same order as
+     * they would be without the additional threads, except that records
+     * logged to a sink after a command (such as @ref sink::sync or @ref
+     * sink::close) may be written after records read from other sinks at the
+     * same time. Records written to the same sink are always formatted by the
+     * same thread, so a single busy sink does not benefit. Passing zero (the
+     * default) stops the threads.
+     * Ignored if the @ref option_flags_t::binary_format option is enabled.
+     *
+     * @note <a href="guide.html#custom-formatters">Custom formatters</a> may
+     * be invoked concurrently on different threads if format threads are in
+     * use.
+     *
+     * @throws std::system_error if the threads could not be started, in which
+     * case the threads of each shard are left unchanged.
+     */
+    void set_format_threads(std::size_t n);
+
+    /**
+     * Enables writing log records in timestamp order. By default records are
+     * written in the order that they are read from sinks, so records from
+     * different sinks may be interleaved with timestamps going backwards. If
+     * a non-zero reorder window is set, then records are held by the consumer
+     * thread and released in timestamp order once the consumer's clock has
+     * passed their timestamp plus the window, or once all sinks are empty.
+     * The timestamp of a record logged via @ref XTR_LOG_TSC, @ref XTR_LOG_RTC,
+     * @ref XTR_LOG_TS or similar is the timestamp passed with the record,
+     * other records are given the time at which they were read. Records that
+     * are read later than the window after their timestamp may still be
+     * written out of order. Passing zero (the default) disables ordering.
+     * Ignored if the @ref option_flags_t::binary_format option is enabled,
+     * and disables format threads (see @ref set_format_threads).
+     *
+     * @note Ordering is only meaningful if the clock passed to @ref
+     * logger::logger is the system clock, as otherwise timestamps passed with
+     * records and the consumer's clock are not comparable.
+     */
+    void set_reorder_window(std::chrono::nanoseconds window) noexcept;
+
     /**
      * Sets the default log level. Sinks created via future calls to @ref
      * get_sink will be created with the given log level.
@@ -352,6 +702,9 @@ public:
      * more time for other tasks to run). See @ref XTR_USE_IO_URING for details
      * on enabling io_uring.
      *
+     * If the logger has more than one shard then each call to pump_io
+     * processes every shard in turn.
+     *
      * @return True if any sinks or the logger are still active, false if no
      * sinks are active and the logger has shut down. Once false has been
      * returned pump_io should not be called again.
@@ -364,13 +717,52 @@ public:
      */
     bool pump_io(pump_io_stats* stats = nullptr);
 
+    /**
+     * Returns statistics accumulated by the consumer thread(s) since the
+     * logger was constructed, along with the number of records read from and
+     * dropped by each open sink. Comparing @ref pump_io_stats::format_time
+     * with @ref pump_io_stats::io_time shows whether the consumer is limited
+     * by formatting or by I/O.
+     *
+     * Blocks until each consumer thread has collected its statistics, so if
+     * the @ref option_flags_t::disable_worker_thread option is enabled then
+     * @ref pump_io must be called by another thread.
+     */
+    io_stats get_io_stats();
+
 private:
-    template<typename Func>
-    void post(Func&& f)
+    // A consumer, its thread and the control sink used to send it commands
+    struct consumer_shard
     {
-        std::scoped_lock lock{control_mutex_};
-        control_.post(std::forward<Func>(f));
-    }
+        consumer_shard(
+            detail::buffer bf,
+            std::string command_path,
+            std::function<std::timespec()> clock,
+            detail::idle_strategy idle,
+            std::shared_ptr<detail::shared_stats> stats);
+
+        template<typename Func>
+        void post(Func&& f)
+        {
+            std::scoped_lock lock{control_mutex};
+            control.post(std::forward<Func>(f));
+        }
+
+        detail::consumer consumer;
+        jthread thread;
+        sink control;
+        std::mutex control_mutex;
+    };
+
+    static std::vector<storage_interface_ptr> storage_list(storage_interface_ptr storage);
+
+    // Stops the shards constructed so far if the constructor throws, as the
+    // destructor will not run
+    void abandon_shards() noexcept;
+
+    sink& make_thread_sink();
+
+    consumer_shard& select_shard(const std::string& name, std::size_t shard) noexcept;
 
     template<typename Clock>
     std::function<std::timespec()> make_clock(Clock&& clock)
@@ -386,10 +778,18 @@ private:
         };
     }
 
-    detail::consumer consumer_;
-    jthread consumer_thread_;
-    sink control_;
-    std::mutex control_mutex_;
+    static detail::idle_strategy make_idle_strategy(option_flags_t options) noexcept
+    {
+        if ((options & option_flags_t::idle_backoff) != option_flags_t::none)
+            return detail::idle_strategy::backoff;
+        if ((options & option_flags_t::idle_sleep) != option_flags_t::none)
+            return detail::idle_strategy::sleep;
+        if ((options & option_flags_t::idle_umwait) != option_flags_t::none)
+            return detail::idle_strategy::umwait;
+        return detail::idle_strategy::spin;
+    }
+
+    std::vector<std::unique_ptr<consumer_shard>> shards_;
     std::atomic<log_level_t> default_log_level_ = log_level_t::info;
 
     friend sink;
@@ -0,0 +1,100 @@
+// Copyright 2026 Chris E. Holloway
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef XTR_MPSC_SINK_HPP
+#define XTR_MPSC_SINK_HPP
+
+#include "detail/tags.hpp"
+#include "log_level.hpp"
+#include "sink.hpp"
+
+#include <cstddef>
+#include <string>
+#include <utility>
+
+namespace xtr
+{
+    class mpsc_sink;
+}
+
+/**
+ * Multi-producer log sink. Unlike @ref sink, a multi-producer sink may be
+ * written to by any number of threads concurrently, so a single sink may be
+ * shared by all threads of e.g. a thread pool rather than each thread requiring
+ * a sink (and queue) of its own. Threads reserve space in the sink's queue via
+ * an atomic increment, so threads logging to the same sink simultaneously will
+ * contend with one another; a sink per thread remains the fastest option for
+ * threads that log heavily.
+ *
+ * A multi-producer sink may be created by calling @ref logger::get_mpsc_sink,
+ * or by default construction followed by a call to @ref
+ * logger::register_sink. The XTR_LOG macros accept multi-producer sinks in the
+ * same way as they accept regular sinks.
+ *
+ * In addition to logging, @ref set_level, @ref level, @ref sync and @ref
+ * set_name may be called concurrently. @ref close may only be called once no
+ * other thread is using the sink. Multi-producer sinks cannot be copied.
+ */
+class xtr::mpsc_sink : private sink
+{
+public:
+    /**
+     * Constructs a closed multi-producer sink, see @ref sink::sink.
+     */
+    explicit mpsc_sink(
+        log_level_t level = log_level_t::info,
+        std::size_t capacity = XTR_SINK_CAPACITY,
+        sink_flags_t flags = sink_flags_t::none);
+
+    mpsc_sink(const mpsc_sink&) = delete;
+    mpsc_sink& operator=(const mpsc_sink&) = delete;
+
+    using sink::capacity;
+    using sink::close;
+    using sink::is_open;
+    using sink::level;
+    using sink::set_level;
+    using sink::set_name;
+    using sink::sync;
+
+    /**
+     * Logs the given format string and arguments, see @ref sink::log. May be
+     * called by multiple threads concurrently.
+     */
+    template<auto Format, auto Level, typename Tags = void(), typename... Args>
+    void log(Args&&... args) noexcept((XTR_NOTHROW_INGESTIBLE(Args, args) && ...))
+    {
+        sink::log<Format, Level, detail::add_tag_t<detail::multi_producer_tag, Tags>>(
+            std::forward<Args>(args)...);
+    }
+
+private:
+    mpsc_sink(
+        logger& owner,
+        std::string name,
+        log_level_t level,
+        std::size_t capacity,
+        sink_flags_t flags,
+        std::size_t shard);
+
+    friend logger;
+};
+
+#endif
@@ -1,15 +1,21 @@
 #ifndef XTR_PUMP_IO_STATS_HPP
 #define XTR_PUMP_IO_STATS_HPP
 
+#include <chrono>
 #include <cstddef>
+#include <string>
+#include <vector>
 
 namespace xtr
 {
     struct pump_io_stats;
+    struct sink_io_stats;
+    struct io_stats;
 }
 
 /**
- * Statistics struct yielded by @ref xtr::logger::pump_io.
+ * Statistics struct yielded by @ref xtr::logger::pump_io. Times are measured
+ * using the CPU's time stamp counter.
  */
 struct xtr::pump_io_stats
 {
@@ -18,6 +24,78 @@ struct xtr::pump_io_stats
      * construction and destruction events, sync requests etc.
      */
     std::size_t n_events;
+
+    /**
+     * Number of bytes of output produced by formatting log statements.
+     */
+    std::size_t n_bytes_formatted;
+
+    /**
+     * Number of bytes of output submitted to the storage interface, see
+     * @ref xtr::storage_interface::submit_buffer.
+     */
+    std::size_t n_bytes_submitted;
+
+    /**
+     * Number of log statements reported as dropped, see
+     * @ref xtr::sink_flags_t::drop_when_full.
+     */
+    std::size_t n_dropped;
+
+    /**
+     * Time spent reading and formatting log statements, excluding time spent
+     * in @ref io_time and @ref command_time. Time spent checking empty
+     * sinks while the logger is idle is not counted.
+     */
+    std::chrono::nanoseconds format_time;
+
+    /**
+     * Time spent submitting output to and flushing the storage interface.
+     */
+    std::chrono::nanoseconds io_time;
+
+    /**
+     * Time spent polling for and processing commands sent by
+     * <a href="xtrctl.html">xtrctl</a>.
+     */
+    std::chrono::nanoseconds command_time;
+};
+
+/**
+ * Statistics for an individual sink, see @ref xtr::io_stats.
+ */
+struct xtr::sink_io_stats
+{
+    /**
+     * The name of the sink.
+     */
+    std::string name;
+
+    /**
+     * Number of events read from the sink.
+     */
+    std::size_t n_records;
+
+    /**
+     * Number of log statements dropped by the sink.
+     */
+    std::size_t dropped_count;
+};
+
+/**
+ * Cumulative statistics returned by @ref xtr::logger::get_io_stats.
+ */
+struct xtr::io_stats
+{
+    /**
+     * Totals for all consumer threads since the logger was constructed.
+     */
+    pump_io_stats total;
+
+    /**
+     * Statistics for each open sink.
+     */
+    std::vector<sink_io_stats> sinks;
 };
 
 #endif
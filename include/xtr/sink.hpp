@@ -46,12 +46,129 @@
 namespace xtr
 {
     class sink;
+    class mpsc_sink;
     class logger;
 
     namespace detail
     {
         class consumer;
     }
+
+    /**
+     * Passed to @ref logger::get_sink to control how the memory used by a
+     * sink's queue is allocated. Flags may be combined using operator|.
+     */
+    enum class sink_flags_t
+    {
+        none = 0,
+        /**
+         * Backs the queue with huge pages in order to reduce TLB misses when
+         * logging and when the background thread reads the queue. Explicit
+         * huge pages (see the Linux hugetlbpage documentation) are used if
+         * the queue capacity is a multiple of the huge page size and enough
+         * huge pages have been reserved, otherwise transparent huge pages are
+         * requested via madvise(2). This flag is ignored on platforms other
+         * than Linux.
+         */
+        huge_pages = 1 << 0,
+        /**
+         * Locks the queue into memory via mlock(2), so that logging can never
+         * incur a major page fault. Creating the sink will fail with
+         * std::system_error if the memory cannot be locked, e.g. due to
+         * RLIMIT_MEMLOCK.
+         */
+        lock_memory = 1 << 1,
+        /**
+         * If the sink's queue is full then log statements (other than those
+         * made via the non-blocking XTR_TRY_LOG macros) spin for a short
+         * period waiting for the background thread to make space, then yield
+         * the CPU via std::this_thread::yield between further checks. This
+         * avoids a blocked thread stealing CPU time from the background thread
+         * if they share a core.
+         *
+         * Only one of @ref yield_when_full, @ref sleep_when_full and @ref
+         * drop_when_full may be passed. If none are passed then log
+         * statements spin until space is available.
+         */
+        yield_when_full = 1 << 2,
+        /**
+         * As @ref yield_when_full, except that after spinning the logging
+         * thread sleeps (via a futex on Linux) until it is woken by the
+         * background thread making space in the queue.
+         */
+        sleep_when_full = 1 << 3,
+        /**
+         * As @ref yield_when_full, except that after spinning the log
+         * statement is dropped, in the same way as for the XTR_TRY_LOG macros.
+         * Dropped statements are reported in the log by the background
+         * thread. Commands such as @ref sink::sync and @ref sink::set_name
+         * are never dropped, and yield while waiting for space instead.
+         */
+        drop_when_full = 1 << 4,
+        /**
+         * If the sink's queue is full then the oldest log statements in the
+         * queue are discarded to make space, so that logging never blocks and
+         * the most recent log statements are always kept, e.g. for a sink that
+         * records a high rate of debug messages. Discarded statements are
+         * reported in the log in the same way as dropped statements. Log
+         * statements with arguments that are not trivially destructible (such
+         * as std::string r-values, which are moved into the queue) cannot be
+         * discarded, if the oldest statement in the queue is such a statement
+         * then logging waits until the background thread has read it. This
+         * flag takes precedence over the other "when full" flags, and may not
+         * be passed when creating a multi-producer sink.
+         */
+        overwrite_oldest = 1 << 5,
+        /**
+         * Prefers to allocate the queue's memory on the NUMA node of the
+         * thread creating the sink (via mbind(2)), so that logging from a
+         * thread on that node does not access remote memory. Use @ref
+         * numa_node to request a particular node instead, e.g. for a sink
+         * created by one thread and used by another. Ignored on platforms
+         * other than Linux, on systems without NUMA support, and for queues
+         * backed by explicit huge pages (which are always allocated on the
+         * creating thread's node).
+         */
+        numa_local = 1 << 6,
+        /**
+         * Records the time that each log statement spends in the sink's queue
+         * (from being logged to being read by the background thread) in a
+         * histogram, which may be queried via the xtrctl <a
+         * href="xtrctl.html#latency">latency command</a>. Each statement
+         * written to the sink is prefixed with a 16-byte timestamp, and reads
+         * the time stamp counter when logged and when read.
+         */
+        measure_latency = 1 << 7
+    };
+
+    /**
+     * Returns flags for @ref logger::get_sink that prefer to allocate a sink's
+     * queue on the given NUMA node, see @ref sink_flags_t::numa_local. The
+     * result may be combined with other flags using operator|.
+     */
+    constexpr sink_flags_t numa_node(unsigned node) noexcept;
+
+    constexpr sink_flags_t operator|(sink_flags_t a, sink_flags_t b) noexcept
+    {
+        return sink_flags_t(int(a) | int(b));
+    }
+
+    constexpr sink_flags_t operator&(sink_flags_t a, sink_flags_t b) noexcept
+    {
+        return sink_flags_t(int(a) & int(b));
+    }
+
+    namespace detail
+    {
+        // The node requested via numa_node is stored in the flags above the
+        // named flags, offset by one so that zero means no node.
+        inline constexpr int sink_numa_node_shift = 16;
+    }
+
+    constexpr sink_flags_t numa_node(unsigned node) noexcept
+    {
+        return sink_flags_t(int(node + 1) << detail::sink_numa_node_shift);
+    }
 }
 
 // Returns true if the given value is nothrow `ingestible', i.e. the value can
@@ -88,12 +205,31 @@ private:
                                   std::string& name) noexcept;
 
 public:
-    explicit sink(log_level_t level = log_level_t::info);
+    class batch;
+
+    /**
+     * Constructs a closed sink, which may be opened by calling @ref
+     * logger::register_sink.
+     *
+     * @param level: The initial log level of the sink.
+     *
+     * @param capacity: The minimum capacity (in bytes) of the sink's queue,
+     * see @ref capacity. The capacity is rounded up to a power of two that is
+     * at least the system page size, and may be at most 2GiB.
+     *
+     * @param flags: Options for allocating the sink's queue, see @ref
+     * sink_flags_t.
+     */
+    explicit sink(
+        log_level_t level = log_level_t::info,
+        std::size_t capacity = XTR_SINK_CAPACITY,
+        sink_flags_t flags = sink_flags_t::none);
 
     /**
      * Sink copy constructor. When a sink is copied it is automatically
      * registered with the same logger object as the source sink, using the same
-     * sink name. The sink name may be modified by calling @ref set_name.
+     * sink name, queue capacity and flags. The sink name may be modified by
+     * calling @ref set_name.
      */
     sink(const sink& other);
 
@@ -102,6 +238,14 @@ public:
      * in order to disconnect it from any existing logger object and is then automatically
      * registered with the same logger object as the source sink, using the same
      * sink name. The sink name may be modified by calling @ref set_name.
+     *
+     * Unlike the copy constructor, assignment does not copy the source
+     * sink's queue capacity or flags: the sink keeps its own queue, along
+     * with the capacity and @ref sink_flags_t it was constructed with (so
+     * e.g. assigning from a sink created with @ref
+     * sink_flags_t::overwrite_oldest does not make this sink overwrite
+     * records). Use the copy constructor to create a sink with the same
+     * capacity and flags as another.
      */
     sink& operator=(const sink& other);
 
@@ -169,8 +313,9 @@ public:
 
     /**
      * Returns the capacity (in bytes) of the queue that the sink uses to send
-     * log data to the background thread. To override the sink capacity set @ref
-     * XTR_SINK_CAPACITY in xtr/config.hpp.
+     * log data to the background thread. The capacity may be specified when
+     * creating a sink via @ref logger::get_sink, otherwise it defaults to @ref
+     * XTR_SINK_CAPACITY (which may be overridden in xtr/config.hpp).
      */
     std::size_t capacity() const
     {
@@ -178,7 +323,13 @@ public:
     }
 
 private:
-    sink(logger& owner, std::string name, log_level_t level);
+    sink(
+        logger& owner,
+        std::string name,
+        log_level_t level,
+        std::size_t capacity,
+        sink_flags_t flags,
+        std::size_t shard);
 
     template<auto Format, auto Level, typename Tags = void()>
     void log_impl() noexcept;
@@ -196,9 +347,40 @@ private:
     void post_variable_len(Args&&... args) noexcept(
         (XTR_NOTHROW_INGESTIBLE(Args, args) && ...));
 
+    template<auto Format, auto Level, typename Tags, typename Lambda, typename... Args>
+    void post_variable_len_shared(Args&&... args) noexcept(
+        (XTR_NOTHROW_INGESTIBLE(Args, args) && ...));
+
     template<typename Func>
     void sync_post(Func func);
 
+    static constexpr std::size_t enqueue_time_size =
+        sizeof(fptr_t) + sizeof(detail::enqueue_time);
+
+    // Size of the enqueue time prefix written before each log record if
+    // Tags contains enqueue_time_tag and the sink measures latency, see
+    // write_prefix. This is decided at run time rather than by a tag so that
+    // each log statement is only instantiated once.
+    template<typename Tags>
+    std::size_t prefix_size() const noexcept
+    {
+        if constexpr (detail::is_enqueue_time_v<Tags>)
+            return prefix_size_;
+        else
+            return 0;
+    }
+
+    // Writes the prefix (if any) of the record at pos, whose own function
+    // pointer is fptr, and returns the function pointer to be written at pos.
+    // The record itself begins prefix_size<Tags>() bytes after pos.
+    template<typename Tags>
+    fptr_t write_prefix(std::byte* pos, fptr_t fptr) noexcept;
+
+    // Posts a command to the consumer, using the multi-producer path if this
+    // is a multi-producer sink.
+    template<typename Func>
+    void post_control(Func&& func);
+
     template<typename Tags, typename... Args>
     auto make_lambda(Args&&... args) noexcept(
         (XTR_NOTHROW_INGESTIBLE(Args, args) && ...));
@@ -212,12 +394,41 @@ private:
         return dropped_count_.exchange(0, std::memory_order_relaxed);
     }
 
-    using ring_buffer = detail::synchronized_ring_buffer<XTR_SINK_CAPACITY>;
+    // The capacity is chosen at run time, but as the ring buffer shadows its
+    // capacity on the writer's cache line (see wrcapacity) this costs no
+    // additional memory accesses when logging compared to a fixed capacity.
+    using ring_buffer = detail::synchronized_ring_buffer<detail::dynamic_capacity>;
 
-    static_assert(
-        XTR_SINK_CAPACITY <=
-            std::numeric_limits<decltype(detail::string_table_entry::size)>::max(),
-        "XTR_SINK_CAPACITY is too large");
+    // Capacities are rounded up to a power of two, and must fit into the
+    // size field of string table entries.
+    using string_size_limits =
+        std::numeric_limits<decltype(detail::string_table_entry::size)>;
+    static constexpr std::size_t max_capacity =
+        std::size_t{string_size_limits::max()} / 2 + 1;
+
+    static_assert(XTR_SINK_CAPACITY <= max_capacity, "XTR_SINK_CAPACITY is too large");
+
+    static std::size_t checked_capacity(std::size_t capacity);
+
+    static int mirror_flags(sink_flags_t flags) noexcept;
+
+    // Records that may not be discarded by sinks in overwrite mode, either
+    // because they are commands (which the consumer must receive), or because
+    // discarding them would skip destructors.
+    template<typename Tags, typename Func>
+    static constexpr bool is_pinned =
+        !detail::is_droppable_v<Tags> || !std::is_trivially_destructible_v<Func>;
+    static detail::writer_wait writer_wait(sink_flags_t flags) noexcept;
+
+    // Fills the unused remainder of a multi-producer reservation [next,
+    // s.end()) with padding, then publishes the record by storing fptr.
+    void commit_shared(ring_buffer::span s, std::byte* next, fptr_t fptr) noexcept
+    {
+        for (; next < s.end(); next += sizeof(fptr_t))
+            copy(next, &detail::trampoline_skip<detail::consumer>);
+        ring_buffer::commit<fptr_t>(s.begin(), fptr);
+        buf_.wake_reader();
+    }
 
     ring_buffer buf_;
     std::atomic<std::size_t> dropped_count_{};
@@ -227,15 +438,133 @@ private:
     // messages), so it isn't worth increasing the size of the sink object.
     std::atomic<log_level_t> level_;
     bool open_ = false;
+    // Set for sinks that are written to by multiple threads (mpsc_sink),
+    // which use a different queueing protocol (see
+    // synchronized_ring_buffer::reserve).
+    bool multi_producer_ = false;
+    // Set for sinks that discard their oldest records when full, see
+    // synchronized_ring_buffer::enable_overwrite.
+    bool overwrite_ = false;
+    // enqueue_time_size if latency_ is non-null, otherwise zero
+    std::uint8_t prefix_size_ = 0;
+    sink_flags_t flags_;
+    // Non-null if sink_flags_t::measure_latency was passed, see
+    // trampoline_enqueue_time.
+    std::unique_ptr<detail::latency_histogram> latency_;
 
     friend detail::consumer;
     friend logger;
+    friend mpsc_sink;
+};
+
+/**
+ * Groups a series of log statements so that they are made visible to the
+ * background thread together, when the batch is destroyed (or @ref publish is
+ * called). Ordinarily each log statement publishes itself to the background
+ * thread with a store to a variable that the background thread polls, so
+ * logging many statements in succession causes that variable's cache line to
+ * be transferred between cores once per statement. A batch is passed to the
+ * XTR_LOG macros in place of a sink:
+ *
+ * @code
+ * {
+ *     xtr::sink::batch b(s);
+ *     for (const auto& level : book)
+ *         XTR_LOG(b, "{} {}", level.price, level.quantity);
+ * } // Statements are published here
+ * @endcode
+ *
+ * If the sink's queue becomes full during a batch then the statements logged
+ * so far are published, so that the background thread can make space. Other
+ * functions may be called on the sink during a batch; those that write to the
+ * queue (such as @ref sink::sync or @ref sink::set_name) also publish any
+ * pending statements. Batches are only supported for single-producer sinks.
+ */
+class xtr::sink::batch
+{
+public:
+    /**
+     * Begins a batch of log statements to be written to the given sink.
+     */
+    explicit batch(sink& s) noexcept :
+        sink_(s)
+    {
+    }
+
+    batch(const batch&) = delete;
+    batch& operator=(const batch&) = delete;
+
+    /**
+     * Publishes all pending log statements.
+     */
+    ~batch()
+    {
+        publish();
+    }
+
+    /**
+     * Makes all log statements written to the batch so far visible to the
+     * background thread.
+     */
+    void publish() noexcept
+    {
+        sink_.buf_.publish();
+    }
+
+    /**
+     * Returns the log level of the underlying sink, see @ref sink::level.
+     */
+    log_level_t level() const
+    {
+        return sink_.level();
+    }
+
+    /**
+     * Publishes all pending log statements then synchronizes the underlying
+     * sink, see @ref sink::sync.
+     */
+    void sync()
+    {
+        publish();
+        sink_.sync();
+    }
+
+    /**
+     * Logs the given format string and arguments, see @ref sink::log.
+     */
+    template<auto Format, auto Level, typename Tags = void(), typename... Args>
+    void log(Args&&... args) noexcept((XTR_NOTHROW_INGESTIBLE(Args, args) && ...))
+    {
+        sink_.log<Format, Level, detail::add_tag_t<detail::batch_tag, Tags>>(
+            std::forward<Args>(args)...);
+    }
+
+private:
+    sink& sink_;
 };
 
 template<auto Format, auto Level, typename Tags, typename... Args>
 void xtr::sink::log(Args&&... args) noexcept((XTR_NOTHROW_INGESTIBLE(Args, args) && ...))
 {
-    log_impl<Format, Level, Tags>(std::forward<Args>(args)...);
+    using tags = detail::add_tag_t<
+        detail::enqueue_time_tag,
+        detail::add_tag_t<detail::droppable_tag, Tags>>;
+    log_impl<Format, Level, tags>(std::forward<Args>(args)...);
+}
+
+template<typename Tags>
+xtr::sink::fptr_t xtr::sink::write_prefix(std::byte* pos, fptr_t fptr) noexcept
+{
+    if constexpr (detail::is_enqueue_time_v<Tags>)
+    {
+        if (prefix_size_ != 0) [[unlikely]]
+        {
+            copy(pos + enqueue_time_size, fptr);
+            copy(pos + sizeof(fptr_t), detail::enqueue_time{detail::tsc::now().ticks});
+            return &detail::trampoline_enqueue_time<detail::consumer>;
+        }
+    }
+    return fptr;
 }
 
 template<auto Format, auto Level, typename Tags>
@@ -244,14 +573,37 @@ void xtr::sink::log_impl() noexcept
     // This function is just an optimisation; if the log line has no arguments
     // then creating a lambda for it would waste space in the queue (as even if
     // the lambda captures nothing it still has a non-zero size).
-    const ring_buffer::span s = buf_.write_span_spec<Tags>(sizeof(fptr_t));
-    if (detail::is_non_blocking_v<Tags> && s.empty()) [[unlikely]]
+    const auto size = ring_buffer::size_type(prefix_size<Tags>() + sizeof(fptr_t));
+
+    if constexpr (detail::is_multi_producer_v<Tags>)
+    {
+        const ring_buffer::span s = buf_.reserve<Tags>(size);
+        if (detail::is_droppable_v<Tags> && s.empty()) [[unlikely]]
+        {
+            dropped_count_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        ring_buffer::commit<fptr_t>(
+            s.begin(),
+            write_prefix<Tags>(
+                s.begin(),
+                &detail::trampoline0<Format, Level, detail::consumer>));
+        buf_.wake_reader();
+        return;
+    }
+
+    const ring_buffer::span s = buf_.write_span_spec<Tags>(size);
+    if (detail::is_droppable_v<Tags> && s.empty()) [[unlikely]]
     {
         dropped_count_.fetch_add(1, std::memory_order_relaxed);
         return;
     }
-    copy(s.begin(), &detail::trampoline0<Format, Level, detail::consumer>);
-    buf_.reduce_writable(sizeof(fptr_t));
+    copy(
+        s.begin(),
+        write_prefix<Tags>(
+            s.begin(),
+            &detail::trampoline0<Format, Level, detail::consumer>));
+    buf_.reduce_writable<Tags>(size, !detail::is_droppable_v<Tags>);
 }
 
 template<auto Format, auto Level, typename Tags, typename... Args>
@@ -265,7 +617,9 @@ void xtr::sink::log_impl(Args&&... args) noexcept(
         std::is_same<std::remove_cvref_t<Args>, std::string>...>;
     constexpr bool is_vcopy =
         std::disjunction_v<detail::is_vcopy_wrapper<Args>...>;
-    if constexpr (is_str || is_vcopy)
+    constexpr bool is_interned = std::disjunction_v<
+        std::is_same<std::remove_cvref_t<Args>, detail::interned_string>...>;
+    if constexpr (is_str || is_vcopy || is_interned)
         post_variable_len<Format, Level, Tags>(std::forward<Args>(args)...);
     else
         post<Format, Level, Tags>(make_lambda<Tags>(std::forward<Args>(args)...));
@@ -282,9 +636,16 @@ void xtr::sink::post_variable_len(Args&&... args) noexcept(
         std::declval<bool&>(),
         std::forward<Args>(args))...));
 
+    if constexpr (detail::is_multi_producer_v<Tags>)
+    {
+        post_variable_len_shared<Format, Level, Tags, lambda_t>(
+            std::forward<Args>(args)...);
+        return;
+    }
+
     ring_buffer::span s = buf_.write_span_spec();
 
-    auto func_pos = s.begin() + sizeof(fptr_t);
+    auto func_pos = s.begin() + prefix_size<Tags>() + sizeof(fptr_t);
     if constexpr (alignof(lambda_t) > alignof(fptr_t))
         func_pos = align<alignof(lambda_t)>(func_pos);
 
@@ -295,7 +656,7 @@ void xtr::sink::post_variable_len(Args&&... args) noexcept(
     if (s.size() < size) [[unlikely]]
         s = buf_.write_span<Tags>(size);
 
-    if (detail::is_non_blocking_v<Tags> && s.empty()) [[unlikely]]
+    if (detail::is_droppable_v<Tags> && s.empty()) [[unlikely]]
     {
         dropped_count_.fetch_add(1, std::memory_order_relaxed);
         return;
@@ -307,7 +668,11 @@ void xtr::sink::post_variable_len(Args&&... args) noexcept(
     auto vlen_end = s.end();
     bool overflow = false;
 
-    copy(s.begin(), &detail::trampolineV<Format, Level, detail::consumer, lambda_t>);
+    copy(
+        s.begin(),
+        write_prefix<Tags>(
+            s.begin(),
+            &detail::trampolineV<Format, Level, detail::consumer, lambda_t>));
     copy(
         func_pos,
         make_lambda<Tags>(detail::transform_args<Tags>(
@@ -327,7 +692,74 @@ void xtr::sink::post_variable_len(Args&&... args) noexcept(
     const auto next = detail::align<alignof(fptr_t)>(vlen_cur);
     const auto total_size = ring_buffer::size_type(next - s.begin());
 
-    buf_.reduce_writable(total_size);
+    buf_.reduce_writable<Tags>(total_size, is_pinned<Tags, lambda_t>);
+}
+
+template<auto Format, auto Level, typename Tags, typename Lambda, typename... Args>
+void xtr::sink::post_variable_len_shared(Args&&... args) noexcept(
+    (XTR_NOTHROW_INGESTIBLE(Args, args) && ...))
+{
+    // Space must be reserved before anything is written, so the size of the
+    // variable length area is bounded in advance (the alignment of
+    // reservations is only known to be that of fptr_t, hence the padding).
+    constexpr std::size_t padding =
+        alignof(Lambda) > alignof(fptr_t) ? alignof(Lambda) - alignof(fptr_t) : 0;
+    const std::size_t header_size =
+        prefix_size<Tags>() + sizeof(fptr_t) + padding + sizeof(Lambda);
+    const std::size_t size = detail::align(
+        header_size + (detail::variable_length_bound(args) + ... + 0),
+        alignof(fptr_t));
+
+    if (size > buf_.wrcapacity()) [[unlikely]]
+    {
+        dropped_count_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    const ring_buffer::span s = buf_.reserve<Tags>(ring_buffer::size_type(size));
+
+    if (detail::is_droppable_v<Tags> && s.empty()) [[unlikely]]
+    {
+        dropped_count_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    auto func_pos = s.begin() + prefix_size<Tags>() + sizeof(fptr_t);
+    if constexpr (alignof(Lambda) > alignof(fptr_t))
+        func_pos = detail::align<alignof(Lambda)>(func_pos);
+
+    auto vlen_cur = func_pos + sizeof(Lambda);
+    auto vlen_end = s.end();
+    bool overflow = false;
+
+    copy(
+        func_pos,
+        make_lambda<Tags>(detail::transform_args<Tags>(
+            vlen_cur,
+            vlen_end,
+            buf_,
+            overflow,
+            std::forward<Args>(args))...));
+
+    if (overflow) [[unlikely]]
+    {
+        // Not expected as the reservation is an upper bound, but the
+        // reservation must still be committed (as padding) regardless.
+        std::destroy_at(reinterpret_cast<Lambda*>(func_pos));
+        dropped_count_.fetch_add(1, std::memory_order_relaxed);
+        commit_shared(
+            s,
+            s.begin() + sizeof(fptr_t),
+            &detail::trampoline_skip<detail::consumer>);
+        return;
+    }
+
+    commit_shared(
+        s,
+        detail::align<alignof(fptr_t)>(vlen_cur),
+        write_prefix<Tags>(
+            s.begin(),
+            &detail::trampolineV<Format, Level, detail::consumer, Lambda>));
 }
 
 template<typename T>
@@ -341,11 +773,42 @@ void xtr::sink::copy(std::byte* pos, T&& value) noexcept(XTR_NOTHROW_INGESTIBLE(
 template<auto Format, auto Level, typename Tags, typename Func>
 void xtr::sink::post(Func&& func) noexcept(XTR_NOTHROW_INGESTIBLE(Func, func))
 {
+    if constexpr (detail::is_multi_producer_v<Tags>)
+    {
+        // See post_variable_len_shared for an explanation of the padding
+        constexpr std::size_t padding =
+            alignof(Func) > alignof(fptr_t) ? alignof(Func) - alignof(fptr_t) : 0;
+        const auto size = ring_buffer::size_type(
+            prefix_size<Tags>() + sizeof(fptr_t) + padding +
+            detail::align(sizeof(Func), alignof(fptr_t)));
+
+        const ring_buffer::span s = buf_.reserve<Tags>(size);
+
+        if (detail::is_droppable_v<Tags> && s.empty()) [[unlikely]]
+        {
+            dropped_count_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        auto func_pos = s.begin() + prefix_size<Tags>() + sizeof(fptr_t);
+        if constexpr (alignof(Func) > alignof(fptr_t))
+            func_pos = detail::align<alignof(Func)>(func_pos);
+
+        copy(func_pos, std::forward<Func>(func));
+        commit_shared(
+            s,
+            func_pos + detail::align(sizeof(Func), alignof(fptr_t)),
+            write_prefix<Tags>(
+                s.begin(),
+                &detail::trampolineN<Format, Level, detail::consumer, Func>));
+        return;
+    }
+
     ring_buffer::span s = buf_.write_span_spec();
 
     // GCC as of 9.2.1 does not optimise away this call to align if pos is marked
     // as aligned, hence these constexpr conditionals. Clang does optimise as of 8.0.1-3+b1.
-    auto func_pos = s.begin() + sizeof(fptr_t);
+    auto func_pos = s.begin() + prefix_size<Tags>() + sizeof(fptr_t);
     if constexpr (alignof(Func) > alignof(fptr_t))
         func_pos = detail::align<alignof(Func)>(func_pos);
 
@@ -358,16 +821,29 @@ void xtr::sink::post(Func&& func) noexcept(XTR_NOTHROW_INGESTIBLE(Func, func))
     if ((s.size() < size)) [[unlikely]]
         s = buf_.write_span<Tags>(size);
 
-    if (detail::is_non_blocking_v<Tags> && s.empty()) [[unlikely]]
+    if (detail::is_droppable_v<Tags> && s.empty()) [[unlikely]]
     {
         dropped_count_.fetch_add(1, std::memory_order_relaxed);
         return;
     }
 
-    copy(s.begin(), &detail::trampolineN<Format, Level, detail::consumer, Func>);
+    copy(
+        s.begin(),
+        write_prefix<Tags>(
+            s.begin(),
+            &detail::trampolineN<Format, Level, detail::consumer, Func>));
     copy(func_pos, std::forward<Func>(func));
 
-    buf_.reduce_writable(size);
+    buf_.reduce_writable<Tags>(size, is_pinned<Tags, Func>);
+}
+
+template<typename Func>
+void xtr::sink::post_control(Func&& func)
+{
+    if (multi_producer_)
+        post<nullptr, 0, void(detail::multi_producer_tag)>(std::forward<Func>(func));
+    else
+        post(std::forward<Func>(func));
 }
 
 template<typename Tags, typename... Args>
@@ -0,0 +1,91 @@
+// Copyright 2026 Chris E. Holloway
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef XTR_SSO_HPP
+#define XTR_SSO_HPP
+
+#include "detail/string_ref.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace xtr
+{
+    /**
+     * sso is a string argument type holding up to N characters inline, so
+     * that `arg` becomes `sso<N>(arg)`. By default string arguments are copied
+     * into the sink's variable-length area, which requires their length to be
+     * checked against the space remaining in the sink and an additional level
+     * of indirection when the log statement is formatted. As sso is a
+     * fixed-size type, short strings passed via sso are instead copied in the
+     * same way as arguments such as integers. Strings longer than N are
+     * truncated to N characters. N may be at most 255. Accepts C strings,
+     * std::string and std::string_view. Please see the <a
+     * href="guide.html#string-arguments">string arguments</a> section of the
+     * user guide for further details.
+     */
+    template<std::size_t N>
+    class sso
+    {
+    public:
+        static_assert(N > 0 && N <= UINT8_MAX, "N must be between 1 and 255");
+
+        // lack of explicit is intentional
+        sso(std::string_view str) noexcept :
+            size_(std::uint8_t(std::min(str.size(), N)))
+        {
+            std::memcpy(data_, str.data(), size_);
+        }
+
+        std::string_view str() const noexcept
+        {
+            return {data_, size_};
+        }
+
+    private:
+        char data_[N];
+        std::uint8_t size_;
+    };
+}
+
+template<std::size_t N>
+struct fmt::formatter<xtr::sso<N>>
+{
+    template<typename ParseContext>
+    constexpr auto parse(ParseContext& ctx)
+    {
+        return ctx.begin();
+    }
+
+    template<typename FormatContext>
+    auto format(const xtr::sso<N>& s, FormatContext& ctx) const
+    {
+        return formatter<xtr::detail::string_ref<std::string_view>>().format(
+            xtr::detail::string_ref<std::string_view>(s.str()),
+            ctx);
+    }
+};
+
+#endif
@@ -10,6 +10,7 @@ echo '#define XTR_LOGGER_HPP\n' >> $target
 
 for file in \
     include/xtr/config.hpp \
+    include/xtr/detail/config.hpp \
     include/xtr/timespec.hpp \
     include/xtr/tags.hpp \
     include/xtr/detail/throw.hpp \
@@ -17,31 +18,47 @@ for file in \
     include/xtr/detail/align.hpp \
     include/xtr/detail/pagesize.hpp \
     include/xtr/detail/cpuid.hpp \
+    include/xtr/detail/waitpkg.hpp \
     include/xtr/detail/is_c_string.hpp \
     include/xtr/detail/file_descriptor.hpp \
     include/xtr/detail/memory_mapping.hpp \
     include/xtr/detail/mirrored_memory_mapping.hpp \
     include/xtr/detail/pause.hpp \
     include/xtr/detail/sanitize.hpp \
+    include/xtr/detail/string_copy.hpp \
     include/xtr/detail/string_ref.hpp \
+    include/xtr/sso.hpp \
     include/xtr/detail/tags.hpp \
+    include/xtr/detail/doorbell.hpp \
+    include/xtr/detail/futex.hpp \
+    include/xtr/detail/record_index.hpp \
     include/xtr/detail/synchronized_ring_buffer.hpp \
     include/xtr/detail/tsc.hpp \
     include/xtr/detail/clock_ids.hpp \
     include/xtr/detail/get_time.hpp \
+    include/xtr/detail/rate_limit.hpp \
     include/xtr/log_level.hpp \
+    include/xtr/detail/shared_stats.hpp \
+    include/xtr/detail/log_site.hpp \
     include/xtr/pump_io_stats.hpp \
+    include/xtr/detail/latency_histogram.hpp \
     include/xtr/io/storage_interface.hpp \
     include/xtr/detail/buffer.hpp \
+    include/xtr/detail/format_pool.hpp \
+    include/xtr/detail/binary_format.hpp \
+    include/xtr/detail/reorder_buffer.hpp \
     include/xtr/detail/print.hpp \
     include/xtr/detail/string.hpp \
     include/xtr/detail/vcopy_wrapper.hpp \
+    include/xtr/detail/intern_table.hpp \
     include/xtr/vcopy.hpp \
     include/xtr/nocopy.hpp \
+    include/xtr/interned.hpp \
     include/xtr/detail/transform_args.hpp \
     include/xtr/detail/trampolines.hpp \
     include/xtr/detail/strzcpy.hpp \
     include/xtr/sink.hpp \
+    include/xtr/mpsc_sink.hpp \
     include/xtr/detail/commands/frame.hpp \
     include/xtr/detail/commands/pattern.hpp \
     include/xtr/detail/commands/message_id.hpp \
@@ -72,23 +89,32 @@ do
 done
 
 grep -hEv '^ *//|^#include "' \
+    src/binary_format.cpp \
     src/buffer.cpp \
     src/command_dispatcher.cpp \
     src/command_path.cpp \
     src/consumer.cpp \
     src/fd_storage_base.cpp \
     src/fd_storage.cpp \
+    src/format_pool.cpp \
+    src/futex.cpp \
     src/file_descriptor.cpp \
+    src/intern_table.cpp \
     src/io_uring_fd_storage.cpp \
+    src/latency_histogram.cpp \
     src/logger.cpp \
     src/log_level.cpp \
+    src/log_site.cpp \
     src/matcher.cpp \
     src/memory_mapping.cpp \
     src/mirrored_memory_mapping.cpp \
     src/open.cpp \
     src/pagesize.cpp \
     src/posix_fd_storage.cpp \
+    src/record_index.cpp \
     src/regex_matcher.cpp \
+    src/reorder_buffer.cpp \
+    src/shared_stats.cpp \
     src/sink.cpp \
     src/throw.cpp \
     src/tsc.cpp \
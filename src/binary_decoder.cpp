@@ -0,0 +1,331 @@
+// Copyright 2026 Chris E. Holloway
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "xtr/detail/binary_decoder.hpp"
+#include "xtr/detail/binary_format.hpp"
+#include "xtr/detail/string_ref.hpp"
+#include "xtr/timespec.hpp"
+
+#include <fmt/args.h>
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <exception>
+#include <iterator>
+#include <vector>
+
+namespace xtr::detail::binary
+{
+    namespace
+    {
+        // Tables are indexed by id, so ids are limited to bound the size of
+        // the tables if the log is corrupt. Site ids are assigned to each log
+        // statement in the program and name ids to each sink, so neither
+        // should approach this limit.
+        constexpr std::uint32_t max_id = 1U << 20;
+
+        constexpr std::size_t string_chunk_size = 64 * 1024;
+
+        // Reads values from the log. Once a read fails, or a record is found
+        // to be invalid, all further reads return zeros so that the record
+        // being decoded can be abandoned at any point without checking every
+        // value. Only the first error is kept.
+        class reader
+        {
+        public:
+            explicit reader(std::FILE* fp) :
+                fp_(fp)
+            {
+            }
+
+            // Returns false at the end of the input or after an error
+            bool next(record_type& type)
+            {
+                if (failed())
+                    return false;
+                const int c = std::fgetc(fp_);
+                if (c == EOF)
+                {
+                    if (std::ferror(fp_))
+                        fail_errno();
+                    return false;
+                }
+                type = record_type(c);
+                return true;
+            }
+
+            template<typename T>
+            T get()
+            {
+                T value;
+                read(&value, sizeof(value));
+                return value;
+            }
+
+            // The string is read in chunks, so that a corrupt length cannot
+            // cause more memory to be allocated than there is data to read.
+            std::string get_string()
+            {
+                std::string str;
+                std::size_t len = get<std::uint32_t>();
+                while (len != 0 && !failed())
+                {
+                    const std::size_t n = std::min(len, string_chunk_size);
+                    const std::size_t pos = str.size();
+                    str.resize(pos + n);
+                    read(str.data() + pos, n);
+                    len -= n;
+                }
+                return str;
+            }
+
+            void fail(std::string error)
+            {
+                if (!failed())
+                    error_ = std::move(error);
+            }
+
+            bool failed() const noexcept
+            {
+                return !error_.empty();
+            }
+
+            std::string& error() noexcept
+            {
+                return error_;
+            }
+
+        private:
+            void fail_errno()
+            {
+                fail(std::string("Error reading: ") + std::strerror(errno));
+            }
+
+            void read(void* dst, std::size_t n)
+            {
+                if (failed() || std::fread(dst, 1, n, fp_) != n)
+                {
+                    if (std::ferror(fp_))
+                        fail_errno();
+                    fail("Truncated record");
+                    std::memset(dst, 0, n);
+                }
+            }
+
+            std::FILE* fp_;
+            std::string error_;
+        };
+
+        struct tables
+        {
+            std::array<std::string, n_levels> styles;
+            std::vector<std::string> sites;
+            std::vector<std::string> names;
+        };
+
+        void define(
+            reader& rd, std::vector<std::string>& table, std::uint32_t id, const char* what)
+        {
+            std::string str = rd.get_string();
+            if (id >= max_id)
+                rd.fail(fmt::format("Invalid {} {}", what, id));
+            if (rd.failed())
+                return;
+            if (id >= table.size())
+                table.resize(std::size_t(id) + 1);
+            table[id] = std::move(str);
+        }
+
+        const std::string& lookup(
+            reader& rd,
+            const std::vector<std::string>& table,
+            std::uint32_t id,
+            const char* what)
+        {
+            static const std::string empty;
+            if (id >= table.size())
+            {
+                rd.fail(fmt::format("Undefined {} {}", what, id));
+                return empty;
+            }
+            return table[id];
+        }
+
+        std::timespec get_timespec(reader& rd)
+        {
+            std::timespec ts{};
+            ts.tv_sec = std::time_t(rd.get<std::int64_t>());
+            ts.tv_nsec = long(rd.get<std::int64_t>());
+            return ts;
+        }
+
+        void decode_event(reader& rd, const tables& tbl, std::string& out)
+        {
+            const auto& fmt = lookup(rd, tbl.sites, rd.get<std::uint32_t>(), "site");
+            const auto& name = lookup(rd, tbl.names, rd.get<std::uint32_t>(), "name");
+            const auto level = rd.get<std::uint8_t>();
+            if (level >= n_levels)
+                rd.fail("Invalid log level");
+            const xtr::timespec ts = get_timespec(rd);
+            const std::size_t nargs = rd.get<std::uint8_t>();
+
+            if (rd.failed())
+                return;
+
+            fmt::dynamic_format_arg_store<fmt::format_context> store;
+            store.push_back(std::string_view(tbl.styles[level]));
+            store.push_back(ts);
+            store.push_back(std::string_view(name));
+
+            // string_ref arguments refer to these strings, so they must not
+            // be reallocated while the store is in use.
+            std::vector<std::string> strings;
+            strings.reserve(nargs);
+
+            for (std::size_t i = 0; i != nargs && !rd.failed(); ++i)
+            {
+                switch (rd.get<arg_type>())
+                {
+                case arg_type::i64:
+                    store.push_back(rd.get<std::int64_t>());
+                    break;
+                case arg_type::u64:
+                    store.push_back(rd.get<std::uint64_t>());
+                    break;
+                case arg_type::boolean:
+                    store.push_back(rd.get<std::uint8_t>() != 0);
+                    break;
+                case arg_type::character:
+                    store.push_back(rd.get<char>());
+                    break;
+                case arg_type::f32:
+                    store.push_back(rd.get<float>());
+                    break;
+                case arg_type::f64:
+                    store.push_back(rd.get<double>());
+                    break;
+                case arg_type::pointer:
+                    store.push_back(reinterpret_cast<const void*>(
+                        std::uintptr_t(rd.get<std::uint64_t>())));
+                    break;
+                case arg_type::timespec:
+                    store.push_back(xtr::timespec(get_timespec(rd)));
+                    break;
+                case arg_type::string:
+                    store.push_back(rd.get_string());
+                    break;
+                case arg_type::sanitized_string:
+                    strings.push_back(rd.get_string());
+                    store.push_back(string_ref<std::string_view>(strings.back()));
+                    break;
+                default:
+                    rd.fail("Invalid argument type");
+                }
+            }
+
+            if (rd.failed())
+                return;
+
+#if __cpp_exceptions
+            try
+            {
+#endif
+                fmt::vformat_to(std::back_inserter(out), fmt, fmt::format_args(store));
+#if __cpp_exceptions
+            }
+            catch (const std::exception& e)
+            {
+                out += fmt::format("Error formatting log: {}\n", e.what());
+            }
+#endif
+        }
+    }
+}
+
+XTR_FUNC
+std::string xtr::detail::binary::decode(
+    std::FILE* fp, const std::function<void(std::string_view)>& write)
+{
+    reader rd(fp);
+    tables tbl;
+    std::string out;
+    record_type type;
+    bool first = true;
+
+    while (rd.next(type))
+    {
+        if (first && type != record_type::header)
+            return "Not a binary xtr log";
+        first = false;
+
+        switch (type)
+        {
+        case record_type::header:
+        {
+            char magic[sizeof(binary::magic)];
+            for (char& c : magic)
+                c = rd.get<char>();
+            if (rd.failed())
+                break;
+            if (std::memcmp(magic, binary::magic, sizeof(magic)) != 0)
+                return "Invalid header";
+            if (const auto v = rd.get<std::uint8_t>(); v != version && !rd.failed())
+                return fmt::format("Unsupported version {}", v);
+            // A header begins a new log, e.g. if the log was reopened
+            tbl = tables();
+            break;
+        }
+        case record_type::style:
+            for (auto& style : tbl.styles)
+                style = rd.get_string();
+            break;
+        case record_type::site:
+            define(rd, tbl.sites, rd.get<std::uint32_t>(), "site");
+            break;
+        case record_type::name:
+            define(rd, tbl.names, rd.get<std::uint32_t>(), "name");
+            break;
+        case record_type::text:
+            out = rd.get_string();
+            break;
+        case record_type::event:
+            decode_event(rd, tbl, out);
+            break;
+        default:
+            return fmt::format("Invalid record type {}", unsigned(type));
+        }
+
+        if (rd.failed())
+            break;
+
+        if (!out.empty())
+        {
+            write(out);
+            out.clear();
+        }
+    }
+
+    return std::move(rd.error());
+}
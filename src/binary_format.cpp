@@ -0,0 +1,103 @@
+// Copyright 2026 Chris E. Holloway
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "xtr/detail/binary_format.hpp"
+
+#include <atomic>
+
+XTR_FUNC
+std::uint32_t xtr::detail::binary::next_site_id() noexcept
+{
+    static std::atomic<std::uint32_t> next_id{0};
+    return next_id.fetch_add(1, std::memory_order_relaxed);
+}
+
+XTR_FUNC
+void xtr::detail::binary::writer::reset() noexcept
+{
+    header_written_ = false;
+    lstyle_ = nullptr;
+    sites_.clear();
+    names_.clear();
+    last_name_.clear();
+    last_name_id_ = 0;
+}
+
+XTR_FUNC
+void xtr::detail::binary::writer::begin_record(
+    std::string& out, log_level_style_t lstyle)
+{
+    if (!header_written_) [[unlikely]]
+    {
+        put(out, record_type::header);
+        out.append(std::begin(magic), std::end(magic));
+        put(out, version);
+        header_written_ = true;
+    }
+
+    // The level style may be changed at any time via
+    // logger::set_log_level_style, so it is checked before every record.
+    if (lstyle != lstyle_) [[unlikely]]
+    {
+        put(out, record_type::style);
+        for (std::size_t i = 0; i != n_levels; ++i)
+            put_string(out, lstyle(log_level_t(i)));
+        lstyle_ = lstyle;
+    }
+}
+
+XTR_FUNC
+void xtr::detail::binary::writer::define_site(
+    std::string& out, std::uint32_t id, fmt::string_view fmt)
+{
+    if (id < sites_.size() && sites_[id]) [[likely]]
+        return;
+
+    if (id >= sites_.size())
+        sites_.resize(id + 1);
+    sites_[id] = true;
+
+    put(out, record_type::site);
+    put(out, id);
+    put_string(out, std::string_view(fmt.data(), fmt.size()));
+}
+
+XTR_FUNC
+std::uint32_t xtr::detail::binary::writer::name_id(
+    std::string& out, const std::string& name)
+{
+    // Consecutive records very often come from the same sink
+    if (name == last_name_ && !names_.empty()) [[likely]]
+        return last_name_id_;
+
+    auto [it, inserted] = names_.try_emplace(name, std::uint32_t(names_.size()));
+
+    if (inserted)
+    {
+        put(out, record_type::name);
+        put(out, it->second);
+        put_string(out, name);
+    }
+
+    last_name_ = name;
+    last_name_id_ = it->second;
+
+    return it->second;
+}
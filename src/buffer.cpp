@@ -19,8 +19,11 @@
 // SOFTWARE.
 
 #include "xtr/detail/buffer.hpp"
+#include "xtr/detail/binary_format.hpp"
 #include "xtr/detail/clock_ids.hpp"
 #include "xtr/detail/get_time.hpp"
+#include "xtr/detail/reorder_buffer.hpp"
+#include "xtr/detail/tsc.hpp"
 
 #include <fmt/compile.h>
 #include <fmt/format.h>
@@ -30,10 +33,13 @@
 #include <utility>
 
 XTR_FUNC
-xtr::detail::buffer::buffer(storage_interface_ptr storage, log_level_style_t ls) :
+xtr::detail::buffer::buffer(
+    storage_interface_ptr storage, log_level_style_t ls, bool binary_format) :
     lstyle(ls),
     storage_(std::move(storage))
 {
+    if (binary_format)
+        binary = std::make_unique<binary::writer>();
 }
 
 XTR_FUNC
@@ -49,13 +55,17 @@ void xtr::detail::buffer::flush() noexcept
     try
     {
 #endif
+        if (reorder != nullptr)
+            reorder->drain_all(*this);
+        const std::uint64_t start = tsc::now().ticks;
         if (pos_ != begin_)
         {
-            storage_->submit_buffer(begin_, std::size_t(pos_ - begin_));
+            submit_buffer();
             pos_ = begin_ = end_ = nullptr;
         }
         if (storage_)
             storage_->flush();
+        io_ticks += tsc::now().ticks - start;
 #if __cpp_exceptions
     }
     catch (const std::exception& e)
@@ -109,13 +119,54 @@ void xtr::detail::buffer::append_line()
     line.clear();
 }
 
+XTR_FUNC
+void xtr::detail::buffer::append(std::string_view s)
+{
+    append(s.begin(), s.end());
+}
+
+XTR_FUNC
+void xtr::detail::buffer::set_reorder_window(std::chrono::nanoseconds window)
+{
+    // Reordering binary records would separate records from the definitions
+    // of the sites and names that they refer to.
+    if (binary != nullptr)
+        return;
+
+    if (window.count() == 0)
+    {
+        flush();
+        reorder.reset();
+    }
+    else if (reorder == nullptr)
+    {
+        reorder = std::make_unique<reorder_buffer>(window.count());
+    }
+    else
+    {
+        reorder->set_window(window.count());
+    }
+}
+
 XTR_FUNC
 void xtr::detail::buffer::next_buffer()
 {
+    // Allocating a buffer may wait for earlier submissions to complete, so
+    // is counted as I/O.
+    const std::uint64_t start = tsc::now().ticks;
     if (pos_ != begin_) [[likely]] // if not the first call to push_back
-        storage_->submit_buffer(begin_, std::size_t(pos_ - begin_));
+        submit_buffer();
     const std::span<char> s = storage_->allocate_buffer();
     begin_ = s.data();
     end_ = begin_ + s.size();
     pos_ = begin_;
+    io_ticks += tsc::now().ticks - start;
+}
+
+XTR_FUNC
+void xtr::detail::buffer::submit_buffer()
+{
+    const auto size = std::size_t(pos_ - begin_);
+    storage_->submit_buffer(begin_, size);
+    n_bytes_submitted += size;
 }
@@ -25,6 +25,7 @@
 #include "xtr/detail/commands/responses.hpp"
 #include "xtr/detail/commands/send.hpp"
 #include "xtr/detail/strzcpy.hpp"
+#include "xtr/detail/throw.hpp"
 
 #include <cassert>
 #include <cerrno>
@@ -33,6 +34,7 @@
 #include <iostream>
 #include <string_view>
 
+#include <fcntl.h>
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <unistd.h>
@@ -117,23 +119,42 @@ xtr::detail::command_dispatcher::~command_dispatcher()
 }
 
 XTR_FUNC
-xtr::detail::command_dispatcher::buffer::buffer(const void* srcbuf, std::size_t srcsize) :
+xtr::detail::command_dispatcher::buffer::buffer(
+    const void* srcbuf, std::size_t srcsize, int srcfd) :
     buf(new char[srcsize]),
     size(srcsize)
 {
     std::memcpy(buf.get(), srcbuf, size);
+    // The descriptor is duplicated as it may be closed before the reply is
+    // sent.
+    if (srcfd == -1)
+        return;
+    fd.reset(::fcntl(srcfd, F_DUPFD_CLOEXEC, 0));
+    if (!fd)
+    {
+        throw_system_error(
+            errno, "xtr::detail::command_dispatcher::buffer::buffer: fcntl failed");
+    }
 }
 
 XTR_FUNC
-void xtr::detail::command_dispatcher::send(int fd, const void* buf, std::size_t nbytes)
+void xtr::detail::command_dispatcher::send(
+    int fd, const void* buf, std::size_t nbytes, int pass_fd)
 {
-    results_[fd].bufs.emplace_back(buf, nbytes);
+    results_[fd].bufs.emplace_back(buf, nbytes, pass_fd);
 }
 
 XTR_FUNC
 void xtr::detail::command_dispatcher::process_commands(int timeout) noexcept
 {
-    int nfds = XTR_TEMP_FAILURE_RETRY(
+    if (const int nfds = poll_commands(timeout); nfds > 0)
+        dispatch_commands(nfds);
+}
+
+XTR_FUNC
+int xtr::detail::command_dispatcher::poll_commands(int timeout) noexcept
+{
+    const int nfds = XTR_TEMP_FAILURE_RETRY(
         ::poll(
             reinterpret_cast<::pollfd*>(&pollfds_[0]),
             ::nfds_t(pollfds_.size()),
@@ -145,9 +166,15 @@ void xtr::detail::command_dispatcher::process_commands(int timeout) noexcept
         // Clear pollfds to avoid spamming the above error message---is_open
         // will return false and process_commands will not be called again.
         pollfds_.clear();
-        return;
+        return 0;
     }
 
+    return nfds;
+}
+
+XTR_FUNC
+void xtr::detail::command_dispatcher::dispatch_commands(int nfds) noexcept
+{
     if ((pollfds_[0].revents & POLLIN) != 0)
     {
         detail::file_descriptor fd(
@@ -162,7 +189,15 @@ void xtr::detail::command_dispatcher::process_commands(int timeout) noexcept
     for (std::size_t i = 1; i < pollfds_.size() && nfds > 0; ++i)
     {
         const std::size_t n = pollfds_.size();
-        if ((pollfds_[i].revents & POLLOUT) != 0)
+        if (pollfds_[i].revents == 0)
+            continue;
+        if (pollfds_[i].events == 0)
+        {
+            // Waiting for a deferred reply, see defer_reply. POLLHUP and
+            // POLLERR are reported regardless of events, so are ignored here.
+            --nfds;
+        }
+        else if ((pollfds_[i].revents & POLLOUT) != 0)
         {
             process_socket_write(pollfds_[i]);
             --nfds;
@@ -233,6 +268,9 @@ void xtr::detail::command_dispatcher::process_socket_read(pollfd& pfd) noexcept
         send_error(fd, e.what());
     }
 #endif
+
+    if (const auto rpos = results_.find(fd); rpos != results_.end() && rpos->second.deferred)
+        pfd.events = 0;
 }
 
 XTR_FUNC
@@ -246,9 +284,9 @@ void xtr::detail::command_dispatcher::process_socket_write(pollfd& pfd) noexcept
 
     for (; cr.pos < cr.bufs.size(); ++cr.pos)
     {
-        nwritten =
-            command_send(fd, cr.bufs[cr.pos].buf.get(), cr.bufs[cr.pos].size);
-        if (nwritten != ::ssize_t(cr.bufs[cr.pos].size))
+        const buffer& b = cr.bufs[cr.pos];
+        nwritten = command_send(fd, b.buf.get(), b.size, b.fd.get());
+        if (nwritten != ::ssize_t(b.size))
             break;
     }
 
@@ -275,6 +313,29 @@ void xtr::detail::command_dispatcher::send_error(int fd, std::string_view reason
     send(fd, ef);
 }
 
+XTR_FUNC
+void xtr::detail::command_dispatcher::defer_reply(int fd)
+{
+    results_[fd].deferred = true;
+}
+
+XTR_FUNC
+void xtr::detail::command_dispatcher::complete_reply(int fd) noexcept
+{
+    const auto rpos = results_.find(fd);
+    assert(rpos != results_.end() && rpos->second.deferred);
+    rpos->second.deferred = false;
+
+    for (std::size_t i = 1; i < pollfds_.size(); ++i)
+    {
+        if (pollfds_[i].fd.get() == fd)
+        {
+            pollfds_[i].events = POLLOUT;
+            break;
+        }
+    }
+}
+
 XTR_FUNC
 void xtr::detail::command_dispatcher_deleter::operator()(command_dispatcher* d) const
 {
@@ -20,11 +20,18 @@
 
 #include "xtr/detail/consumer.hpp"
 #include "xtr/command_path.hpp"
+#include "xtr/detail/binary_format.hpp"
 #include "xtr/detail/commands/command_dispatcher.hpp"
 #include "xtr/detail/commands/matcher.hpp"
 #include "xtr/detail/commands/requests.hpp"
 #include "xtr/detail/commands/responses.hpp"
+#include "xtr/detail/futex.hpp"
+#include "xtr/detail/log_site.hpp"
+#include "xtr/detail/pause.hpp"
+#include "xtr/detail/reorder_buffer.hpp"
 #include "xtr/detail/strzcpy.hpp"
+#include "xtr/detail/tsc.hpp"
+#include "xtr/detail/waitpkg.hpp"
 #include "xtr/log_level.hpp"
 #include "xtr/sink.hpp"
 #include "xtr/timespec.hpp"
@@ -34,11 +41,105 @@
 #include <fmt/format.h>
 
 #include <algorithm>
+#include <chrono>
 #include <cstdio>
 #include <cstring>
 #include <exception>
+#include <iterator>
+#include <map>
+#include <set>
+#include <string_view>
+#include <tuple>
 #include <version>
 
+namespace xtr::detail
+{
+    // Sites are matched against "file:line", as printed in log statements
+    XTR_FUNC
+    bool match_site(const matcher& m, const log_site& site)
+    {
+        char name[sizeof(site_info::file) + 16];
+        *fmt::format_to_n(name, sizeof(name) - 1, "{}:{}", site.file, site.line).out =
+            '\0';
+        return m(name);
+    }
+
+    XTR_FUNC
+    void add_io_stats(pump_io_stats& to, const pump_io_stats& from) noexcept
+    {
+        to.n_events += from.n_events;
+        to.n_bytes_formatted += from.n_bytes_formatted;
+        to.n_bytes_submitted += from.n_bytes_submitted;
+        to.n_dropped += from.n_dropped;
+        to.format_time += from.format_time;
+        to.io_time += from.io_time;
+        to.command_time += from.command_time;
+    }
+
+    XTR_FUNC
+    std::chrono::nanoseconds ticks_to_nanos(std::uint64_t ticks) noexcept
+    {
+        return std::chrono::nanoseconds(
+            std::int64_t(double(ticks) * 1e9 / double(get_tsc_hz())));
+    }
+
+    // For counters written by one thread and read by others, see
+    // consumer::sink_handle.
+    XTR_FUNC
+    void add_relaxed(std::size_t& counter, std::size_t n) noexcept
+    {
+        const std::atomic_ref<std::size_t> ref(counter);
+        ref.store(ref.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    XTR_FUNC
+    std::size_t load_relaxed(std::size_t& counter) noexcept
+    {
+        return std::atomic_ref<std::size_t>(counter).load(std::memory_order_relaxed);
+    }
+
+    // Appends a label value, escaped as required by the Prometheus text
+    // exposition format.
+    XTR_FUNC
+    void append_label_value(std::string& out, std::string_view value)
+    {
+        for (const char c : value)
+        {
+            switch (c)
+            {
+            case '\\':
+                out += "\\\\";
+                break;
+            case '"':
+                out += "\\\"";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            default:
+                out += c;
+            }
+        }
+    }
+}
+
+XTR_FUNC
+xtr::detail::consumer::consumer(
+    buffer bf,
+    std::string command_path,
+    std::function<std::timespec()> clock,
+    idle_strategy idle) :
+    buf(std::move(bf)),
+    clock_(std::move(clock)),
+    idle_(idle)
+{
+    if (idle_ == idle_strategy::umwait && !has_waitpkg())
+        idle_ = idle_strategy::backoff;
+    if (idle_ == idle_strategy::sleep)
+        sleep_timeout_ms_ = park_timeout_ms();
+    set_command_path(std::move(command_path));
+}
+
 XTR_FUNC
 xtr::detail::consumer::~consumer()
 {
@@ -61,8 +162,102 @@ xtr::detail::consumer::~consumer()
 XTR_FUNC
 void xtr::detail::consumer::run() noexcept
 {
-    while (run_once())
-        ;
+    if (idle_ == idle_strategy::spin)
+    {
+        while (run_once())
+            ;
+        return;
+    }
+
+    pump_io_stats stats;
+    std::size_t n_idle = 0;
+
+    while (run_once(&stats))
+    {
+        if (stats.n_events != 0)
+        {
+            n_idle = 0;
+            if (parked_.load(std::memory_order_relaxed) != 0)
+                parked_.store(0, std::memory_order_relaxed);
+        }
+        else if (parked_.load(std::memory_order_relaxed) != 0)
+        {
+            // The consumer parked itself during the previous idle period and
+            // the subsequent pass over the sinks found nothing to do, so it
+            // is now safe to wait for a producer to unpark it.
+            wait_parked();
+        }
+        else
+        {
+            idle(++n_idle);
+        }
+    }
+}
+
+XTR_FUNC
+void xtr::detail::consumer::idle(std::size_t n_idle) noexcept
+{
+    // Number of consecutive idle passes before the consumer parks itself
+    constexpr std::size_t umwait_threshold = 16;
+    constexpr std::size_t sleep_threshold = 64;
+    constexpr std::size_t max_backoff_shift = 10;
+
+    switch (idle_)
+    {
+    case idle_strategy::spin:
+        break;
+    case idle_strategy::backoff:
+        for (std::size_t i = 0, n = std::size_t(1) << std::min(n_idle, max_backoff_shift);
+             i != n;
+             ++i)
+        {
+            pause();
+        }
+        break;
+    case idle_strategy::umwait:
+        if (n_idle >= umwait_threshold)
+            parked_.store(parked_spinning, std::memory_order_relaxed);
+        else
+            pause();
+        break;
+    case idle_strategy::sleep:
+        if (n_idle >= sleep_threshold)
+        {
+            // Producers load the park word after publishing data without a
+            // memory barrier, so membarrier is used to ensure that either the
+            // producer observes the park word being set or the next pass
+            // over the sinks observes the producer's data.
+            parked_.store(parked_sleeping, std::memory_order_seq_cst);
+            membarrier();
+        }
+        else
+        {
+            pause();
+        }
+        break;
+    }
+}
+
+XTR_FUNC
+void xtr::detail::consumer::wait_parked() noexcept
+{
+    if (idle_ == idle_strategy::umwait)
+    {
+        // Wait for at most approximately 100us, in case the wake up was
+        // missed (producers do not issue a barrier before checking the park
+        // word, and umwait does not use membarrier).
+        const std::uint64_t deadline = tsc::now().ticks + get_tsc_hz() / 10000;
+        umonitor(&parked_);
+        if (parked_.load(std::memory_order_relaxed) != 0)
+            umwait(umwait_c02, deadline);
+    }
+    else
+    {
+        // The timeout ensures that commands (which are not written to a sink)
+        // continue to be processed while the consumer is parked.
+        futex_wait(parked_, parked_sleeping, sleep_timeout_ms_);
+    }
+    parked_.store(0, std::memory_order_relaxed);
 }
 
 XTR_FUNC
@@ -71,81 +266,100 @@ bool xtr::detail::consumer::run_once(pump_io_stats* stats) noexcept
     char ts[32] = {};
     bool ts_stale = true;
 
-    // Read commands once per loop over sinks
-    if (cmds_ && cmds_->is_open())
-        cmds_->process_commands(/* timeout= */ 0);
+    counters start;
+    if (stats != nullptr)
+        start = snapshot();
 
-    std::size_t n_events = 0;
+    // Read commands once per loop over sinks. The TSC is only read if there
+    // is a command to run, and below only once a sink is found to be
+    // non-empty (see read_clock), so that idle passes are not slowed down.
+    const int n_ready =
+        cmds_ && cmds_->is_open() ? cmds_->poll_commands(/* timeout= */ 0) : 0;
 
-    // The inner do/while loop below can modify sinks_ so references to sinks_
-    // cannot be taken here (i.e. no range-based for).
-    for (std::size_t i = 0; i != sinks_.size(); ++i)
+    if (n_ready != 0 || reopen_reply_fd_ != -1 ||
+        reopen_requested_.load(std::memory_order_relaxed) !=
+            reopen_completed_.load(std::memory_order_relaxed)) [[unlikely]]
     {
-        sink::ring_buffer::span span;
+        const std::uint64_t command_start = tsc::now().ticks;
 
-        if ((span = sinks_[i]->buf_.read_span()).empty())
-        {
-            // flush if no further data available (all sinks empty)
-            if (flush_count_ != 0 && --flush_count_ == 0)
-                buf.flush();
-            continue;
-        }
+        if (n_ready != 0)
+            cmds_->dispatch_commands(n_ready);
 
-        destroy = false;
+        if (reopen_reply_fd_ != -1)
+            check_reopen_reply();
 
-        // Read the clock once per loop over sinks
-        if (ts_stale)
+        if (reopen_requested_.load(std::memory_order_relaxed) !=
+            reopen_completed_.load(std::memory_order_relaxed))
         {
-            fmt::format_to(ts, FMT_COMPILE("{}"), xtr::timespec{clock_()});
-            ts_stale = false;
+            reopen_shard();
         }
 
-        // span.end is capped to the end of the first mapping to guarantee that
-        // data is only read from the same address that it was written to (the
-        // sink always begins log records in the first mapping, so we do not
-        // read a record beginning in the second mapping). This is done to
-        // avoid undefined behaviour---reading an object from a different
-        // address than it was written to will work on Intel and probably many
-        // other CPUs but is outside of what is permitted by the C++ memory
-        // model.
-        std::byte* pos = span.begin();
-        std::byte* end = std::min(span.end(), sinks_[i]->buf_.end());
-        do
-        {
-            assert(std::uintptr_t(pos) % alignof(sink::fptr_t) == 0);
-            assert(!destroy);
-            const sink::fptr_t fptr = *reinterpret_cast<const sink::fptr_t*>(pos);
-            pos = fptr(buf, pos, *this, ts, sinks_[i].name);
-            ++n_events;
-        } while (pos < end);
+        counters_.command_ticks += tsc::now().ticks - command_start;
+    }
 
-        if (destroy)
-        {
-            using std::swap;
-            swap(sinks_[i], sinks_.back()); // possible self-swap, ok
-            sinks_.pop_back();
-            --i;
-            continue;
-        }
+    const std::uint64_t io_start = buf.io_ticks;
+
+    std::size_t n_events = 0;
 
-        sinks_[i]->buf_.reduce_readable(
-            sink::ring_buffer::size_type(pos - span.begin()));
+    // Only sinks whose doorbell slot has been rung are visited, except on
+    // every full_scan_interval'th pass (as producers may very rarely fail to
+    // ring, see doorbell), if the consumer is about to park (as it must not
+    // park while any sink is non-empty), if some sinks have no slot, or if
+    // there are too few sinks for the doorbell to be enabled.
+    const bool full_scan = !doorbell_enabled_ || n_unslotted_ != 0 ||
+        parked_.load(std::memory_order_relaxed) != 0 ||
+        ++n_passes_ % full_scan_interval == 0;
 
-        std::size_t n_dropped;
-        if (pos == span.end() && (n_dropped = sinks_[i]->dropped_count()) > 0)
+    // Format threads write to their own buffers, so cannot be used if
+    // records are reordered.
+    if (format_pool_ != nullptr && buf.binary == nullptr && buf.reorder == nullptr)
+        [[unlikely]]
+    {
+        read_sinks_parallel(full_scan, ts, ts_stale, n_events);
+    }
+    else if (full_scan)
+    {
+        // read_sink can modify sinks_ so references to sinks_ cannot be taken
+        // here (i.e. no range-based for).
+        for (std::size_t i = 0; i != sinks_.size(); ++i)
         {
-            detail::print(
-                buf,
-                FMT_COMPILE("{}{} {}: {} messages dropped\n"),
-                log_level_t::warning,
-                ts,
-                sinks_[i].name,
-                n_dropped);
-            sinks_[i].dropped_count += n_dropped;
+            if (!read_sink(i, ts, ts_stale, n_events))
+                --i;
         }
+    }
+    else
+    {
+        doorbell_.drain(
+            std::uint32_t(slot_index_.size()),
+            [&](std::uint32_t slot)
+            {
+                // The slot may have been released since it was rung
+                if (slot_index_[slot] != doorbell::npos)
+                    read_sink(slot_index_[slot], ts, ts_stale, n_events);
+            });
+    }
+
+    // Write records that have left the reorder window, any records still
+    // held are written by the flush below once all sinks are empty.
+    if (buf.reorder != nullptr && n_events != 0) [[unlikely]]
+        buf.reorder->drain(buf);
 
-        // flushing may be late/early if sinks is modified, doesn't matter
-        flush_count_ = sinks_.size();
+    // Time spent submitting full buffers while reading is counted as I/O
+    // rather than formatting, by subtracting it from the time taken to read.
+    if (n_events != 0)
+    {
+        counters_.n_events += n_events;
+        counters_.format_ticks +=
+            tsc::now().ticks - read_start_ - (buf.io_ticks - io_start);
+        publish_metrics();
+    }
+
+    // Flush if no further data is available (all sinks empty)
+    if (n_events == 0 && flush_pending_)
+    {
+        buf.flush();
+        flush_pending_ = false;
+        publish_metrics();
     }
 
     if (sinks_.empty())
@@ -161,15 +375,616 @@ bool xtr::detail::consumer::run_once(pump_io_stats* stats) noexcept
     }
 
     if (stats != nullptr)
-        stats->n_events = n_events;
+        *stats = make_stats(snapshot(), start);
 
     return !sinks_.empty();
 }
 
+XTR_FUNC
+bool xtr::detail::consumer::read_sink(
+    std::size_t i, char* ts, bool& ts_stale, std::size_t& n_events) noexcept
+{
+    sink::ring_buffer::span span;
+
+    if ((span = sinks_[i]->buf_.read_span()).empty())
+        return true;
+
+    destroy = false;
+    current_sink_ = i;
+    flush_pending_ = true;
+    buf.latency = sinks_[i]->latency_.get();
+
+    read_clock(ts, ts_stale);
+
+    if (sinks_[i]->overwrite_) [[unlikely]]
+        return read_overwrite_sink(i, span.size(), ts, n_events);
+
+    // span.end is capped to the end of the first mapping to guarantee that
+    // data is only read from the same address that it was written to (the
+    // sink always begins log records in the first mapping, so we do not
+    // read a record beginning in the second mapping). This is done to
+    // avoid undefined behaviour---reading an object from a different
+    // address than it was written to will work on Intel and probably many
+    // other CPUs but is outside of what is permitted by the C++ memory
+    // model.
+    std::byte* pos = span.begin();
+    std::byte* end = std::min(span.end(), sinks_[i]->buf_.end());
+    // Space in a multi-producer sink may have been reserved but not yet
+    // written, in which case the record's function pointer is still null
+    // and processing of the sink stops until a later pass.
+    const bool multi_producer = sinks_[i]->multi_producer_;
+    const std::size_t n_events_start = n_events;
+    do
+    {
+        assert(std::uintptr_t(pos) % alignof(sink::fptr_t) == 0);
+        assert(!destroy);
+        sink::fptr_t fptr;
+        if (multi_producer) [[unlikely]]
+        {
+            if ((fptr = sink::ring_buffer::committed<sink::fptr_t>(pos)) == nullptr)
+                break;
+        }
+        else
+        {
+            fptr = *reinterpret_cast<const sink::fptr_t*>(pos);
+        }
+        pos = fptr(buf, pos, *this, ts, sink_info_[i].name);
+        ++n_events;
+    } while (pos < end);
+
+    if (destroy)
+    {
+        remove_sink(i);
+        return false;
+    }
+
+    const auto nread = sink::ring_buffer::size_type(pos - span.begin());
+
+    add_relaxed(sink_info_[i].n_records, n_events - n_events_start);
+    add_relaxed(sink_info_[i].n_bytes, nread);
+    if (multi_producer) [[unlikely]]
+        sinks_[i]->buf_.reduce_readable_and_zero(nread);
+    else
+        sinks_[i]->buf_.reduce_readable(nread);
+
+    if (pos == span.end())
+        print_dropped(i, buf, ts);
+    else
+        rearm_sink(i);
+
+    publish_sink_stats(i);
+
+    return true;
+}
+
+XTR_FUNC
+void xtr::detail::consumer::read_clock(char* ts, bool& ts_stale) noexcept
+{
+    // Read the clock once per loop over sinks
+    if (ts_stale)
+    {
+        read_start_ = tsc::now().ticks;
+        const xtr::timespec now = clock_();
+        fmt::format_to(ts, FMT_COMPILE("{}"), now);
+        if (buf.binary != nullptr)
+            buf.binary->now = now;
+        if (buf.reorder != nullptr)
+            buf.reorder->now = now;
+        ts_stale = false;
+    }
+}
+
+XTR_FUNC
+void xtr::detail::consumer::read_sinks_parallel(
+    bool full_scan, char* ts, bool& ts_stale, std::size_t& n_events) noexcept
+{
+    batches_.clear();
+
+    const auto add_batch = [this](std::size_t i)
+    {
+        const sink::ring_buffer::span span = sinks_[i]->buf_.read_span();
+        if (span.empty())
+            return;
+        if (sinks_[i]->overwrite_) [[unlikely]]
+        {
+            // Read by read_sink below, see read_overwrite_sink
+            batches_.push_back({.sink = i, .deferred = true});
+            return;
+        }
+        batches_.push_back(
+            {.sink = i,
+             .begin = span.begin(),
+             .pos = span.begin(),
+             .end = std::min(span.end(), sinks_[i]->buf_.end()),
+             .span_end = span.end()});
+    };
+
+    if (full_scan)
+    {
+        for (std::size_t i = 0; i != sinks_.size(); ++i)
+            add_batch(i);
+    }
+    else
+    {
+        doorbell_.drain(
+            std::uint32_t(slot_index_.size()),
+            [&](std::uint32_t slot)
+            {
+                if (slot_index_[slot] != doorbell::npos)
+                    add_batch(slot_index_[slot]);
+            });
+    }
+
+    if (batches_.empty())
+        return;
+
+    // A single sink cannot be formatted by more than one thread, as the
+    // start of each record is only known once the previous record has been
+    // read, so is read by this thread directly into buf.
+    if (batches_.size() == 1)
+    {
+        read_sink(batches_[0].sink, ts, ts_stale, n_events);
+        return;
+    }
+
+    // The doorbell is drained in slot order rather than sink order
+    if (!full_scan)
+    {
+        std::sort(
+            batches_.begin(),
+            batches_.end(),
+            [](const batch& x, const batch& y) { return x.sink < y.sink; });
+    }
+
+    flush_pending_ = true;
+    read_clock(ts, ts_stale);
+
+    // Batches are divided into contiguous groups, each formatted into its own
+    // buffer by one thread. Several groups per thread are used to balance
+    // the load between threads when some sinks are busier than others.
+    const std::size_t n_groups =
+        std::min(batches_.size(), 4 * (format_pool_->size() + 1));
+    assert(n_groups > 1);
+    while (groups_.size() < n_groups)
+    {
+        groups_.emplace_back(
+            std::make_unique<memory_storage>(), buf.lstyle, /* binary_format= */ false);
+    }
+
+    // Records may only be formatted concurrently with each other, so
+    // commands are deferred (see trampolineN), and neither sinks_ nor
+    // sink_info_ may be modified until all groups have been formatted.
+    auto format_group = [&, this](std::size_t g)
+    {
+        buffer& out = groups_[g];
+        out.lstyle = buf.lstyle;
+        const std::size_t first = g * batches_.size() / n_groups;
+        const std::size_t last = (g + 1) * batches_.size() / n_groups;
+        for (std::size_t b = first; b != last; ++b)
+            format_batch(batches_[b], out, ts);
+        out.flush();
+    };
+
+    deferring_commands_ = true;
+    format_pool_->run(n_groups, format_group);
+    deferring_commands_ = false;
+
+    // Output is written in the same order as the sinks were visited in, and
+    // records are only released from each sink once they have been formatted.
+    // Dropped message warnings are written by format_batch, so also appear in
+    // the same place as they would without format threads.
+    for (std::size_t g = 0; g != n_groups; ++g)
+    {
+        auto& storage = static_cast<memory_storage&>(groups_[g].storage());
+        buf.append(storage.data());
+        storage.clear();
+    }
+
+    for (const auto& b : batches_)
+    {
+        if (b.deferred && b.pos == b.begin)
+            continue;
+        n_events += b.n_events;
+        sink& s = *sinks_[b.sink];
+        const auto nread = sink::ring_buffer::size_type(b.pos - b.begin);
+        add_relaxed(sink_info_[b.sink].n_records, b.n_events);
+        add_relaxed(sink_info_[b.sink].n_bytes, nread);
+        if (s.multi_producer_) [[unlikely]]
+            s.buf_.reduce_readable_and_zero(nread);
+        else
+            s.buf_.reduce_readable(nread);
+        if (b.deferred)
+            continue;
+        if (b.pos != b.span_end)
+            rearm_sink(b.sink);
+        publish_sink_stats(b.sink);
+    }
+
+    // Sinks that stopped at a command are read again by this thread. They
+    // are visited in descending order as read_sink may remove a sink, which
+    // moves the last sink into its place. Records from the command onwards
+    // are therefore written after the records read from other sinks in this
+    // pass, see logger::set_format_threads.
+    for (auto b = batches_.rbegin(); b != batches_.rend(); ++b)
+    {
+        if (b->deferred)
+            read_sink(b->sink, ts, ts_stale, n_events);
+    }
+}
+
+XTR_FUNC
+void xtr::detail::consumer::format_batch(
+    batch& b, buffer& out, const char* ts) noexcept
+{
+    // Overwrite sinks are read by the consumer thread, see add_batch
+    if (b.pos == nullptr) [[unlikely]]
+        return;
+
+    std::string& name = sink_info_[b.sink].name;
+    const bool multi_producer = sinks_[b.sink]->multi_producer_;
+    out.latency = sinks_[b.sink]->latency_.get();
+    do
+    {
+        sink::fptr_t fptr;
+        if (multi_producer) [[unlikely]]
+        {
+            if ((fptr = sink::ring_buffer::committed<sink::fptr_t>(b.pos)) == nullptr)
+                return;
+        }
+        else
+        {
+            fptr = *reinterpret_cast<const sink::fptr_t*>(b.pos);
+        }
+        std::byte* next = fptr(out, b.pos, *this, ts, name);
+        if (next == b.pos)
+        {
+            b.deferred = true;
+            return;
+        }
+        b.pos = next;
+        ++b.n_events;
+    } while (b.pos < b.end);
+
+    if (b.pos == b.span_end)
+        print_dropped(b.sink, out, ts);
+}
+
+XTR_FUNC
+bool xtr::detail::consumer::read_overwrite_sink(
+    std::size_t i, std::size_t nbytes, const char* ts, std::size_t& n_events) noexcept
+{
+    // Records are claimed one at a time, as the producer may discard any
+    // record that has not yet been claimed. At most nbytes (the amount of
+    // data available at the start of the pass) are read, so that a busy
+    // producer cannot prevent other sinks from being read.
+    std::size_t nread = 0;
+    std::byte* record;
+    while (nread < nbytes && (record = sinks_[i]->buf_.claim_oldest()) != nullptr)
+    {
+        assert(!destroy);
+        const auto fptr = *reinterpret_cast<const sink::fptr_t*>(record);
+        const auto size = sink::ring_buffer::size_type(
+            fptr(buf, record, *this, ts, sink_info_[i].name) - record);
+        ++n_events;
+
+        if (destroy)
+        {
+            // The sink may no longer exist so it cannot be released
+            remove_sink(i);
+            return false;
+        }
+
+        sinks_[i]->buf_.release_oldest(size);
+        nread += size;
+        add_relaxed(sink_info_[i].n_records, 1);
+        add_relaxed(sink_info_[i].n_bytes, size);
+    }
+
+    print_dropped(i, buf, ts);
+    publish_sink_stats(i);
+
+    // Only nbytes were read, so records may remain
+    rearm_sink(i);
+    return true;
+}
+
+XTR_FUNC
+void xtr::detail::consumer::remove_sink(std::size_t i) noexcept
+{
+    if (const std::uint32_t slot = sink_info_[i].stats_slot; slot != shared_stats::npos)
+        shared_stats_->release(slot);
+
+    std::scoped_lock lock{sinks_mutex_};
+
+    if (const std::uint32_t slot = sink_info_[i].slot; slot != doorbell::npos)
+    {
+        slot_index_[slot] = doorbell::npos;
+        free_slots_.push_back(slot);
+    }
+    else if (doorbell_enabled_)
+    {
+        --n_unslotted_;
+    }
+
+    using std::swap;
+    swap(sinks_[i], sinks_.back()); // possible self-swap, ok
+    swap(sink_info_[i], sink_info_.back());
+    sinks_.pop_back();
+    sink_info_.pop_back();
+
+    if (i != sinks_.size() && sink_info_[i].slot != doorbell::npos)
+        slot_index_[sink_info_[i].slot] = std::uint32_t(i);
+}
+
+XTR_FUNC
+void xtr::detail::consumer::rearm_sink(std::size_t i) noexcept
+{
+    if (sink_info_[i].slot != doorbell::npos)
+        doorbell_.ring(sink_info_[i].slot);
+}
+
+XTR_FUNC
+void xtr::detail::consumer::print_dropped(
+    std::size_t i, buffer& out, const char* ts) noexcept
+{
+    std::size_t n_dropped;
+    if ((n_dropped = sinks_[i]->dropped_count()) > 0)
+    {
+        detail::print(
+            out,
+            FMT_COMPILE("{}{} {}: {} messages dropped\n"),
+            log_level_t::warning,
+            ts,
+            sink_info_[i].name,
+            n_dropped);
+        std::scoped_lock lock{sinks_mutex_};
+        sink_info_[i].dropped_count += n_dropped;
+        counters_.n_dropped += n_dropped;
+    }
+}
+
+XTR_FUNC
+void xtr::detail::consumer::assign_slot(std::size_t i) noexcept
+{
+    std::uint32_t slot;
+
+    if (!free_slots_.empty())
+    {
+        slot = free_slots_.back();
+        free_slots_.pop_back();
+    }
+    else if (slot_index_.size() < doorbell::capacity)
+    {
+        slot = std::uint32_t(slot_index_.size());
+        slot_index_.push_back(doorbell::npos);
+    }
+    else
+    {
+        ++n_unslotted_;
+        return;
+    }
+
+    {
+        std::scoped_lock lock{sinks_mutex_};
+        sink_info_[i].slot = slot;
+    }
+    slot_index_[slot] = std::uint32_t(i);
+    sinks_[i]->buf_.set_doorbell_slot(slot);
+    // Data may have been written before the slot was assigned
+    doorbell_.ring(slot);
+}
+
 XTR_FUNC
 void xtr::detail::consumer::add_sink(sink& s, const std::string& name)
 {
-    sinks_.push_back(sink_handle{&s, name});
+    // Space for every sink to be assigned a new slot is reserved before the
+    // sink is added, so that assign_slot cannot throw
+    const std::size_t max_slots = std::min<std::size_t>(
+        doorbell::capacity, slot_index_.size() + sinks_.size() + 1);
+    if (slot_index_.capacity() < max_slots)
+        slot_index_.reserve(std::max(max_slots, 2 * slot_index_.capacity()));
+
+    const std::uint32_t stats_slot =
+        shared_stats_ != nullptr ? shared_stats_->allocate(name) : shared_stats::npos;
+
+    {
+        std::scoped_lock lock{sinks_mutex_};
+        sinks_.push_back(&s);
+        sink_info_.push_back(
+            sink_handle{.name = name, .stats_slot = stats_slot});
+    }
+
+    publish_sink_stats(sinks_.size() - 1);
+
+    if (doorbell_enabled_)
+    {
+        assign_slot(sinks_.size() - 1);
+    }
+    else if (sinks_.size() >= doorbell_min_sinks)
+    {
+        doorbell_enabled_ = true;
+        for (std::size_t i = 0; i != sinks_.size(); ++i)
+            assign_slot(i);
+    }
+}
+
+XTR_FUNC
+void xtr::detail::consumer::close_current_sink() noexcept
+{
+    // The sink may be destructed as soon as this function returns, so it
+    // must be hidden from other shards immediately rather than once it has
+    // been removed by read_sink.
+    {
+        std::scoped_lock lock{sinks_mutex_};
+        sinks_[current_sink_] = nullptr;
+    }
+    destroy = true;
+}
+
+XTR_FUNC
+void xtr::detail::consumer::set_sink_name(std::string& name, std::string new_name)
+{
+    {
+        std::scoped_lock lock{sinks_mutex_};
+        name = std::move(new_name);
+    }
+
+    if (shared_stats_ == nullptr)
+        return;
+
+    const auto it = std::find_if(
+        sink_info_.begin(),
+        sink_info_.end(),
+        [&](const sink_handle& info) { return &info.name == &name; });
+    if (it != sink_info_.end() && it->stats_slot != shared_stats::npos)
+        shared_stats_->set_name(it->stats_slot, name);
+}
+
+XTR_FUNC
+void xtr::detail::consumer::add_shard(consumer& c)
+{
+    shards_.push_back(&c);
+}
+
+XTR_FUNC
+void xtr::detail::consumer::reopen_shard() noexcept
+{
+    const std::uint64_t generation = reopen_requested_.load(std::memory_order_acquire);
+    buf.flush();
+    const int errnum = buf.storage().reopen();
+    if (errnum == 0 && buf.binary != nullptr)
+        buf.binary->reset();
+    // The error is reported by the first shard's consumer, see
+    // check_reopen_reply
+    reopen_errno_.store(errnum, std::memory_order_relaxed);
+    reopen_completed_.store(generation, std::memory_order_release);
+}
+
+XTR_FUNC
+void xtr::detail::consumer::check_reopen_reply() noexcept
+{
+    int errnum = 0;
+
+    for (std::size_t i = 1; i < shards_.size(); ++i)
+    {
+        consumer& c = *shards_[i];
+        if (c.reopen_completed_.load(std::memory_order_acquire) == reopen_generations_[i])
+        {
+            if (errnum == 0)
+                errnum = c.reopen_errno_.load(std::memory_order_relaxed);
+        }
+        else if (!c.is_stopped()) // Stopped shards no longer write
+        {
+            return;
+        }
+    }
+
+#if __cpp_exceptions
+    try
+    {
+#endif
+        if (errnum != 0)
+            cmds_->send_error(reopen_reply_fd_, std::strerror(errnum));
+        else
+            cmds_->send(reopen_reply_fd_, detail::frame<detail::success>());
+#if __cpp_exceptions
+    }
+    catch (const std::exception& e)
+    {
+        fmt::print(stderr, FMT_COMPILE("Error sending reopen reply: {}\n"), e.what());
+    }
+#endif
+
+    cmds_->complete_reply(reopen_reply_fd_);
+    reopen_reply_fd_ = -1;
+}
+
+template<typename Func>
+void xtr::detail::consumer::for_each_sink(Func&& func)
+{
+    for (consumer* c : shards_)
+    {
+        std::scoped_lock lock{c->sinks_mutex_};
+        // The first sink of each consumer is its control sink, and sinks
+        // that are closing are null.
+        for (std::size_t i = 1; i < c->sinks_.size(); ++i)
+        {
+            if (c->sinks_[i] != nullptr)
+                func(*c->sinks_[i], c->sink_info_[i]);
+        }
+    }
+}
+
+XTR_FUNC
+xtr::detail::consumer::counters xtr::detail::consumer::snapshot() const noexcept
+{
+    counters c = counters_;
+    c.n_bytes_formatted = buf.n_bytes_written();
+    c.n_bytes_submitted = buf.n_bytes_submitted;
+    c.io_ticks = buf.io_ticks;
+    return c;
+}
+
+XTR_FUNC
+void xtr::detail::consumer::publish_metrics() noexcept
+{
+    constexpr auto relaxed = std::memory_order_relaxed;
+    published_.n_events.store(counters_.n_events, relaxed);
+    published_.n_bytes_written.store(buf.n_bytes_submitted, relaxed);
+    published_.n_errors.store(buf.storage().error_count(), relaxed);
+}
+
+XTR_FUNC
+void xtr::detail::consumer::publish_sink_stats(std::size_t i) noexcept
+{
+    const sink_handle& info = sink_info_[i];
+    if (info.stats_slot == shared_stats::npos)
+        return;
+
+    sink& s = *sinks_[i];
+    shared_stats_->publish(
+        info.stats_slot,
+        sink_stats{
+            .level = s.level(),
+            .buf_capacity = s.buf_.capacity(),
+            .buf_nbytes = s.buf_.read_span().size(),
+            .dropped_count = info.dropped_count,
+            .n_records = info.n_records,
+            .n_bytes = info.n_bytes});
+}
+
+XTR_FUNC
+xtr::pump_io_stats xtr::detail::consumer::make_stats(
+    const counters& now, const counters& since) noexcept
+{
+    return pump_io_stats{
+        .n_events = now.n_events - since.n_events,
+        .n_bytes_formatted = now.n_bytes_formatted - since.n_bytes_formatted,
+        .n_bytes_submitted = now.n_bytes_submitted - since.n_bytes_submitted,
+        .n_dropped = now.n_dropped - since.n_dropped,
+        .format_time = ticks_to_nanos(now.format_ticks - since.format_ticks),
+        .io_time = ticks_to_nanos(now.io_ticks - since.io_ticks),
+        .command_time = ticks_to_nanos(now.command_ticks - since.command_ticks)};
+}
+
+XTR_FUNC
+void xtr::detail::consumer::get_io_stats(
+    pump_io_stats& total, std::vector<sink_io_stats>& sinks) const
+{
+    add_io_stats(total, make_stats(snapshot(), counters{}));
+
+    // The first sink is the control sink, and sinks that are closing are null
+    for (std::size_t i = 1; i < sinks_.size(); ++i)
+    {
+        if (sinks_[i] == nullptr)
+            continue;
+        const sink_handle& info = sink_info_[i];
+        sinks.push_back(
+            sink_io_stats{
+                .name = info.name,
+                .n_records = info.n_records,
+                .dropped_count = info.dropped_count});
+    }
 }
 
 XTR_FUNC
@@ -200,6 +1015,21 @@ void xtr::detail::consumer::set_command_path(std::string path) noexcept
 
     cmds_->register_callback<detail::reopen>(
         std::bind_front(&consumer::reopen_handler, this));
+
+    cmds_->register_callback<detail::site_status>(
+        std::bind_front(&consumer::site_status_handler, this));
+
+    cmds_->register_callback<detail::set_site_state>(
+        std::bind_front(&consumer::set_site_state_handler, this));
+
+    cmds_->register_callback<detail::latency>(
+        std::bind_front(&consumer::latency_handler, this));
+
+    cmds_->register_callback<detail::metrics>(
+        std::bind_front(&consumer::metrics_handler, this));
+
+    cmds_->register_callback<detail::stats_region>(
+        std::bind_front(&consumer::stats_region_handler, this));
 #else
     // This can be removed when libc++ supports bind_front
     cmds_->register_callback<detail::status>(
@@ -213,6 +1043,26 @@ void xtr::detail::consumer::set_command_path(std::string path) noexcept
     cmds_->register_callback<detail::reopen>(
         [this](auto&&... args)
         { reopen_handler(std::forward<decltype(args)>(args)...); });
+
+    cmds_->register_callback<detail::site_status>(
+        [this](auto&&... args)
+        { site_status_handler(std::forward<decltype(args)>(args)...); });
+
+    cmds_->register_callback<detail::set_site_state>(
+        [this](auto&&... args)
+        { set_site_state_handler(std::forward<decltype(args)>(args)...); });
+
+    cmds_->register_callback<detail::latency>(
+        [this](auto&&... args)
+        { latency_handler(std::forward<decltype(args)>(args)...); });
+
+    cmds_->register_callback<detail::metrics>(
+        [this](auto&&... args)
+        { metrics_handler(std::forward<decltype(args)>(args)...); });
+
+    cmds_->register_callback<detail::stats_region>(
+        [this](auto&&... args)
+        { stats_region_handler(std::forward<decltype(args)>(args)...); });
 #endif
 }
 
@@ -232,23 +1082,24 @@ void xtr::detail::consumer::status_handler(int fd, detail::status& st)
         return;
     }
 
-    for (std::size_t i = 1; i < sinks_.size(); ++i)
-    {
-        auto& s = sinks_[i];
-
-        if (!(*matcher)(s.name.c_str()))
-            continue;
+    for_each_sink(
+        [&](sink& s, sink_handle& info)
+        {
+            if (!(*matcher)(info.name.c_str()))
+                return;
 
-        detail::frame<detail::sink_info> sif;
+            detail::frame<detail::sink_info> sif;
 
-        sif->level = s->level();
-        sif->buf_capacity = s->buf_.capacity();
-        sif->buf_nbytes = s->buf_.read_span().size();
-        sif->dropped_count = s.dropped_count;
-        detail::strzcpy(sif->name, s.name);
+            sif->level = s.level();
+            sif->buf_capacity = s.buf_.capacity();
+            sif->buf_nbytes = s.buf_.read_span().size();
+            sif->dropped_count = info.dropped_count;
+            sif->n_records = load_relaxed(info.n_records);
+            sif->n_bytes = load_relaxed(info.n_bytes);
+            detail::strzcpy(sif->name, info.name);
 
-        cmds_->send(fd, sif);
-    }
+            cmds_->send(fd, sif);
+        });
 }
 
 XTR_FUNC
@@ -273,15 +1124,12 @@ void xtr::detail::consumer::set_level_handler(int fd, detail::set_level& sl)
         return;
     }
 
-    for (std::size_t i = 1; i < sinks_.size(); ++i)
-    {
-        auto& s = sinks_[i];
-
-        if (!(*matcher)(s.name.c_str()))
-            continue;
-
-        s->set_level(sl.level);
-    }
+    for_each_sink(
+        [&](sink& s, const sink_handle& info)
+        {
+            if ((*matcher)(info.name.c_str()))
+                s.set_level(sl.level);
+        });
 
     cmds_->send(fd, detail::frame<detail::success>());
 }
@@ -289,9 +1137,310 @@ void xtr::detail::consumer::set_level_handler(int fd, detail::set_level& sl)
 XTR_FUNC
 void xtr::detail::consumer::reopen_handler(int fd, detail::reopen& /* unused */)
 {
+    if (reopen_reply_fd_ != -1)
+    {
+        cmds_->send_error(fd, "A reopen is already in progress");
+        return;
+    }
+
     buf.flush();
     if (const int errnum = buf.storage().reopen())
+    {
         cmds_->send_error(fd, std::strerror(errnum));
-    else
+        return;
+    }
+    // A reopened binary log is a new file, so needs its own header and
+    // definitions.
+    if (buf.binary != nullptr)
+        buf.binary->reset();
+
+    if (shards_.size() == 1)
+    {
         cmds_->send(fd, detail::frame<detail::success>());
+        return;
+    }
+
+    // Other shards reopen their storage at the start of their next pass, the
+    // reply is sent once all have done so (see check_reopen_reply) so that
+    // the old file is no longer written to once the command completes.
+    cmds_->defer_reply(fd);
+    reopen_generations_.resize(shards_.size());
+    for (std::size_t i = 1; i < shards_.size(); ++i)
+    {
+        consumer& c = *shards_[i];
+        reopen_generations_[i] =
+            c.reopen_requested_.fetch_add(1, std::memory_order_seq_cst) + 1;
+        // Either the shard sees the request on the pass after parking, or
+        // the park word is seen here, see consumer::idle
+        if (c.parked_.load(std::memory_order_seq_cst) != 0)
+            unpark(c.parked_);
+    }
+    reopen_reply_fd_ = fd;
+}
+
+XTR_FUNC
+void xtr::detail::consumer::site_status_handler(int fd, detail::site_status& ss)
+{
+    ss.pattern.text[sizeof(ss.pattern.text) - 1] = '\0';
+
+    const auto matcher =
+        detail::make_matcher(ss.pattern.type, ss.pattern.text, ss.pattern.ignore_case);
+
+    if (!matcher->valid())
+    {
+        detail::frame<detail::error> ef;
+        matcher->error_reason(ef->reason, sizeof(ef->reason));
+        cmds_->send(fd, ef);
+        return;
+    }
+
+    // Statements in templates have a site per instantiation, these are
+    // listed once as their states are always set together.
+    std::set<std::tuple<std::string_view, std::uint32_t, std::string_view>> seen;
+
+    for (log_site* site = log_sites(); site != nullptr; site = site->next())
+    {
+        if (!match_site(*matcher, *site))
+            continue;
+
+        if (!seen.emplace(site->file, site->line, site->format).second)
+            continue;
+
+        detail::frame<detail::site_info> sif;
+
+        sif->level = site->level;
+        sif->state = site->state();
+        sif->line = site->line;
+        detail::strzcpy(sif->file, std::string_view{site->file});
+        detail::strzcpy(sif->format, std::string_view{site->format});
+
+        cmds_->send(fd, sif);
+    }
+}
+
+XTR_FUNC
+void xtr::detail::consumer::set_site_state_handler(
+    int fd, detail::set_site_state& ss)
+{
+    ss.pattern.text[sizeof(ss.pattern.text) - 1] = '\0';
+
+    if (ss.state > site_state_t::disabled)
+    {
+        cmds_->send_error(fd, "Invalid state");
+        return;
+    }
+
+    const auto matcher =
+        detail::make_matcher(ss.pattern.type, ss.pattern.text, ss.pattern.ignore_case);
+
+    if (!matcher->valid())
+    {
+        detail::frame<detail::error> ef;
+        matcher->error_reason(ef->reason, sizeof(ef->reason));
+        cmds_->send(fd, ef);
+        return;
+    }
+
+    for (log_site* site = log_sites(); site != nullptr; site = site->next())
+    {
+        if (match_site(*matcher, *site))
+            site->set_state(ss.state);
+    }
+
+    cmds_->send(fd, detail::frame<detail::success>());
+}
+
+XTR_FUNC
+void xtr::detail::consumer::latency_handler(int fd, detail::latency& lt)
+{
+    lt.pattern.text[sizeof(lt.pattern.text) - 1] = '\0';
+
+    const auto matcher =
+        detail::make_matcher(lt.pattern.type, lt.pattern.text, lt.pattern.ignore_case);
+
+    if (!matcher->valid())
+    {
+        detail::frame<detail::error> ef;
+        matcher->error_reason(ef->reason, sizeof(ef->reason));
+        cmds_->send(fd, ef);
+        return;
+    }
+
+    const auto send_latency =
+        [&](const latency_histogram& h, latency_kind_t kind, std::string_view name)
+    {
+        const auto nanos = [](std::uint64_t ticks)
+        { return std::uint64_t(ticks_to_nanos(ticks).count()); };
+
+        detail::frame<detail::latency_info> lif;
+
+        lif->kind = kind;
+        lif->count = h.count();
+        lif->p50 = nanos(h.percentile(0.5));
+        lif->p90 = nanos(h.percentile(0.9));
+        lif->p99 = nanos(h.percentile(0.99));
+        lif->p999 = nanos(h.percentile(0.999));
+        lif->max = nanos(h.max());
+        detail::strzcpy(lif->name, name);
+
+        cmds_->send(fd, lif);
+    };
+
+    // Only sinks created with sink_flags_t::measure_latency are reported
+    for_each_sink(
+        [&](sink& s, const sink_handle& info)
+        {
+            if (s.latency_ != nullptr && (*matcher)(info.name.c_str()))
+                send_latency(*s.latency_, latency_kind_t::queue, info.name);
+        });
+
+    for (std::size_t i = 0; i != shards_.size(); ++i)
+    {
+        if (const latency_histogram* h = shards_[i]->buf.storage().write_latency())
+            send_latency(*h, latency_kind_t::write, fmt::format("shard {}", i));
+    }
+}
+
+XTR_FUNC
+void xtr::detail::consumer::metrics_handler(int fd, detail::metrics& /* unused */)
+{
+    struct sink_metrics
+    {
+        std::size_t buf_capacity = 0;
+        std::size_t buf_nbytes = 0;
+        std::size_t dropped_count = 0;
+    };
+
+    // Sink names need not be unique (e.g. copied sinks, or sinks on different
+    // shards), but each series must be, so sinks of the same name are summed.
+    // Labelling sinks by shard and slot instead would not identify a sink
+    // across scrapes, as slots are reused once sinks are closed.
+    std::map<std::string, sink_metrics, std::less<>> sinks;
+
+    for_each_sink(
+        [&](sink& s, const sink_handle& info)
+        {
+            sink_metrics& sm = sinks[info.name];
+            sm.buf_capacity += s.buf_.capacity();
+            sm.buf_nbytes += s.buf_.read_span().size();
+            sm.dropped_count += info.dropped_count;
+        });
+
+    // Each metric family is written in full before the next, as required by
+    // the text exposition format.
+    std::string text;
+
+    const auto family =
+        [&](std::string_view name, std::string_view type, std::string_view help)
+    {
+        fmt::format_to(
+            std::back_inserter(text),
+            FMT_COMPILE("# HELP {0} {2}\n# TYPE {0} {1}\n"),
+            name,
+            type,
+            help);
+    };
+
+    const auto sink_sample =
+        [&](std::string_view name, std::string_view sink_name, std::size_t value)
+    {
+        text += name;
+        text += "{sink=\"";
+        append_label_value(text, sink_name);
+        fmt::format_to(
+            std::back_inserter(text), FMT_COMPILE("\"}} {}\n"), value);
+    };
+
+    const auto shard_sample =
+        [&](std::string_view name, std::size_t shard, std::size_t value)
+    {
+        fmt::format_to(
+            std::back_inserter(text),
+            FMT_COMPILE("{}{{shard=\"{}\"}} {}\n"),
+            name,
+            shard,
+            value);
+    };
+
+    family(
+        "xtr_sink_buffer_used_bytes",
+        "gauge",
+        "Bytes of log records waiting to be read from the sink.");
+    for (const auto& [name, sm] : sinks)
+        sink_sample("xtr_sink_buffer_used_bytes", name, sm.buf_nbytes);
+
+    family(
+        "xtr_sink_buffer_capacity_bytes",
+        "gauge",
+        "Capacity of the sink's buffer.");
+    for (const auto& [name, sm] : sinks)
+        sink_sample("xtr_sink_buffer_capacity_bytes", name, sm.buf_capacity);
+
+    family(
+        "xtr_sink_dropped_total",
+        "counter",
+        "Log statements dropped because the sink was full.");
+    for (const auto& [name, sm] : sinks)
+        sink_sample("xtr_sink_dropped_total", name, sm.dropped_count);
+
+    constexpr auto relaxed = std::memory_order_relaxed;
+
+    family(
+        "xtr_consumer_events_total",
+        "counter",
+        "Events read from sinks by the consumer thread.");
+    for (std::size_t i = 0; i != shards_.size(); ++i)
+    {
+        shard_sample(
+            "xtr_consumer_events_total",
+            i,
+            shards_[i]->published_.n_events.load(relaxed));
+    }
+
+    family(
+        "xtr_consumer_written_bytes_total",
+        "counter",
+        "Bytes submitted to storage by the consumer thread.");
+    for (std::size_t i = 0; i != shards_.size(); ++i)
+    {
+        shard_sample(
+            "xtr_consumer_written_bytes_total",
+            i,
+            shards_[i]->published_.n_bytes_written.load(relaxed));
+    }
+
+    family(
+        "xtr_consumer_storage_errors_total",
+        "counter",
+        "Failed writes to storage by the consumer thread.");
+    for (std::size_t i = 0; i != shards_.size(); ++i)
+    {
+        shard_sample(
+            "xtr_consumer_storage_errors_total",
+            i,
+            shards_[i]->published_.n_errors.load(relaxed));
+    }
+
+    // The text may exceed max_frame_size, so is split over several frames
+    detail::frame<detail::metrics_text> mtf;
+    for (std::size_t pos = 0; pos < text.size(); pos += sizeof(mtf->text))
+    {
+        const std::size_t n = std::min(text.size() - pos, sizeof(mtf->text));
+        text.copy(mtf->text, n, pos);
+        mtf->size = std::uint32_t(n);
+        cmds_->send(fd, mtf);
+    }
+}
+
+XTR_FUNC
+void xtr::detail::consumer::stats_region_handler(
+    int fd, detail::stats_region& /* unused */)
+{
+    if (shared_stats_ == nullptr)
+    {
+        cmds_->send_error(fd, "Shared statistics are not enabled");
+        return;
+    }
+
+    cmds_->send(fd, detail::frame<detail::stats_region_info>(), shared_stats_->fd());
 }
@@ -0,0 +1,151 @@
+// Copyright 2026 Chris E. Holloway
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "xtr/detail/format_pool.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+
+XTR_FUNC
+xtr::detail::format_pool::format_pool(std::size_t n_threads)
+{
+    threads_.reserve(n_threads);
+#if __cpp_exceptions
+    try
+    {
+#endif
+        for (std::size_t i = 0; i != n_threads; ++i)
+            threads_.emplace_back(&format_pool::worker, this);
+#if __cpp_exceptions
+    }
+    catch (...)
+    {
+        // Threads that were started must be joined before threads_ is
+        // destroyed
+        stop();
+        throw;
+    }
+#endif
+}
+
+XTR_FUNC
+xtr::detail::format_pool::~format_pool()
+{
+    stop();
+}
+
+XTR_FUNC
+void xtr::detail::format_pool::stop() noexcept
+{
+    {
+        std::scoped_lock lock{mutex_};
+        stop_ = true;
+    }
+    work_cv_.notify_all();
+    for (auto& t : threads_)
+        t.join();
+}
+
+XTR_FUNC
+void xtr::detail::format_pool::run(std::size_t n, job_t job, void* ctx) noexcept
+{
+    assert(n <= UINT32_MAX);
+
+    std::uint32_t round;
+    {
+        std::scoped_lock lock{mutex_};
+        round = ++round_;
+        job_ = job;
+        ctx_ = ctx;
+        n_ = n;
+        n_done_ = 0;
+        next_.store(std::uint64_t(round) << 32, std::memory_order_relaxed);
+    }
+
+    // The calling thread takes the first index, so threads are only needed
+    // for the remainder.
+    for (std::size_t i = 0, w = std::min(n - (n != 0), threads_.size()); i != w; ++i)
+        work_cv_.notify_one();
+
+    const std::size_t n_done = work(round, n, job, ctx);
+
+    std::unique_lock lock{mutex_};
+    n_done_ += n_done;
+    done_cv_.wait(lock, [this] { return n_done_ == n_; });
+}
+
+XTR_FUNC
+std::size_t xtr::detail::format_pool::work(
+    std::uint32_t round, std::size_t n, job_t job, void* ctx) noexcept
+{
+    std::size_t n_done = 0;
+    std::uint64_t next = next_.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        if (std::uint32_t(next >> 32) != round || std::uint32_t(next) >= n)
+            return n_done;
+        if (next_.compare_exchange_weak(next, next + 1, std::memory_order_relaxed))
+        {
+            job(ctx, std::uint32_t(next));
+            ++n_done;
+            next = next_.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+XTR_FUNC
+void xtr::detail::format_pool::worker() noexcept
+{
+    std::uint32_t round = 0;
+    std::unique_lock lock{mutex_};
+    for (;;)
+    {
+        work_cv_.wait(lock, [&] { return stop_ || round_ != round; });
+        if (stop_)
+            return;
+        round = round_;
+        const job_t job = job_;
+        void* const ctx = ctx_;
+        const std::size_t n = n_;
+        lock.unlock();
+        const std::size_t n_done = work(round, n, job, ctx);
+        lock.lock();
+        // The round cannot have ended while this thread held an index
+        if (n_done != 0 && (n_done_ += n_done) == n_)
+            done_cv_.notify_one();
+    }
+}
+
+XTR_FUNC
+std::span<char> xtr::detail::memory_storage::allocate_buffer()
+{
+    // The previous buffer is always submitted before the next is allocated
+    // (see buffer::next_buffer), so growing data_ here is safe.
+    if (data_.size() - size_ < chunk_size)
+        data_.resize(size_ + chunk_size);
+    return {data_.data() + size_, chunk_size};
+}
+
+XTR_FUNC
+void xtr::detail::memory_storage::submit_buffer(char* buf, std::size_t size)
+{
+    size_ = std::size_t(buf - data_.data()) + size;
+}
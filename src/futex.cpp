@@ -0,0 +1,112 @@
+// Copyright 2026 Chris E. Holloway
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "xtr/detail/futex.hpp"
+
+#include <cerrno>
+#include <climits>
+#include <ctime>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <linux/membarrier.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#elif defined(__FreeBSD__)
+#include <sys/types.h>
+#include <sys/umtx.h>
+#else
+#include <chrono>
+#include <thread>
+#endif
+
+XTR_FUNC
+void xtr::detail::futex_wait(
+    std::atomic<std::uint32_t>& word, std::uint32_t expected, int timeout_ms) noexcept
+{
+    std::timespec timeout{
+        .tv_sec = timeout_ms / 1000,
+        .tv_nsec = (timeout_ms % 1000) * 1000000L};
+#if defined(__linux__)
+    // EINTR, EAGAIN (word != expected) and ETIMEDOUT may all be ignored
+    (void)::syscall(
+        SYS_futex,
+        reinterpret_cast<std::uint32_t*>(&word),
+        FUTEX_WAIT_PRIVATE,
+        expected,
+        &timeout,
+        nullptr,
+        0);
+#elif defined(__FreeBSD__)
+    (void)::_umtx_op(&word, UMTX_OP_WAIT_UINT_PRIVATE, expected, nullptr, &timeout);
+#else
+    // Fall back to sleeping for a short period, for platforms without a
+    // futex equivalent.
+    if (word.load(std::memory_order_relaxed) == expected)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+#endif
+}
+
+XTR_FUNC
+void xtr::detail::futex_wake(std::atomic<std::uint32_t>& word) noexcept
+{
+#if defined(__linux__)
+    (void)::syscall(
+        SYS_futex,
+        reinterpret_cast<std::uint32_t*>(&word),
+        FUTEX_WAKE_PRIVATE,
+        INT_MAX,
+        nullptr,
+        nullptr,
+        0);
+#elif defined(__FreeBSD__)
+    (void)::_umtx_op(&word, UMTX_OP_WAKE_PRIVATE, INT_MAX, nullptr, nullptr);
+#else
+    (void)word;
+#endif
+}
+
+XTR_FUNC
+void xtr::detail::unpark(std::atomic<std::uint32_t>& word) noexcept
+{
+    if (word.exchange(0, std::memory_order_relaxed) == parked_sleeping)
+        futex_wake(word);
+}
+
+XTR_FUNC
+bool xtr::detail::membarrier_available() noexcept
+{
+#if defined(__linux__) && defined(MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED)
+    static const bool available =
+        ::syscall(SYS_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0) == 0;
+    return available;
+#else
+    return false;
+#endif
+}
+
+XTR_FUNC
+void xtr::detail::membarrier() noexcept
+{
+#if defined(__linux__) && defined(MEMBARRIER_CMD_PRIVATE_EXPEDITED)
+    if (membarrier_available())
+        (void)::syscall(SYS_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0);
+#endif
+}
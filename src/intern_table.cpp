@@ -0,0 +1,109 @@
+// Copyright 2026 Chris E. Holloway
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "xtr/detail/intern_table.hpp"
+#include "xtr/detail/pause.hpp"
+
+#include <cstdlib>
+#include <new>
+
+XTR_FUNC
+xtr::detail::intern_table& xtr::detail::global_intern_table() noexcept
+{
+    // Intentionally never destroyed, as sinks may log interned strings while
+    // static objects are being destroyed.
+    static intern_table* const table = new intern_table;
+    return *table;
+}
+
+XTR_FUNC
+xtr::detail::intern_table::~intern_table()
+{
+    // Every entry is held by exactly one slot, see insert
+    for (auto& slot : slots_)
+        std::free(slot.load(std::memory_order_relaxed));
+}
+
+XTR_FUNC
+std::uint32_t xtr::detail::intern_table::insert(
+    std::size_t slot, std::size_t hash, std::string_view str) noexcept
+{
+    // Check before incrementing so that repeated misses on a full table
+    // cannot wrap the counter.
+    if (size_.load(std::memory_order_relaxed) >= capacity)
+        return npos;
+
+    void* mem = std::malloc(sizeof(entry) + str.size());
+    if (mem == nullptr) [[unlikely]]
+        return npos;
+
+    auto* e = ::new (mem) entry{.hash = hash, .id{pending}, .size = std::uint32_t(str.size())};
+    std::memcpy(e->data, str.data(), str.size());
+
+    // The slot is claimed before an id is taken, so that a producer losing
+    // the race to add the same string does not use up an id (or leave its
+    // entry reachable). Producers finding the entry before its id has been
+    // assigned wait for it, see wait_id.
+    for (;; ++slot)
+    {
+        entry* expected = nullptr;
+        if (slots_[slot % n_slots].compare_exchange_strong(
+                expected,
+                e,
+                std::memory_order_release,
+                std::memory_order_acquire))
+        {
+            break;
+        }
+        if (expected->hash == hash && expected->size == str.size() &&
+            std::memcmp(expected->data, str.data(), str.size()) == 0)
+        {
+            std::free(e);
+            const std::uint32_t id = expected->id.load(std::memory_order_acquire);
+            return id == pending ? wait_id(*expected) : id;
+        }
+    }
+
+    std::uint32_t id = size_.fetch_add(1, std::memory_order_relaxed);
+    if (id >= capacity)
+    {
+        // The table filled up after the check above; the string keeps its
+        // slot but has no id, so it is logged without interning.
+        id = npos;
+    }
+    else
+    {
+        // The id is published before it becomes visible to other producers,
+        // as they may write the id to a sink as soon as they read it.
+        ids_[id].store(e, std::memory_order_release);
+    }
+
+    e->id.store(id, std::memory_order_release);
+    return id;
+}
+
+XTR_FUNC
+std::uint32_t xtr::detail::intern_table::wait_id(const entry& e) noexcept
+{
+    std::uint32_t id;
+    while ((id = e.id.load(std::memory_order_acquire)) == pending)
+        pause();
+    return id;
+}
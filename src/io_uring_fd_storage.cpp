@@ -22,6 +22,7 @@
 
 #if XTR_USE_IO_URING
 #include "xtr/detail/throw.hpp"
+#include "xtr/detail/tsc.hpp"
 #include "xtr/io/detail/open.hpp"
 #include "xtr/io/io_uring_fd_storage.hpp"
 
@@ -171,6 +172,7 @@ std::span<char> xtr::io_uring_fd_storage::allocate_buffer()
     buf->size_ = 0;
     buf->offset_ = 0;
     buf->file_offset_ = offset_;
+    buf->allocate_tsc_ = detail::tsc::now().ticks;
 
     return {buf->data_, buffer_capacity_};
 }
@@ -360,6 +362,7 @@ retry:
 
     if (res < 0) [[unlikely]]
     {
+        ++error_count_;
         (void)std::fprintf(
             stderr,
             "xtr::io_uring_fd_storage::wait_for_one_cqe: "
@@ -382,6 +385,8 @@ retry:
         resubmit_buffer(buf.release(), nwritten);
         goto retry;
     }
+
+    write_latency_.record(detail::tsc::now().ticks - buf->allocate_tsc_);
 }
 
 XTR_FUNC
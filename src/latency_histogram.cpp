@@ -0,0 +1,61 @@
+// Copyright 2026 Chris E. Holloway
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "xtr/detail/latency_histogram.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+XTR_FUNC
+std::uint64_t xtr::detail::latency_histogram::count() const noexcept
+{
+    std::uint64_t result = 0;
+    for (const auto& n : counts_)
+        result += n.load(std::memory_order_relaxed);
+    return result;
+}
+
+XTR_FUNC
+std::uint64_t xtr::detail::latency_histogram::percentile(double q) const noexcept
+{
+    const std::uint64_t total = count();
+    if (total == 0)
+        return 0;
+
+    const auto target =
+        std::max(std::uint64_t(std::ceil(q * double(total))), std::uint64_t(1));
+    std::uint64_t n = 0;
+    for (std::size_t i = 0; i != bucket_count; ++i)
+    {
+        if ((n += counts_[i].load(std::memory_order_relaxed)) >= target)
+            return std::min(bucket_max(i), max());
+    }
+    return max();
+}
+
+XTR_FUNC
+std::uint64_t xtr::detail::latency_histogram::bucket_max(std::size_t index) noexcept
+{
+    if (index < 2 * sub_bucket_count)
+        return index;
+    const std::size_t shift = index / sub_bucket_count - 1;
+    const std::uint64_t sub_bucket = index - sub_bucket_count * shift;
+    return ((sub_bucket + 1) << shift) - 1;
+}
@@ -0,0 +1,50 @@
+// Copyright 2026 Chris E. Holloway
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "xtr/detail/log_site.hpp"
+
+namespace xtr::detail
+{
+    XTR_FUNC
+    std::atomic<log_site*>& log_site_head() noexcept
+    {
+        static std::atomic<log_site*> head{nullptr};
+        return head;
+    }
+}
+
+XTR_FUNC
+void xtr::detail::register_log_site(log_site& site) noexcept
+{
+    auto& head = log_site_head();
+    site.next_ = head.load(std::memory_order_relaxed);
+    while (!head.compare_exchange_weak(
+        site.next_,
+        &site,
+        std::memory_order_release,
+        std::memory_order_relaxed))
+        ;
+}
+
+XTR_FUNC
+xtr::detail::log_site* xtr::detail::log_sites() noexcept
+{
+    return log_site_head().load(std::memory_order_acquire);
+}
@@ -19,40 +19,336 @@
 // SOFTWARE.
 
 #include "xtr/logger.hpp"
+#include "xtr/detail/throw.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <pthread_np.h>
+#endif
+
+namespace xtr::detail
+{
+    // Owns the sinks created by logger::thread_sink for a given thread. The
+    // sinks are closed by their destructors when the thread exits.
+    struct thread_sink_registry
+    {
+        ~thread_sink_registry()
+        {
+            tls_sink_cache = {.owner = nullptr, .s = nullptr, .exited = true};
+        }
+
+        std::vector<std::pair<const logger*, std::unique_ptr<sink>>> sinks;
+    };
+
+    XTR_FUNC
+    thread_sink_registry& thread_sinks()
+    {
+        thread_local thread_sink_registry registry;
+        return registry;
+    }
+
+    XTR_FUNC
+    std::string thread_sink_name()
+    {
+#if defined(__linux__)
+        const long tid = ::syscall(SYS_gettid);
+#else
+        const long tid = ::pthread_getthreadid_np();
+#endif
+        return "thread-" + std::to_string(tid);
+    }
+
+    // Returns zero or an errno value
+    XTR_FUNC
+    int set_thread_affinity(const std::vector<int>& cpus) noexcept
+    {
+#if defined(__FreeBSD__)
+        cpuset_t set;
+#else
+        cpu_set_t set;
+#endif
+        CPU_ZERO(&set);
+        for (const int cpu : cpus)
+        {
+            if (cpu < 0 || cpu >= CPU_SETSIZE)
+                return EINVAL;
+            CPU_SET(cpu, &set);
+        }
+        return ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set);
+    }
+
+    // Returns zero or an errno value
+    XTR_FUNC
+    int set_thread_scheduling(int policy, int priority) noexcept
+    {
+        ::sched_param param{};
+        param.sched_priority = priority;
+        return ::pthread_setschedparam(::pthread_self(), policy, &param);
+    }
+}
 
 XTR_FUNC
-xtr::sink xtr::logger::get_sink(std::string name)
+xtr::logger::consumer_shard::consumer_shard(
+    detail::buffer bf,
+    std::string command_path,
+    std::function<std::timespec()> clock,
+    detail::idle_strategy idle,
+    std::shared_ptr<detail::shared_stats> stats) :
+    consumer(std::move(bf), std::move(command_path), std::move(clock), idle)
+{
+    control.buf_.set_reader_park_word(consumer.park_word());
+    control.buf_.set_reader_doorbell(consumer.sink_doorbell());
+#if __cpp_exceptions
+    try
+    {
+#endif
+        // The control sink must be the consumer's first sink, and must be
+        // added after it has been constructed.
+        consumer.add_sink(control, "control");
+#if __cpp_exceptions
+    }
+    catch (...)
+    {
+        // The consumer will never run, so would otherwise wait forever in its
+        // destructor
+        consumer.abandon();
+        throw;
+    }
+#endif
+    // Set after adding the control sink so that it is not published
+    consumer.set_shared_stats(std::move(stats));
+}
+
+XTR_FUNC
+void xtr::logger::abandon_shards() noexcept
+{
+    // Consumers that were started are stopped by closing their control sinks,
+    // while consumers that never ran are simply marked as stopped. No shard
+    // may be destroyed until all have stopped, see ~logger.
+    for (auto& s : shards_)
+    {
+        if (s->thread.joinable())
+        {
+            s->control.close();
+        }
+        else
+        {
+            s->control.open_ = false;
+            s->consumer.abandon();
+        }
+    }
+    for (auto& s : shards_)
+        s->consumer.wait_stopped();
+}
+
+XTR_FUNC
+xtr::logger::~logger()
+{
+    close_thread_sink();
+    for (auto& s : shards_)
+        s->control.close();
+    // The first shard's consumer reads the sink tables of the other shards
+    // when processing commands, so no shard may be destroyed until all have
+    // stopped.
+    for (auto& s : shards_)
+        s->consumer.wait_stopped();
+}
+
+XTR_FUNC
+std::vector<xtr::storage_interface_ptr> xtr::logger::storage_list(
+    storage_interface_ptr storage)
+{
+    std::vector<storage_interface_ptr> result;
+    result.push_back(std::move(storage));
+    return result;
+}
+
+XTR_FUNC
+xtr::logger::consumer_shard& xtr::logger::select_shard(
+    const std::string& name, std::size_t shard) noexcept
+{
+    if (shard == any_shard)
+        shard = std::hash<std::string>{}(name);
+    return *shards_[shard % shards_.size()];
+}
+
+XTR_FUNC
+xtr::sink xtr::logger::get_sink(
+    std::string name, std::size_t capacity, sink_flags_t flags, std::size_t shard)
 {
     return sink(
         *this,
         std::move(name),
-        default_log_level_.load(std::memory_order_relaxed));
+        default_log_level_.load(std::memory_order_relaxed),
+        capacity,
+        flags,
+        shard);
 }
 
 XTR_FUNC
-void xtr::logger::register_sink(sink& s, std::string name) noexcept
+void xtr::logger::register_sink(sink& s, std::string name, std::size_t shard) noexcept
 {
     assert(!s.open_);
-    post([&s, name = std::move(name)](detail::consumer& c, auto&)
-         { c.add_sink(s, name); });
+    consumer_shard& cs = select_shard(name, shard);
+    s.buf_.set_reader_park_word(cs.consumer.park_word());
+    s.buf_.set_reader_doorbell(cs.consumer.sink_doorbell());
+    cs.post([&s, name = std::move(name)](detail::consumer& c, auto&)
+            { c.add_sink(s, name); });
     s.open_ = true;
 }
 
+XTR_FUNC
+xtr::mpsc_sink xtr::logger::get_mpsc_sink(
+    std::string name, std::size_t capacity, sink_flags_t flags, std::size_t shard)
+{
+    return mpsc_sink(
+        *this,
+        std::move(name),
+        default_log_level_.load(std::memory_order_relaxed),
+        capacity,
+        flags,
+        shard);
+}
+
+XTR_FUNC
+void xtr::logger::register_sink(
+    mpsc_sink& s, std::string name, std::size_t shard) noexcept
+{
+    register_sink(static_cast<sink&>(s), std::move(name), shard);
+}
+
+XTR_FUNC
+xtr::sink& xtr::logger::make_thread_sink()
+{
+    if (detail::tls_sink_cache.exited) [[unlikely]]
+        detail::throw_runtime_error("Thread sink requested during thread exit");
+
+    auto& sinks = detail::thread_sinks().sinks;
+
+    auto it = std::find_if(
+        sinks.begin(),
+        sinks.end(),
+        [this](const auto& entry) { return entry.first == this; });
+
+    if (it == sinks.end())
+    {
+        auto s = std::make_unique<sink>(default_log_level_.load(std::memory_order_relaxed));
+        register_sink(*s, detail::thread_sink_name());
+        sinks.emplace_back(this, std::move(s));
+        it = std::prev(sinks.end());
+    }
+
+    detail::tls_sink_cache.owner = this;
+    detail::tls_sink_cache.s = it->second.get();
+
+    return *it->second;
+}
+
+XTR_FUNC
+void xtr::logger::close_thread_sink()
+{
+    auto& cache = detail::tls_sink_cache;
+
+    if (cache.exited)
+        return;
+
+    if (cache.owner == this)
+        cache.owner = nullptr;
+
+    std::erase_if(
+        detail::thread_sinks().sinks,
+        [this](const auto& entry) { return entry.first == this; });
+}
+
 XTR_FUNC
 void xtr::logger::set_command_path(std::string path) noexcept
 {
-    post([s = std::move(path)](detail::consumer& c, auto&) mutable
-         { c.set_command_path(std::move(s)); });
-    control_.sync();
+    consumer_shard& cs = *shards_.front();
+    cs.post([s = std::move(path)](detail::consumer& c, auto&) mutable
+            { c.set_command_path(std::move(s)); });
+    cs.control.sync();
 }
 
 XTR_FUNC
 void xtr::logger::set_log_level_style(log_level_style_t level_style) noexcept
 {
-    post([=](detail::consumer& c, auto&) { c.buf.lstyle = level_style; });
-    control_.sync();
+    for (auto& cs : shards_)
+    {
+        cs->post([=](detail::consumer& c, auto&) { c.buf.lstyle = level_style; });
+        cs->control.sync();
+    }
+}
+
+XTR_FUNC
+void xtr::logger::set_format_threads(std::size_t n)
+{
+    // Pools are started before any is handed to a shard, so that if one
+    // cannot be started no shard is changed.
+    std::vector<std::unique_ptr<detail::format_pool>> pools(shards_.size());
+    if (n != 0)
+    {
+        for (auto& pool : pools)
+            pool = std::make_unique<detail::format_pool>(n);
+    }
+
+    for (std::size_t i = 0; i != shards_.size(); ++i)
+    {
+        shards_[i]->post([pool = std::move(pools[i])](detail::consumer& c, auto&) mutable
+                         { c.set_format_pool(std::move(pool)); });
+        shards_[i]->control.sync();
+    }
+}
+
+XTR_FUNC
+void xtr::logger::set_reorder_window(std::chrono::nanoseconds window) noexcept
+{
+    for (auto& cs : shards_)
+    {
+        cs->post([=](detail::consumer& c, auto&) { c.buf.set_reorder_window(window); });
+        cs->control.sync();
+    }
+}
+
+XTR_FUNC
+void xtr::logger::set_consumer_affinity(std::vector<int> cpus, std::size_t shard)
+{
+    if (shard >= shards_.size()) [[unlikely]]
+        detail::throw_invalid_argument("Invalid shard");
+    int errnum = 0;
+    consumer_shard& cs = *shards_[shard];
+    cs.post([&errnum, cpus = std::move(cpus)](detail::consumer&, auto&)
+            { errnum = detail::set_thread_affinity(cpus); });
+    cs.control.sync();
+    if (errnum != 0)
+        detail::throw_system_error(errnum, "Failed to set consumer thread affinity");
+}
+
+XTR_FUNC
+void xtr::logger::set_consumer_scheduling(int policy, int priority, std::size_t shard)
+{
+    if (shard >= shards_.size()) [[unlikely]]
+        detail::throw_invalid_argument("Invalid shard");
+    int errnum = 0;
+    consumer_shard& cs = *shards_[shard];
+    cs.post([&errnum, policy, priority](detail::consumer&, auto&)
+            { errnum = detail::set_thread_scheduling(policy, priority); });
+    cs.control.sync();
+    if (errnum != 0)
+        detail::throw_system_error(errnum, "Failed to set consumer thread scheduling");
 }
 
 XTR_FUNC
@@ -64,5 +360,36 @@ void xtr::logger::set_default_log_level(log_level_t level)
 XTR_FUNC
 bool xtr::logger::pump_io(pump_io_stats* stats)
 {
-    return consumer_.run_once(stats);
+    if (shards_.size() == 1)
+        return shards_.front()->consumer.run_once(stats);
+
+    bool running = false;
+    pump_io_stats total{};
+
+    for (auto& cs : shards_)
+    {
+        if (cs->consumer.is_stopped())
+            continue;
+        pump_io_stats shard_stats;
+        running |= cs->consumer.run_once(&shard_stats);
+        detail::add_io_stats(total, shard_stats);
+    }
+
+    if (stats != nullptr)
+        *stats = total;
+
+    return running;
+}
+
+XTR_FUNC
+xtr::io_stats xtr::logger::get_io_stats()
+{
+    io_stats result{};
+    for (auto& cs : shards_)
+    {
+        cs->post([&result](detail::consumer& c, auto&)
+                 { c.get_io_stats(result.total, result.sinks); });
+        cs->control.sync();
+    }
+    return result;
 }
@@ -34,6 +34,10 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
 namespace xtr::detail
 {
 #if !defined(__linux__)
@@ -75,6 +79,57 @@ namespace xtr::detail
     }
 #endif
 
+#if defined(__linux__)
+    // Returns a memfd backed by explicit huge pages, or a closed descriptor
+    // if huge pages are unavailable. The pages are allocated immediately so
+    // that mapping the descriptor cannot subsequently fail due to the huge
+    // page pool being exhausted.
+    XTR_FUNC
+    file_descriptor hugetlb_memfd(std::size_t length)
+    {
+#if defined(MFD_HUGETLB)
+        file_descriptor fd(::memfd_create("xtr", MFD_CLOEXEC | MFD_HUGETLB));
+        // ftruncate fails if length is not a multiple of the huge page size
+        if (fd && ::ftruncate(fd.get(), ::off_t(length)) == 0 &&
+            XTR_TEMP_FAILURE_RETRY(::fallocate(fd.get(), 0, 0, ::off_t(length))) == 0)
+        {
+            return fd;
+        }
+#endif
+        return {};
+    }
+#endif
+
+#if defined(__linux__)
+    // Sets the NUMA memory policy of the given range to prefer the node
+    // requested via mirror_flags. This is done via syscall rather than
+    // libnuma to avoid the dependency. Failure (e.g. due to the kernel not
+    // supporting NUMA, or the node not existing) is ignored as the placement
+    // is only a hint, in the same way as for transparent huge pages.
+    XTR_FUNC
+    void set_numa_policy(void* addr, std::size_t length, int mirror_flags) noexcept
+    {
+        unsigned node;
+        if (const int n = mirror_flags >> mirror_numa_node_shift; n != 0)
+            node = unsigned(n - 1);
+        else if (
+            !(mirror_flags & mirror_numa_local) ||
+            ::syscall(SYS_getcpu, nullptr, &node, nullptr) == -1)
+            return;
+
+        constexpr int mpol_preferred = 1; // MPOL_PREFERRED from <numaif.h>
+        constexpr std::size_t max_nodes = 1024;
+        constexpr std::size_t word_bits = sizeof(unsigned long) * 8;
+        unsigned long nodemask[max_nodes / word_bits] = {};
+
+        if (node >= max_nodes)
+            return;
+
+        nodemask[node / word_bits] |= 1UL << (node % word_bits);
+        (void)::syscall(SYS_mbind, addr, length, mpol_preferred, nodemask, max_nodes, 0);
+    }
+#endif
+
     // This is required because MAP_POPULATE only sets up readable pages.
     XTR_FUNC
     void prefault_write(void* addr, std::size_t length)
@@ -93,7 +148,7 @@ namespace xtr::detail
 
 XTR_FUNC
 xtr::detail::mirrored_memory_mapping::mirrored_memory_mapping(
-    std::size_t length, int fd, std::size_t offset, int flags)
+    std::size_t length, int fd, std::size_t offset, int flags, int mirror_flags)
 {
     assert(!(flags & MAP_ANONYMOUS) || fd == -1);
     assert((flags & MAP_FIXED) == 0); // Not implemented (would be easy though)
@@ -118,12 +173,35 @@ xtr::detail::mirrored_memory_mapping::mirrored_memory_mapping(
 
     const int prot = PROT_READ | PROT_WRITE;
 
-    memory_mapping reserve(nullptr, length * 2, prot, MAP_PRIVATE | MAP_ANONYMOUS);
-
-#if !defined(__linux__)
     file_descriptor temp_fd;
+    int reserve_flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+#if defined(__linux__)
+    // Pages must not be populated until the NUMA policy has been set
+    if (mirror_flags & (mirror_numa_local | ~((1 << mirror_numa_node_shift) - 1)))
+        flags &= ~MAP_POPULATE;
+
+    if (fd == -1 && (mirror_flags & mirror_huge_pages))
+    {
+        if ((temp_fd = hugetlb_memfd(length)))
+        {
+            fd = temp_fd.get();
+            // Huge page mappings must be aligned to the huge page size. A
+            // hugetlb reservation is aligned by the kernel, and with
+            // MAP_NORESERVE does not consume any pages from the pool.
+            reserve_flags |= MAP_HUGETLB | MAP_NORESERVE;
+        }
+        else
+        {
+            // Transparent huge pages are requested via madvise once the
+            // mapping is created, pages must not be populated before then.
+            flags &= ~MAP_POPULATE;
+        }
+    }
 #endif
 
+    memory_mapping reserve(nullptr, length * 2, prot, reserve_flags);
+
     if (fd == -1)
     {
 #if defined(__linux__)
@@ -164,7 +242,7 @@ xtr::detail::mirrored_memory_mapping::mirrored_memory_mapping(
 
         reserve.release(); // mapping was destroyed by mremap
         mirror.release(); // mirror will be recreated in ~mirrored_memory_mapping
-        prefault_write(m_.get(), length * 2);
+        populate(mirror_flags);
         return;
 #else
         if (!(temp_fd = shm_open_anon(O_RDWR, S_IRUSR | S_IWUSR)))
@@ -204,7 +282,40 @@ xtr::detail::mirrored_memory_mapping::mirrored_memory_mapping(
 
     reserve.release(); // mapping was destroyed when m_ was created
     mirror.release();  // mirror will be recreated in ~mirrored_memory_mapping
+    populate(mirror_flags);
+}
+
+XTR_FUNC
+void xtr::detail::mirrored_memory_mapping::populate(int mirror_flags)
+{
+    const std::size_t length = m_.length();
+
+#if defined(__linux__)
+    // The policy must be set before pages are faulted in below. Explicit
+    // huge pages are allocated when the backing memfd is created (see
+    // hugetlb_memfd), i.e. on the calling thread's node.
+    set_numa_policy(m_.get(), length * 2, mirror_flags);
+#endif
+
+#if defined(MADV_HUGEPAGE)
+    // Failure is ignored as transparent huge pages are only a hint (and will
+    // fail for mappings that are already backed by explicit huge pages).
+    if (mirror_flags & mirror_huge_pages)
+        (void)::madvise(m_.get(), length * 2, MADV_HUGEPAGE);
+#endif
+
     prefault_write(m_.get(), length * 2);
+
+    if ((mirror_flags & mirror_lock_memory) && ::mlock(m_.get(), length * 2) == -1)
+    {
+        const int errnum = errno;
+        memory_mapping{}.reset(static_cast<std::byte*>(m_.get()) + length, length);
+        m_.reset();
+        throw_system_error(
+            errnum,
+            "xtr::detail::mirrored_memory_mapping::mirrored_memory_mapping: "
+            "mlock failed");
+    }
 }
 
 XTR_FUNC
@@ -21,6 +21,7 @@
 #include "xtr/io/posix_fd_storage.hpp"
 #include "xtr/detail/retry.hpp"
 #include "xtr/detail/throw.hpp"
+#include "xtr/detail/tsc.hpp"
 #include "xtr/io/detail/open.hpp"
 
 #include <cerrno>
@@ -43,6 +44,7 @@ xtr::posix_fd_storage::posix_fd_storage(
 XTR_FUNC
 std::span<char> xtr::posix_fd_storage::allocate_buffer()
 {
+    allocate_tsc_ = detail::tsc::now().ticks;
     return {buf_.get(), buffer_capacity_};
 }
 
@@ -73,6 +75,7 @@ void xtr::posix_fd_storage::submit_buffer(char* buf, std::size_t size)
             XTR_TEMP_FAILURE_RETRY(::write(fd_.get(), buf, size));
         if (nwritten == -1)
         {
+            ++error_count_;
             detail::throw_system_error_fmt(
                 errno,
                 "xtr::posix_fd_storage::submit_buffer: write failed");
@@ -81,4 +84,5 @@ void xtr::posix_fd_storage::submit_buffer(char* buf, std::size_t size)
         size -= std::size_t(nwritten);
         buf += std::size_t(nwritten);
     }
+    write_latency_.record(detail::tsc::now().ticks - allocate_tsc_);
 }
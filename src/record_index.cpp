@@ -0,0 +1,113 @@
+// Copyright 2026 Chris E. Holloway
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "xtr/detail/record_index.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+
+XTR_FUNC
+xtr::detail::record_index::record_index(std::size_t capacity) :
+    slot_mask_(capacity / slot_size - 1),
+    starts_(new std::uint64_t[capacity / slot_size / word_bits]()),
+    pinned_(new std::uint64_t[capacity / slot_size / word_bits]())
+{
+    assert(capacity / slot_size >= word_bits);
+    assert((slot_mask_ & (slot_mask_ + 1)) == 0);
+}
+
+// The functions below operate on the range of slots [first, last), which may
+// wrap around the end of the bitmap. Each iteration of their loops processes
+// the bits of the range that lie within a single word.
+
+XTR_FUNC
+void xtr::detail::record_index::clear(
+    std::uint64_t* bits, std::size_t first, std::size_t last) noexcept
+{
+    while (first < last)
+    {
+        const std::size_t i = first & slot_mask_;
+        const std::size_t b = i % word_bits;
+        const std::size_t n = std::min(word_bits - b, last - first);
+        const std::uint64_t mask = n == word_bits ? ~std::uint64_t(0)
+                                                  : ((std::uint64_t(1) << n) - 1) << b;
+        bits[i / word_bits] &= ~mask;
+        first += n;
+    }
+}
+
+XTR_FUNC
+std::size_t xtr::detail::record_index::find_first(
+    const std::uint64_t* bits, std::size_t first, std::size_t last) const noexcept
+{
+    while (first < last)
+    {
+        const std::size_t i = first & slot_mask_;
+        const std::size_t b = i % word_bits;
+        const std::size_t n = std::min(word_bits - b, last - first);
+        const std::uint64_t word = bits[i / word_bits] >> b;
+        const std::uint64_t masked =
+            n == word_bits ? word : word & ((std::uint64_t(1) << n) - 1);
+        if (masked != 0)
+            return first + std::size_t(std::countr_zero(masked));
+        first += n;
+    }
+    return last;
+}
+
+XTR_FUNC
+std::size_t xtr::detail::record_index::count(
+    const std::uint64_t* bits, std::size_t first, std::size_t last) const noexcept
+{
+    std::size_t result = 0;
+    while (first < last)
+    {
+        const std::size_t i = first & slot_mask_;
+        const std::size_t b = i % word_bits;
+        const std::size_t n = std::min(word_bits - b, last - first);
+        const std::uint64_t word = bits[i / word_bits] >> b;
+        const std::uint64_t masked =
+            n == word_bits ? word : word & ((std::uint64_t(1) << n) - 1);
+        result += std::size_t(std::popcount(masked));
+        first += n;
+    }
+    return result;
+}
+
+XTR_FUNC
+xtr::detail::record_index::discard_range xtr::detail::record_index::find_discard_range(
+    std::size_t head, std::size_t target, std::size_t limit) const noexcept
+{
+    assert(head <= target);
+    assert(target <= limit);
+
+    const std::size_t h = head / slot_size;
+    // Round up, target may lie within a slot
+    const std::size_t t = (target + slot_size - 1) / slot_size;
+    const std::size_t l = limit / slot_size;
+
+    // All records beginning before t must be discarded, unless one is pinned
+    std::size_t e = find_first(pinned_.get(), h, t);
+    if (e == t)
+        e = find_first(starts_.get(), t, l);
+
+    return {e * slot_size, count(starts_.get(), h, e)};
+}
@@ -0,0 +1,77 @@
+// Copyright 2026 Chris E. Holloway
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "xtr/detail/reorder_buffer.hpp"
+#include "xtr/detail/buffer.hpp"
+
+#include <algorithm>
+#include <utility>
+
+XTR_FUNC
+void xtr::detail::reorder_buffer::push(
+    std::int64_t key, std::string& line, buffer& out)
+{
+    if (heap_.size() == max_records) [[unlikely]]
+        pop(out);
+
+    std::size_t index;
+    if (free_.empty())
+    {
+        index = lines_.size();
+        lines_.emplace_back();
+    }
+    else
+    {
+        index = free_.back();
+        free_.pop_back();
+    }
+
+    // The swap leaves line holding a cleared string with spare capacity
+    std::swap(lines_[index], line);
+
+    heap_.push_back({key, seq_++, index});
+    std::push_heap(heap_.begin(), heap_.end(), later);
+}
+
+XTR_FUNC
+void xtr::detail::reorder_buffer::drain(buffer& out)
+{
+    const std::int64_t horizon = to_nanos(now) - window_;
+    while (!heap_.empty() && heap_.front().key <= horizon)
+        pop(out);
+}
+
+XTR_FUNC
+void xtr::detail::reorder_buffer::drain_all(buffer& out)
+{
+    while (!heap_.empty())
+        pop(out);
+}
+
+XTR_FUNC
+void xtr::detail::reorder_buffer::pop(buffer& out)
+{
+    std::pop_heap(heap_.begin(), heap_.end(), later);
+    const std::size_t index = heap_.back().index;
+    heap_.pop_back();
+    out.append(lines_[index]);
+    lines_[index].clear();
+    free_.push_back(index);
+}
@@ -0,0 +1,274 @@
+// Copyright 2026 Chris E. Holloway
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "xtr/detail/shared_stats.hpp"
+#include "xtr/detail/pause.hpp"
+#include "xtr/detail/strzcpy.hpp"
+#include "xtr/detail/throw.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace xtr::detail
+{
+    // Number of slots that the memfd is first sized for
+    inline constexpr std::size_t initial_stats_slots = 64;
+
+    XTR_FUNC
+    void begin_write(shared_stats_slot& s) noexcept
+    {
+        s.seq.store(s.seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    XTR_FUNC
+    void end_write(shared_stats_slot& s) noexcept
+    {
+        s.seq.store(s.seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    XTR_FUNC
+    void write_name(shared_stats_slot& s, std::string_view name) noexcept
+    {
+        char buf[sizeof(s.name)];
+        std::memset(buf, 0, sizeof(buf));
+        strzcpy(buf, name);
+        for (std::size_t i = 0; i != std::size(s.name); ++i)
+        {
+            std::uint64_t word;
+            std::memcpy(&word, buf + i * sizeof(word), sizeof(word));
+            s.name[i].store(word, std::memory_order_relaxed);
+        }
+    }
+
+    XTR_FUNC
+    bool read_sink_stats(
+        const shared_stats_slot& s, sink_stats& stats, char (&name)[128]) noexcept
+    {
+        static_assert(sizeof(name) == sizeof(s.name));
+
+        constexpr auto relaxed = std::memory_order_relaxed;
+
+        // The writer never blocks while holding the lock, so a reader should
+        // only need to retry a few times.
+        for (int attempt = 0; attempt != 1000; ++attempt)
+        {
+            const std::uint64_t seq = s.seq.load(std::memory_order_acquire);
+            if (seq % 2 != 0)
+            {
+                pause();
+                continue;
+            }
+
+            const bool in_use = s.in_use.load(relaxed) != 0;
+            stats.level = log_level_t(s.level.load(relaxed));
+            stats.buf_capacity = s.buf_capacity.load(relaxed);
+            stats.buf_nbytes = s.buf_nbytes.load(relaxed);
+            stats.dropped_count = s.dropped_count.load(relaxed);
+            stats.n_records = s.n_records.load(relaxed);
+            stats.n_bytes = s.n_bytes.load(relaxed);
+            for (std::size_t i = 0; i != std::size(s.name); ++i)
+            {
+                const std::uint64_t word = s.name[i].load(relaxed);
+                std::memcpy(name + i * sizeof(word), &word, sizeof(word));
+            }
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (s.seq.load(relaxed) == seq)
+            {
+                name[sizeof(name) - 1] = '\0';
+                return in_use;
+            }
+        }
+
+        return false;
+    }
+}
+
+XTR_FUNC
+xtr::detail::shared_stats::shared_stats() :
+    fd_(::memfd_create("xtr_stats", MFD_CLOEXEC))
+{
+    if (!fd_)
+    {
+        throw_system_error(
+            errno, "xtr::detail::shared_stats::shared_stats: memfd_create failed");
+    }
+
+    // The memfd is initially sized for the header only, see allocate
+    if (::ftruncate(fd_.get(), ::off_t(slots_offset)) == -1)
+    {
+        throw_system_error(
+            errno, "xtr::detail::shared_stats::shared_stats: ftruncate failed");
+    }
+
+    mapping_ = memory_mapping(
+        nullptr,
+        slots_offset + max_slots * sizeof(shared_stats_slot),
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED,
+        fd_.get());
+
+    static_assert(sizeof(shared_stats_header) <= slots_offset);
+
+    shared_stats_header& h = header();
+    h.magic = shared_stats_header::magic_value;
+    h.version = shared_stats_header::version_value;
+    h.slot_size = sizeof(shared_stats_slot);
+    h.n_slots.store(0, std::memory_order_release);
+}
+
+XTR_FUNC
+std::uint32_t xtr::detail::shared_stats::allocate(std::string_view name) noexcept
+{
+    std::uint32_t i;
+
+    {
+        std::scoped_lock lock{mutex_};
+
+        if (!free_slots_.empty())
+        {
+            i = free_slots_.back();
+            free_slots_.pop_back();
+        }
+        else
+        {
+            if (n_slots_ == max_slots)
+                return npos;
+
+            if (n_slots_ == n_backed_slots_)
+            {
+                const std::size_t n = std::min(
+                    std::max(2 * std::size_t(n_backed_slots_), initial_stats_slots),
+                    max_slots);
+                if (::ftruncate(
+                        fd_.get(),
+                        ::off_t(slots_offset + n * sizeof(shared_stats_slot))) == -1)
+                {
+                    return npos;
+                }
+                n_backed_slots_ = std::uint32_t(n);
+            }
+
+            i = n_slots_++;
+        }
+    }
+
+    shared_stats_slot& s = slot(i);
+    begin_write(s);
+    s.in_use.store(1, std::memory_order_relaxed);
+    write_name(s, name);
+    end_write(s);
+
+    // Readers may read any slot below n_slots, and new slots are zero
+    // filled, so publishing the slot only requires n_slots to be increased.
+    std::uint32_t n = header().n_slots.load(std::memory_order_relaxed);
+    while (n <= i &&
+           !header().n_slots.compare_exchange_weak(
+               n, i + 1, std::memory_order_release, std::memory_order_relaxed))
+    {
+    }
+
+    return i;
+}
+
+XTR_FUNC
+void xtr::detail::shared_stats::release(std::uint32_t i) noexcept
+{
+    shared_stats_slot& s = slot(i);
+    begin_write(s);
+    s.in_use.store(0, std::memory_order_relaxed);
+    end_write(s);
+
+    std::scoped_lock lock{mutex_};
+    free_slots_.push_back(i);
+}
+
+XTR_FUNC
+void xtr::detail::shared_stats::set_name(std::uint32_t i, std::string_view name) noexcept
+{
+    shared_stats_slot& s = slot(i);
+    begin_write(s);
+    write_name(s, name);
+    end_write(s);
+}
+
+XTR_FUNC
+void xtr::detail::shared_stats::publish(std::uint32_t i, const sink_stats& stats) noexcept
+{
+    constexpr auto relaxed = std::memory_order_relaxed;
+    shared_stats_slot& s = slot(i);
+    begin_write(s);
+    s.level.store(std::uint64_t(stats.level), relaxed);
+    s.buf_capacity.store(stats.buf_capacity, relaxed);
+    s.buf_nbytes.store(stats.buf_nbytes, relaxed);
+    s.dropped_count.store(stats.dropped_count, relaxed);
+    s.n_records.store(stats.n_records, relaxed);
+    s.n_bytes.store(stats.n_bytes, relaxed);
+    end_write(s);
+}
+
+XTR_FUNC
+xtr::detail::shared_stats_reader::shared_stats_reader(int fd)
+{
+    struct ::stat st;
+    if (::fstat(fd, &st) == -1)
+    {
+        throw_system_error(
+            errno,
+            "xtr::detail::shared_stats_reader::shared_stats_reader: fstat failed");
+    }
+
+    const auto size = std::size_t(st.st_size);
+    if (size < shared_stats::slots_offset)
+    {
+        throw_runtime_error(
+            "xtr::detail::shared_stats_reader::shared_stats_reader: "
+            "Statistics region is too small");
+    }
+
+    mapping_ = memory_mapping(nullptr, size, PROT_READ, MAP_SHARED, fd);
+
+    const auto& h = *static_cast<const shared_stats_header*>(mapping_.get());
+    if (h.magic != shared_stats_header::magic_value ||
+        h.version != shared_stats_header::version_value ||
+        h.slot_size != sizeof(shared_stats_slot))
+    {
+        throw_runtime_error(
+            "xtr::detail::shared_stats_reader::shared_stats_reader: "
+            "Unsupported statistics region format");
+    }
+
+    n_mapped_slots_ = (size - shared_stats::slots_offset) / sizeof(shared_stats_slot);
+}
+
+XTR_FUNC
+std::size_t xtr::detail::shared_stats_reader::size() const noexcept
+{
+    const auto& h = *static_cast<const shared_stats_header*>(mapping_.get());
+    return std::min(
+        std::size_t(h.n_slots.load(std::memory_order_acquire)), n_mapped_slots_);
+}
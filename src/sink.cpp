@@ -20,20 +20,50 @@
 
 #include "xtr/sink.hpp"
 #include "xtr/detail/consumer.hpp"
+#include "xtr/detail/throw.hpp"
 #include "xtr/logger.hpp"
+#include "xtr/mpsc_sink.hpp"
 
 #include <condition_variable>
+#include <cstring>
+#include <memory>
 #include <mutex>
 
 XTR_FUNC
-xtr::sink::sink(log_level_t level) :
-    level_(level)
+xtr::sink::sink(log_level_t level, std::size_t capacity, sink_flags_t flags) :
+    buf_(checked_capacity(capacity), -1, 0, detail::srb_flags, mirror_flags(flags)),
+    level_(level),
+    flags_(flags)
 {
+    buf_.set_writer_wait(writer_wait(flags));
+    if ((flags & sink_flags_t::overwrite_oldest) != sink_flags_t::none)
+    {
+        buf_.enable_overwrite(&dropped_count_);
+        overwrite_ = true;
+    }
+    if ((flags & sink_flags_t::measure_latency) != sink_flags_t::none)
+    {
+        latency_ = std::make_unique<detail::latency_histogram>();
+        prefix_size_ = enqueue_time_size;
+    }
 }
 
 XTR_FUNC
-xtr::sink::sink(const sink& other)
+xtr::sink::sink(const sink& other) :
+    buf_(other.capacity(), -1, 0, detail::srb_flags, mirror_flags(other.flags_)),
+    flags_(other.flags_)
 {
+    buf_.set_writer_wait(writer_wait(flags_));
+    if (other.overwrite_)
+    {
+        buf_.enable_overwrite(&dropped_count_);
+        overwrite_ = true;
+    }
+    if (other.latency_ != nullptr)
+    {
+        latency_ = std::make_unique<detail::latency_histogram>();
+        prefix_size_ = enqueue_time_size;
+    }
     *this = other;
 }
 
@@ -46,6 +76,8 @@ xtr::sink& xtr::sink::operator=(const sink& other)
     close();
 
     level_ = other.level_.load(std::memory_order_relaxed);
+    buf_.set_reader_park_word(other.buf_.reader_park_word());
+    buf_.set_reader_doorbell(other.buf_.reader_doorbell());
 
     if (other.open_)
     {
@@ -58,10 +90,16 @@ xtr::sink& xtr::sink::operator=(const sink& other)
 }
 
 XTR_FUNC
-xtr::sink::sink(logger& owner, std::string name, log_level_t level) :
-    level_(level)
+xtr::sink::sink(
+    logger& owner,
+    std::string name,
+    log_level_t level,
+    std::size_t capacity,
+    sink_flags_t flags,
+    std::size_t shard) :
+    sink(level, capacity, flags)
 {
-    owner.register_sink(*this, std::move(name));
+    owner.register_sink(*this, std::move(name), shard);
 }
 
 XTR_FUNC
@@ -69,7 +107,7 @@ void xtr::sink::close()
 {
     if (open_)
     {
-        sync_post([](detail::consumer& c) { c.destroy = true; });
+        sync_post([](detail::consumer& c) { c.close_current_sink(); });
         open_ = false;
         // clear() is called here in case the sink is registered with the
         // logger again, e.g. via assignment. This is because when the
@@ -79,6 +117,10 @@ void xtr::sink::close()
         // means that some residual data will be left in the buffer that needs
         // to be cleared.
         buf_.clear();
+        // Multi-producer sinks additionally rely on unwritten space being
+        // zero, see synchronized_ring_buffer::reserve.
+        if (multi_producer_)
+            std::memset(buf_.begin(), 0, buf_.capacity());
     }
 }
 
@@ -106,7 +148,7 @@ void xtr::sink::sync_post(Func func)
     std::mutex m;
     bool notified = false; // protected by m
 
-    post(
+    post_control(
         [&](detail::consumer& c, auto&)
         {
             func(c);
@@ -146,8 +188,43 @@ void xtr::sink::sync_post(Func func)
 XTR_FUNC
 void xtr::sink::set_name(std::string name)
 {
-    post([name = std::move(name)](auto&, auto& oldname) mutable
-         { oldname = std::move(name); });
+    post_control([name = std::move(name)](detail::consumer& c, auto& oldname) mutable
+                 { c.set_sink_name(oldname, std::move(name)); });
+}
+
+XTR_FUNC
+std::size_t xtr::sink::checked_capacity(std::size_t capacity)
+{
+    if (capacity > max_capacity) [[unlikely]]
+        detail::throw_invalid_argument("Sink capacity is too large");
+    return capacity;
+}
+
+XTR_FUNC
+int xtr::sink::mirror_flags(sink_flags_t flags) noexcept
+{
+    int result = 0;
+    if ((flags & sink_flags_t::huge_pages) != sink_flags_t::none)
+        result |= detail::mirror_huge_pages;
+    if ((flags & sink_flags_t::lock_memory) != sink_flags_t::none)
+        result |= detail::mirror_lock_memory;
+    if ((flags & sink_flags_t::numa_local) != sink_flags_t::none)
+        result |= detail::mirror_numa_local;
+    if (const int node = int(flags) >> detail::sink_numa_node_shift; node != 0)
+        result |= detail::mirror_numa_node(unsigned(node - 1));
+    return result;
+}
+
+XTR_FUNC
+xtr::detail::writer_wait xtr::sink::writer_wait(sink_flags_t flags) noexcept
+{
+    if ((flags & sink_flags_t::yield_when_full) != sink_flags_t::none)
+        return detail::writer_wait::yield;
+    if ((flags & sink_flags_t::sleep_when_full) != sink_flags_t::none)
+        return detail::writer_wait::sleep;
+    if ((flags & sink_flags_t::drop_when_full) != sink_flags_t::none)
+        return detail::writer_wait::drop;
+    return detail::writer_wait::spin;
 }
 
 XTR_FUNC
@@ -155,3 +232,25 @@ xtr::sink::~sink()
 {
     close();
 }
+
+XTR_FUNC
+xtr::mpsc_sink::mpsc_sink(log_level_t level, std::size_t capacity, sink_flags_t flags) :
+    sink(level, capacity, flags)
+{
+    if (overwrite_)
+        detail::throw_invalid_argument("Multi-producer sinks cannot overwrite");
+    multi_producer_ = true;
+}
+
+XTR_FUNC
+xtr::mpsc_sink::mpsc_sink(
+    logger& owner,
+    std::string name,
+    log_level_t level,
+    std::size_t capacity,
+    sink_flags_t flags,
+    std::size_t shard) :
+    mpsc_sink(level, capacity, flags)
+{
+    owner.register_sink(*this, std::move(name), shard);
+}
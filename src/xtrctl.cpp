@@ -20,22 +20,31 @@
 
 #include "xtr/detail/commands/connect.hpp"
 #include "xtr/detail/commands/ios.hpp"
+#include "xtr/detail/commands/matcher.hpp"
 #include "xtr/detail/commands/pattern.hpp"
 #include "xtr/detail/commands/recv.hpp"
 #include "xtr/detail/commands/requests.hpp"
 #include "xtr/detail/commands/responses.hpp"
 #include "xtr/detail/commands/send.hpp"
 #include "xtr/detail/file_descriptor.hpp"
+#include "xtr/detail/shared_stats.hpp"
 #include "xtr/detail/strzcpy.hpp"
 
+#include <algorithm>
+#include <chrono>
 #include <cstdlib>
 #include <cstring>
+#include <exception>
+#include <iomanip>
 #include <iostream>
 #include <map>
+#include <string>
 #include <string_view>
+#include <thread>
 #include <vector>
 
 #include <getopt.h>
+#include <unistd.h>
 
 namespace xtrd = xtr::detail;
 
@@ -52,18 +61,39 @@ namespace
             "Available commands are:\n"
             "\n"
             "  status [pattern]             Displays sink statuses\n"
+            "  latency [pattern]            Displays queue and write latencies\n"
+            "  metrics                      Displays all counters in Prometheus text\n"
+            "                               format\n"
+            "  stats [pattern]              Displays sink statuses read from shared\n"
+            "                               memory, without waiting for the logger\n"
+            "  top [pattern]                Repeatedly displays sink throughput, busiest\n"
+            "                               sinks first\n"
             "  level <level> [pattern]      Sets sink log levels. Valid levels are;\n"
             "                               fatal, error, warning, info, debug\n"
             "  reopen                       Reopens the log file\n"
+            "  site list [pattern]          Displays log statements\n"
+            "  site <state> [pattern]       Sets log statement states. Valid states are;\n"
+            "                               enable (log regardless of sink level),\n"
+            "                               disable (never log), reset (log according\n"
+            "                               to sink level)\n"
             "\n"
-            "The pattern accepted by the status and level commands is by default a\n"
-            "regular expression. This can be modified by passing the following flags:\n"
+            "The pattern accepted by the status, latency, stats, top, level and site\n"
+            "commands is by default a regular expression. This can be modified by\n"
+            "passing the following flags:\n"
             "\n"
             "  -E, --extended-regexp        Pattern is an extended regular expression\n"
             "  -G, --basic-regex            Pattern is a regular expression (the default)\n"
             "  -W, --wildcard               Pattern is a wildcard pattern\n"
             "\n"
-            "If no pattern is specified then the command applies to all sinks.\n";
+            "The top command additionally accepts the following flags:\n"
+            "\n"
+            "  -d, --delay <seconds>        Time between updates (default 1 second)\n"
+            "  -n, --iterations <count>     Number of updates before exiting (default\n"
+            "                               is to run until interrupted)\n"
+            "\n"
+            "If no pattern is specified then the command applies to all sinks. Site\n"
+            "patterns are matched against the file name and line number of each log\n"
+            "statement, for example \"main.cpp:42\".\n";
         // clang-format on
 
         std::exit(status);
@@ -98,6 +128,241 @@ namespace
             errx("Invalid frame length");
         return &static_cast<xtrd::frame<Payload>*>(buf)->payload;
     }
+
+    std::vector<xtrd::sink_info> query_status(
+        const char* path, const xtrd::frame<xtrd::status>& st)
+    {
+        const xtrd::file_descriptor fd = xtrd::command_connect(path);
+
+        if (!fd)
+            err("Failed to connect");
+
+        send(fd.get(), st);
+
+        std::vector<xtrd::sink_info> infos;
+        xtrd::frame_buf buf;
+
+        while (const ::ssize_t nbytes = xtrd::command_recv(fd.get(), buf))
+        {
+            if (nbytes == -1)
+                err("Error reading from socket");
+
+            if (nbytes < ::ssize_t(sizeof(xtrd::frame_header)))
+                errx("Incomplete frame header");
+
+            switch (buf.hdr.frame_id)
+            {
+            case xtrd::sink_info::frame_id:
+                infos.push_back(
+                    *frame_cast<xtrd::sink_info>(&buf, std::size_t(nbytes)));
+                break;
+            case xtrd::error::frame_id:
+                errx(
+                    "Error: ",
+                    frame_cast<xtrd::error>(&buf, std::size_t(nbytes))->reason);
+            default:
+                errx("Invalid frame id");
+            }
+        }
+
+        return infos;
+    }
+
+    // Reads sink statuses directly from the logger's shared statistics region
+    // (see xtr::option_flags_t::shared_stats), which is passed over the socket
+    // as a file descriptor. Only the request for the region is processed by
+    // the logger's background thread.
+    std::vector<xtrd::sink_info> query_stats(
+        const char* path, xtrd::pattern_type_t pattern_type, const char* pattern)
+    {
+        const auto matcher = xtrd::make_matcher(pattern_type, pattern, false);
+
+        if (!matcher->valid())
+        {
+            char reason[256];
+            matcher->error_reason(reason, sizeof(reason));
+            errx("Error: ", reason);
+        }
+
+        const xtrd::file_descriptor fd = xtrd::command_connect(path);
+
+        if (!fd)
+            err("Failed to connect");
+
+        send(fd.get(), xtrd::frame<xtrd::stats_region>());
+
+        xtrd::frame_buf buf;
+        xtrd::file_descriptor region_fd;
+
+        const ::ssize_t nbytes = xtrd::command_recv(fd.get(), buf, &region_fd);
+
+        if (nbytes == -1)
+            err("Error reading from socket");
+
+        if (nbytes < ::ssize_t(sizeof(xtrd::frame_header)))
+            errx("Incomplete frame header");
+
+        switch (buf.hdr.frame_id)
+        {
+        case xtrd::stats_region_info::frame_id:
+            frame_cast<xtrd::stats_region_info>(&buf, std::size_t(nbytes));
+            break;
+        case xtrd::error::frame_id:
+            errx("Error: ", frame_cast<xtrd::error>(&buf, std::size_t(nbytes))->reason);
+        default:
+            errx("Invalid frame id");
+        }
+
+        if (!region_fd)
+            errx("No statistics region received");
+
+        std::vector<xtrd::sink_info> infos;
+
+        try
+        {
+            const xtrd::shared_stats_reader reader(region_fd.get());
+
+            for (std::size_t i = 0; i != reader.size(); ++i)
+            {
+                xtrd::sink_stats stats;
+                xtrd::sink_info info;
+                if (!xtrd::read_sink_stats(reader[i], stats, info.name) ||
+                    !(*matcher)(info.name))
+                {
+                    continue;
+                }
+                info.level = stats.level;
+                info.buf_capacity = stats.buf_capacity;
+                info.buf_nbytes = stats.buf_nbytes;
+                info.dropped_count = stats.dropped_count;
+                info.n_records = stats.n_records;
+                info.n_bytes = stats.n_bytes;
+                infos.push_back(info);
+            }
+        }
+        catch (const std::exception& e)
+        {
+            errx("Error: ", e.what());
+        }
+
+        return infos;
+    }
+
+    // Sink names need not be unique, so sinks with the same name are
+    // displayed by the top command as one.
+    struct sink_totals
+    {
+        std::size_t buf_capacity = 0;
+        std::size_t buf_nbytes = 0;
+        std::size_t dropped_count = 0;
+        std::size_t n_records = 0;
+        std::size_t n_bytes = 0;
+    };
+
+    std::map<std::string, sink_totals> sum_by_name(
+        const std::vector<xtrd::sink_info>& infos)
+    {
+        std::map<std::string, sink_totals> result;
+        for (const auto& info : infos)
+        {
+            sink_totals& t = result[info.name];
+            t.buf_capacity += info.buf_capacity;
+            t.buf_nbytes += info.buf_nbytes;
+            t.dropped_count += info.dropped_count;
+            t.n_records += info.n_records;
+            t.n_bytes += info.n_bytes;
+        }
+        return result;
+    }
+
+    void run_top(
+        const char* path,
+        const xtrd::frame<xtrd::status>& st,
+        std::chrono::duration<double> delay,
+        long iterations)
+    {
+        struct row
+        {
+            std::string_view name;
+            double records_per_sec;
+            double bytes_per_sec;
+            double fill_percent;
+            double drops_per_sec;
+        };
+
+        // Counters are reset if a sink is closed and another is opened with
+        // the same name, so are not assumed to increase.
+        const auto rate = [](std::size_t now, std::size_t prev, double secs)
+        { return now > prev ? double(now - prev) / secs : 0.0; };
+
+        const bool clear = ::isatty(STDOUT_FILENO) == 1;
+
+        auto prev = sum_by_name(query_status(path, st));
+        auto prev_time = std::chrono::steady_clock::now();
+        std::vector<row> rows;
+
+        for (long i = 0; iterations == 0 || i != iterations; ++i)
+        {
+            std::this_thread::sleep_for(delay);
+
+            auto cur = sum_by_name(query_status(path, st));
+            const auto now = std::chrono::steady_clock::now();
+            const double secs =
+                std::chrono::duration<double>(now - prev_time).count();
+
+            rows.clear();
+            for (const auto& [name, t] : cur)
+            {
+                const auto it = prev.find(name);
+                const sink_totals p = it != prev.end() ? it->second : sink_totals{};
+                rows.push_back(
+                    {.name = name,
+                     .records_per_sec = rate(t.n_records, p.n_records, secs),
+                     .bytes_per_sec = rate(t.n_bytes, p.n_bytes, secs),
+                     .fill_percent = t.buf_capacity != 0
+                                         ? 100.0 * double(t.buf_nbytes) /
+                                               double(t.buf_capacity)
+                                         : 0.0,
+                     .drops_per_sec = rate(t.dropped_count, p.dropped_count, secs)});
+            }
+
+            std::stable_sort(
+                rows.begin(),
+                rows.end(),
+                [](const row& a, const row& b)
+                {
+                    return a.bytes_per_sec > b.bytes_per_sec ||
+                        (a.bytes_per_sec == b.bytes_per_sec &&
+                         a.records_per_sec > b.records_per_sec);
+                });
+
+            // Move the cursor to the top left and clear the screen
+            if (clear)
+                std::cout << "\x1b[H\x1b[2J";
+
+            std::cout << std::left << std::setw(32) << "Sink" << std::right
+                      << std::setw(14) << "Records/s" << std::setw(14)
+                      << "Bytes/s" << std::setw(8) << "Fill" << std::setw(12)
+                      << "Drops/s" << "\n"
+                      << std::fixed;
+
+            for (const auto& r : rows)
+            {
+                std::cout << std::left << std::setw(32) << r.name << std::right
+                          << std::setprecision(0) << std::setw(14)
+                          << r.records_per_sec << std::setw(14)
+                          << r.bytes_per_sec << std::setprecision(1)
+                          << std::setw(7) << r.fill_percent << "%"
+                          << std::setprecision(0) << std::setw(12)
+                          << r.drops_per_sec << "\n";
+            }
+
+            std::cout << std::flush;
+
+            prev = std::move(cur);
+            prev_time = now;
+        }
+    }
 }
 
 int main(int argc, char* argv[])
@@ -106,6 +371,8 @@ int main(int argc, char* argv[])
         {"extended-regexp", no_argument, nullptr, 'E'},
         {"basic-regexp", no_argument, nullptr, 'G'},
         {"wildcard", no_argument, nullptr, 'W'},
+        {"delay", required_argument, nullptr, 'd'},
+        {"iterations", required_argument, nullptr, 'n'},
         {"help", no_argument, nullptr, 'h'},
         {nullptr, 0, nullptr, 0}};
 
@@ -113,7 +380,21 @@ int main(int argc, char* argv[])
     xtr::log_level_t log_level = xtr::log_level_t::none;
     xtrd::pattern_type_t pattern_type = xtrd::pattern_type_t::none;
     bool status = false;
+    bool latency = false;
+    bool metrics = false;
+    bool stats = false;
+    bool top = false;
+    double delay = 1.0;
+    long iterations = 0;
     bool reopen = false;
+    bool site_list = false;
+    bool set_site_state = false;
+    xtrd::site_state_t site_state = xtrd::site_state_t::normal;
+
+    std::map<std::string, xtrd::site_state_t> site_states_map{
+        {"enable", xtrd::site_state_t::enabled},
+        {"disable", xtrd::site_state_t::disabled},
+        {"reset", xtrd::site_state_t::normal}};
 
     std::map<std::string, xtr::log_level_t> levels_map{
         {"fatal", xtr::log_level_t::fatal},
@@ -133,6 +414,22 @@ int main(int argc, char* argv[])
     {
         status = true;
     }
+    else if (argv[1] == "latency"sv)
+    {
+        latency = true;
+    }
+    else if (argv[1] == "metrics"sv)
+    {
+        metrics = true;
+    }
+    else if (argv[1] == "stats"sv)
+    {
+        stats = true;
+    }
+    else if (argv[1] == "top"sv)
+    {
+        top = true;
+    }
     else if (argv[1] == "reopen"sv)
     {
         reopen = true;
@@ -146,6 +443,25 @@ int main(int argc, char* argv[])
         log_level = levels_map[argv[2]];
         ++optind;
     }
+    else if (argv[1] == "site"sv)
+    {
+        if (argc < 3)
+            usage(argv[0], EXIT_FAILURE, "Please specify a site command");
+        if (argv[2] == "list"sv)
+        {
+            site_list = true;
+        }
+        else if (site_states_map.count(argv[2]) != 0)
+        {
+            set_site_state = true;
+            site_state = site_states_map[argv[2]];
+        }
+        else
+        {
+            usage(argv[0], EXIT_FAILURE, "Invalid site command");
+        }
+        ++optind;
+    }
     else if (argv[1] == "--help"sv)
     {
         usage(argv[0], EXIT_SUCCESS);
@@ -155,7 +471,8 @@ int main(int argc, char* argv[])
         usage(argv[0], EXIT_FAILURE, "Invalid command");
     }
 
-    while ((optc = getopt_long(argc, argv, "EGWh", long_options, nullptr)) != -1)
+    while ((optc = getopt_long(argc, argv, "EGWd:n:h", long_options, nullptr)) !=
+           -1)
     {
         switch (optc)
         {
@@ -168,6 +485,26 @@ int main(int argc, char* argv[])
         case 'W':
             pattern_type = xtrd::pattern_type_t::wildcard;
             break;
+        case 'd':
+        {
+            char* end;
+            delay = std::strtod(optarg, &end);
+            if (!top)
+                usage(argv[0], EXIT_FAILURE, "Delay is only valid for top");
+            if (*end != '\0' || !(delay > 0))
+                usage(argv[0], EXIT_FAILURE, "Invalid delay");
+            break;
+        }
+        case 'n':
+        {
+            char* end;
+            iterations = std::strtol(optarg, &end, 10);
+            if (!top)
+                usage(argv[0], EXIT_FAILURE, "Iterations is only valid for top");
+            if (*end != '\0' || iterations <= 0)
+                usage(argv[0], EXIT_FAILURE, "Invalid number of iterations");
+            break;
+        }
         case 'h':
             usage(argv[0], EXIT_SUCCESS);
         case '?':
@@ -175,7 +512,7 @@ int main(int argc, char* argv[])
         }
     }
 
-    if (argc > optind + 2 - int(reopen))
+    if (argc > optind + 2 - int(reopen || metrics))
         usage(argv[0], EXIT_FAILURE, "Too many arguments");
 
     if (argc < optind + 1)
@@ -203,6 +540,31 @@ int main(int argc, char* argv[])
     if (pattern != nullptr && pattern_type == xtrd::pattern_type_t::none)
         pattern_type = xtrd::pattern_type_t::basic_regex;
 
+    if (top)
+    {
+        xtrd::frame<xtrd::status> st;
+        if (pattern != nullptr)
+        {
+            st->pattern.type = pattern_type;
+            xtrd::strzcpy(st->pattern.text, std::string_view{pattern});
+        }
+        run_top(path, st, std::chrono::duration<double>(delay), iterations);
+        return EXIT_SUCCESS;
+    }
+
+    if (stats)
+    {
+        auto infos = query_stats(path, pattern_type, pattern);
+        std::sort(
+            infos.begin(),
+            infos.end(),
+            [](const auto& a, const auto& b)
+            { return std::strcmp(a.name, b.name) < 0; });
+        for (const auto& info : infos)
+            std::cout << info << "\n";
+        return EXIT_SUCCESS;
+    }
+
     const xtrd::file_descriptor fd = xtrd::command_connect(path);
 
     if (!fd)
@@ -220,6 +582,21 @@ int main(int argc, char* argv[])
         if (nwritten != sizeof(st))
             err("Error writing to socket");
     }
+    else if (latency)
+    {
+        xtrd::frame<xtrd::latency> lt;
+        if (pattern != nullptr)
+        {
+            lt->pattern.type = pattern_type;
+            xtrd::strzcpy(lt->pattern.text, std::string_view{pattern});
+        }
+        send(fd.get(), lt);
+    }
+    else if (metrics)
+    {
+        xtrd::frame<xtrd::metrics> mt;
+        send(fd.get(), mt);
+    }
     else if (log_level != xtr::log_level_t::none)
     {
         xtrd::frame<xtrd::set_level> sl;
@@ -236,8 +613,32 @@ int main(int argc, char* argv[])
         xtrd::frame<xtrd::reopen> rot;
         send(fd.get(), rot);
     }
+    else if (site_list)
+    {
+        xtrd::frame<xtrd::site_status> ss;
+        if (pattern != nullptr)
+        {
+            ss->pattern.type = pattern_type;
+            xtrd::strzcpy(ss->pattern.text, std::string_view{pattern});
+        }
+        send(fd.get(), ss);
+    }
+    else if (set_site_state)
+    {
+        xtrd::frame<xtrd::set_site_state> ss;
+        ss->state = site_state;
+        if (pattern != nullptr)
+        {
+            ss->pattern.type = pattern_type;
+            xtrd::strzcpy(ss->pattern.text, std::string_view{pattern});
+        }
+        send(fd.get(), ss);
+    }
 
     std::vector<xtrd::sink_info> infos;
+    std::vector<xtrd::site_info> sites;
+    std::vector<xtrd::latency_info> latencies;
+    std::string metrics_text;
     xtrd::frame_buf buf;
 
     while (const ::ssize_t nbytes = xtrd::command_recv(fd.get(), buf))
@@ -254,6 +655,22 @@ int main(int argc, char* argv[])
             infos.push_back(
                 *frame_cast<xtrd::sink_info>(&buf, std::size_t(nbytes)));
             break;
+        case xtrd::site_info::frame_id:
+            sites.push_back(
+                *frame_cast<xtrd::site_info>(&buf, std::size_t(nbytes)));
+            break;
+        case xtrd::latency_info::frame_id:
+            latencies.push_back(
+                *frame_cast<xtrd::latency_info>(&buf, std::size_t(nbytes)));
+            break;
+        case xtrd::metrics_text::frame_id:
+        {
+            const auto* mt =
+                frame_cast<xtrd::metrics_text>(&buf, std::size_t(nbytes));
+            metrics_text.append(
+                mt->text, std::min<std::size_t>(mt->size, sizeof(mt->text)));
+            break;
+        }
         case xtrd::success::frame_id:
             std::cout << "Success\n";
             break;
@@ -273,5 +690,32 @@ int main(int argc, char* argv[])
     for (const auto& info : infos)
         std::cout << info << "\n";
 
+    std::sort(
+        sites.begin(),
+        sites.end(),
+        [](const auto& a, const auto& b)
+        {
+            const int cmp = std::strcmp(a.file, b.file);
+            return cmp < 0 || (cmp == 0 && a.line < b.line);
+        });
+
+    for (const auto& site : sites)
+        std::cout << site << "\n";
+
+    // Sink latencies sorted by name, followed by write latencies
+    std::stable_sort(
+        latencies.begin(),
+        latencies.end(),
+        [](const auto& a, const auto& b)
+        {
+            return a.kind < b.kind ||
+                (a.kind == b.kind && std::strcmp(a.name, b.name) < 0);
+        });
+
+    for (const auto& li : latencies)
+        std::cout << li << "\n";
+
+    std::cout << metrics_text;
+
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,118 @@
+// Copyright 2026 Chris E. Holloway
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "xtr/detail/binary_decoder.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include <getopt.h>
+
+namespace xtrb = xtr::detail::binary;
+
+namespace
+{
+    [[noreturn]] void usage(const char* progname, int status, const char* reason = nullptr)
+    {
+        if (reason != nullptr)
+            std::cout << reason << "\n\n";
+
+        // clang-format off
+        (status != 0 ? std::cerr : std::cout)
+            << "Usage: " << progname << " [--help] [file...]\n"
+            "Converts binary logs written by the xtr logger to text. Decoded log\n"
+            "lines are written to standard output. If no files are specified then\n"
+            "standard input is read.\n";
+        // clang-format on
+
+        std::exit(status);
+    }
+
+    template<typename... Args>
+    [[noreturn]] void errx(Args&&... args)
+    {
+        (std::cerr << ... << args) << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    template<typename... Args>
+    [[noreturn]] void err(Args&&... args)
+    {
+        const int errnum = errno;
+        errx(std::forward<Args>(args)..., ": ", std::strerror(errnum));
+    }
+
+    void decode(std::FILE* fp, const char* path)
+    {
+        const std::string error = xtrb::decode(
+            fp,
+            [](std::string_view text)
+            {
+                if (std::fwrite(text.data(), 1, text.size(), stdout) != text.size())
+                    err("Error writing output");
+            });
+        if (!error.empty())
+            errx(path, ": ", error);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const struct option long_options[] = {
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0}};
+
+    int optc;
+
+    while ((optc = getopt_long(argc, argv, "h", long_options, nullptr)) != -1)
+    {
+        switch (optc)
+        {
+        case 'h':
+            usage(argv[0], EXIT_SUCCESS);
+        case '?':
+            usage(argv[0], EXIT_FAILURE);
+        }
+    }
+
+    if (optind == argc)
+    {
+        decode(stdin, "<stdin>");
+    }
+
+    for (int i = optind; i < argc; ++i)
+    {
+        std::FILE* fp = std::fopen(argv[i], "rb");
+        if (fp == nullptr)
+            err("Failed to open ", argv[i]);
+        decode(fp, argv[i]);
+        std::fclose(fp);
+    }
+
+    if (std::fflush(stdout) != 0)
+        err("Error writing output");
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,122 @@
+// Copyright 2026 Chris E. Holloway
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "xtr/detail/binary_decoder.hpp"
+#include "xtr/detail/binary_format.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+#include <string>
+#include <string_view>
+
+namespace xtrb = xtr::detail::binary;
+
+namespace
+{
+    std::string header()
+    {
+        std::string log;
+        xtrb::put(log, xtrb::record_type::header);
+        log.append(std::begin(xtrb::magic), std::end(xtrb::magic));
+        xtrb::put(log, xtrb::version);
+        return log;
+    }
+
+    std::string decode(std::string log, std::string* text = nullptr)
+    {
+        std::FILE* fp = ::fmemopen(log.data(), log.size(), "rb");
+        REQUIRE(fp != nullptr);
+        std::string error = xtrb::decode(
+            fp,
+            [&](std::string_view str)
+            {
+                if (text != nullptr)
+                    *text += str;
+            });
+        std::fclose(fp);
+        return error;
+    }
+}
+
+TEST_CASE("binary_decoder text test", "[binary_decoder]")
+{
+    std::string log = header();
+    xtrb::put(log, xtrb::record_type::text);
+    xtrb::put_string(log, "Line 1\n");
+    xtrb::put(log, xtrb::record_type::text);
+    xtrb::put_string(log, "Line 2\n");
+
+    std::string text;
+    REQUIRE(decode(log, &text) == "");
+    REQUIRE(text == "Line 1\nLine 2\n");
+}
+
+TEST_CASE("binary_decoder invalid header test", "[binary_decoder]")
+{
+    REQUIRE(decode("text") == "Not a binary xtr log");
+    REQUIRE(decode("\x7FXTZ\x01") == "Invalid header");
+    REQUIRE(decode("\x7FXTR\x7F") == "Unsupported version 127");
+}
+
+TEST_CASE("binary_decoder truncated record test", "[binary_decoder]")
+{
+    std::string log = header();
+    xtrb::put(log, xtrb::record_type::text);
+    xtrb::put_string(log, "Line\n");
+    log.pop_back();
+    REQUIRE(decode(log) == "Truncated record");
+}
+
+TEST_CASE("binary_decoder corrupt length test", "[binary_decoder]")
+{
+    // The length is far larger than the log, which must be found to be
+    // truncated without first allocating a string of that length
+    std::string log = header();
+    xtrb::put(log, xtrb::record_type::text);
+    xtrb::put(log, std::uint32_t(0xFFFFFFFF));
+    log += "Line\n";
+    REQUIRE(decode(log) == "Truncated record");
+}
+
+TEST_CASE("binary_decoder corrupt id test", "[binary_decoder]")
+{
+    std::string log = header();
+    xtrb::put(log, xtrb::record_type::site);
+    xtrb::put(log, std::uint32_t(0xFFFFFFFF));
+    xtrb::put_string(log, "{}");
+    REQUIRE(decode(log) == "Invalid site 4294967295");
+
+    log = header();
+    xtrb::put(log, xtrb::record_type::name);
+    xtrb::put(log, std::uint32_t(0x10000000));
+    xtrb::put_string(log, "Name");
+    REQUIRE(decode(log) == "Invalid name 268435456");
+}
+
+TEST_CASE("binary_decoder undefined site test", "[binary_decoder]")
+{
+    std::string log = header();
+    xtrb::put(log, xtrb::record_type::event);
+    xtrb::put(log, std::uint32_t(3));
+    REQUIRE(decode(log) == "Undefined site 3");
+}
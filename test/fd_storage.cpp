@@ -38,9 +38,11 @@
 #include <functional>
 #include <iostream>
 #include <stdexcept>
+#include <system_error>
 #include <vector>
 
 #include <dlfcn.h>
+#include <fcntl.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
@@ -228,6 +230,7 @@ TEST_CASE_METHOD(fixture, "write test", "[fd_storage]")
 
     REQUIRE(cqe_count == n);
     REQUIRE(verify_file_contents(n));
+    REQUIRE(storage_->write_latency()->count() == n);
 }
 
 TEST_CASE_METHOD(fixture, "write more than queue size test", "[fd_storage]")
@@ -510,6 +513,8 @@ TEST_CASE_METHOD(fixture, "write error test", "[fd_storage]")
 
     send_buffer();
     sync();
+
+    REQUIRE(storage_->error_count() == 1);
 }
 
 TEST_CASE_METHOD(fixture, "reopen with unsent buffers", "[fd_storage]")
@@ -633,4 +638,21 @@ TEST_CASE("posix_fd_storage truncate test", "[fd_storage]")
     struct stat st{};
     REQUIRE(::stat(tmp.path_.c_str(), &st) == 0);
     REQUIRE(st.st_size == 1);
+
+    REQUIRE(storage.write_latency()->count() == 2);
 }
+
+#if __cpp_exceptions
+TEST_CASE("posix_fd_storage write error test", "[fd_storage]")
+{
+    xtr::detail::file_descriptor fd(::open("/dev/null", O_RDONLY));
+    REQUIRE(fd);
+
+    xtr::posix_fd_storage storage(fd.get());
+
+    char c = 'x';
+    REQUIRE_THROWS_AS(storage.submit_buffer(&c, 1), std::system_error);
+    REQUIRE(storage.error_count() == 1);
+    REQUIRE(storage.write_latency()->count() == 0);
+}
+#endif
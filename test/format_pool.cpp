@@ -0,0 +1,83 @@
+// Copyright 2026 Chris E. Holloway
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "xtr/detail/format_pool.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace xtrd = xtr::detail;
+
+TEST_CASE("format_pool run test", "[format_pool]")
+{
+    xtrd::format_pool pool(3);
+    REQUIRE(pool.size() == 3);
+
+    for (std::size_t n = 0; n != 64; ++n)
+    {
+        std::vector<std::atomic<int>> calls(n);
+        pool.run(n, [&](std::size_t i) { ++calls[i]; });
+        // Every index is invoked exactly once before run returns
+        for (const auto& c : calls)
+            REQUIRE(c == 1);
+    }
+}
+
+TEST_CASE("format_pool threads test", "[format_pool]")
+{
+    xtrd::format_pool pool(3);
+
+    // Indices are spread over the pool's threads as well as the calling
+    // thread, each index blocks until all four threads have been handed one
+    std::atomic<std::size_t> n_started{0};
+    std::vector<std::thread::id> ids(4);
+    pool.run(
+        ids.size(),
+        [&](std::size_t i)
+        {
+            ids[i] = std::this_thread::get_id();
+            ++n_started;
+            while (n_started != ids.size())
+                std::this_thread::yield();
+        });
+
+    for (std::size_t i = 0; i != ids.size(); ++i)
+    {
+        for (std::size_t j = i + 1; j != ids.size(); ++j)
+            REQUIRE(ids[i] != ids[j]);
+    }
+}
+
+TEST_CASE("format_pool many rounds test", "[format_pool]")
+{
+    // Threads that wake after their round has ended must not run indices of
+    // the next round
+    xtrd::format_pool pool(4);
+    for (std::size_t round = 0; round != 10000; ++round)
+    {
+        std::atomic<std::size_t> sum{0};
+        pool.run(2, [&](std::size_t i) { sum += i + 1; });
+        REQUIRE(sum == 3);
+    }
+}
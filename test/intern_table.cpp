@@ -0,0 +1,99 @@
+// Copyright 2026 Chris E. Holloway
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "xtr/detail/intern_table.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace xtrd = xtr::detail;
+
+TEST_CASE("intern_table intern test", "[intern_table]")
+{
+    auto table = std::make_unique<xtrd::intern_table>();
+
+    const std::string foo = "foo";
+    const auto foo_id = table->intern(foo);
+    const auto bar_id = table->intern("bar");
+
+    REQUIRE(foo_id != bar_id);
+    REQUIRE(table->intern("foo") == foo_id);
+    REQUIRE(table->intern(std::string_view{"barbaz", 3}) == bar_id);
+    REQUIRE(table->intern("") != foo_id);
+    REQUIRE(table->size() == 3);
+
+    REQUIRE(table->lookup(foo_id) == "foo");
+    REQUIRE(table->lookup(bar_id) == "bar");
+}
+
+TEST_CASE("intern_table full test", "[intern_table]")
+{
+    auto table = std::make_unique<xtrd::intern_table>();
+
+    for (std::uint32_t i = 0; i != xtrd::intern_table::capacity; ++i)
+        REQUIRE(table->intern(std::to_string(i)) == i);
+
+    REQUIRE(table->intern("full") == xtrd::intern_table::npos);
+    REQUIRE(table->size() == xtrd::intern_table::capacity);
+
+    // Existing strings can still be found
+    REQUIRE(table->intern("42") == 42);
+    REQUIRE(table->lookup(42) == "42");
+}
+
+TEST_CASE("intern_table concurrent intern test", "[intern_table]")
+{
+    auto table = std::make_unique<xtrd::intern_table>();
+
+    constexpr std::size_t n_threads = 4;
+    constexpr std::size_t n_strings = 1000;
+
+    std::vector<std::vector<std::uint32_t>> ids(
+        n_threads, std::vector<std::uint32_t>(n_strings));
+    std::vector<std::thread> threads;
+
+    for (std::size_t t = 0; t != n_threads; ++t)
+    {
+        threads.emplace_back(
+            [&, t]
+            {
+                for (std::size_t i = 0; i != n_strings; ++i)
+                    ids[t][i] = table->intern(std::to_string(i));
+            });
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    // Threads racing to add the same string must not use up extra ids
+    REQUIRE(table->size() == n_strings);
+
+    for (std::size_t i = 0; i != n_strings; ++i)
+    {
+        for (std::size_t t = 1; t != n_threads; ++t)
+            REQUIRE(ids[t][i] == ids[0][i]);
+        REQUIRE(table->lookup(ids[0][i]) == std::to_string(i));
+    }
+}
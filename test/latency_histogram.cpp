@@ -0,0 +1,79 @@
+// Copyright 2026 Chris E. Holloway
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "xtr/detail/latency_histogram.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+#include <memory>
+
+namespace xtrd = xtr::detail;
+
+TEST_CASE("latency_histogram bucket test", "[latency_histogram]")
+{
+    using h = xtrd::latency_histogram;
+
+    // Small values are counted exactly
+    for (std::uint64_t v = 0; v != 2 * h::sub_bucket_count; ++v)
+    {
+        REQUIRE(h::bucket_index(v) == v);
+        REQUIRE(h::bucket_max(v) == v);
+    }
+
+    // Buckets are contiguous and each value falls within its bucket with a
+    // relative error of at most 1 / sub_bucket_count.
+    std::uint64_t prev_max = 2 * h::sub_bucket_count - 1;
+    for (std::size_t i = 2 * h::sub_bucket_count; i != h::bucket_count; ++i)
+    {
+        const std::uint64_t min = prev_max + 1;
+        const std::uint64_t max = h::bucket_max(i);
+        REQUIRE(h::bucket_index(min) == i);
+        REQUIRE(h::bucket_index(max) == i);
+        REQUIRE((max - min) * h::sub_bucket_count <= min);
+        prev_max = max;
+    }
+
+    REQUIRE(prev_max == (std::uint64_t(1) << h::max_value_bits) - 1);
+    REQUIRE(h::bucket_index(std::uint64_t(-1)) == h::bucket_count - 1);
+}
+
+TEST_CASE("latency_histogram percentile test", "[latency_histogram]")
+{
+    auto h = std::make_unique<xtrd::latency_histogram>();
+
+    REQUIRE(h->count() == 0);
+    REQUIRE(h->percentile(0.5) == 0);
+
+    for (std::uint64_t v = 1; v <= 1000; ++v)
+        h->record(v * 1000);
+
+    REQUIRE(h->count() == 1000);
+    REQUIRE(h->max() == 1000000);
+
+    const auto near = [](std::uint64_t value, std::uint64_t expected)
+    { return value >= expected && value - expected <= expected / 32; };
+
+    REQUIRE(near(h->percentile(0.5), 500000));
+    REQUIRE(near(h->percentile(0.9), 900000));
+    REQUIRE(near(h->percentile(0.99), 990000));
+    REQUIRE(h->percentile(1.0) == 1000000);
+    REQUIRE(h->percentile(0.0) == h->percentile(0.001));
+}
@@ -23,11 +23,14 @@
 #include "xtr/formatters.hpp"
 #include "xtr/streamed.hpp"
 
+#include "xtr/detail/binary_decoder.hpp"
 #include "xtr/detail/commands/frame.hpp"
+#include "xtr/detail/commands/recv.hpp"
 #include "xtr/detail/commands/requests.hpp"
 #include "xtr/detail/commands/responses.hpp"
 #include "xtr/detail/config.hpp"
 #include "xtr/detail/file_descriptor.hpp"
+#include "xtr/detail/shared_stats.hpp"
 #include "xtr/io/fd_storage.hpp"
 #include "xtr/io/io_uring_fd_storage.hpp"
 #include "xtr/io/posix_fd_storage.hpp"
@@ -70,15 +73,20 @@
 #include <sstream>
 #include <string>
 #include <string_view>
+#include <system_error>
+#include <thread>
 #include <tuple>
 #include <utility>
 #include <vector>
 
 #include <err.h>
+#include <pthread.h>
+#include <sched.h>
 #include <setjmp.h>
 #include <signal.h>
 #include <stdio.h>
 #include <sys/mman.h>
+#include <sys/resource.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/un.h>
@@ -278,6 +286,7 @@ namespace
 
         std::thread worker_;
         std::atomic<std::size_t> n_events{};
+        std::atomic<std::size_t> n_bytes_formatted{};
     };
 
     struct pump_io_fixture : pump_io_fixture_base, fixture
@@ -295,11 +304,51 @@ namespace
                 {
                     xtr::pump_io_stats io_stats;
                     while (log_.pump_io(&io_stats))
+                    {
                         n_events += io_stats.n_events;
+                        n_bytes_formatted += io_stats.n_bytes_formatted;
+                    }
                 });
         }
     };
 
+    struct paused_fixture_base
+    {
+        void resume()
+        {
+            resumed_ = true;
+            resumed_.notify_one();
+        }
+
+        std::atomic<bool> resumed_{false};
+    };
+
+    // The consumer does not run until resume is called
+    struct paused_fixture : paused_fixture_base, pump_io_fixture_base, fixture
+    {
+        paused_fixture() :
+            fixture(
+                std::in_place,
+                test_clock{&clock_nanos_},
+                xtr::null_command_path,
+                xtr::default_log_level_style,
+                xtr::option_flags_t::disable_worker_thread)
+        {
+            worker_ = std::thread(
+                [&]()
+                {
+                    resumed_.wait(false);
+                    while (log_.pump_io())
+                        ;
+                });
+        }
+
+        ~paused_fixture()
+        {
+            resume();
+        }
+    };
+
     struct file_fixture_base
     {
         ~file_fixture_base()
@@ -327,6 +376,81 @@ namespace
         }
     };
 
+    struct binary_fixture : fixture
+    {
+        binary_fixture() :
+            fixture(
+                std::in_place,
+                test_clock{&clock_nanos_},
+                xtr::null_command_path,
+                xtr::default_log_level_style,
+                xtr::option_flags_t::binary_format)
+        {
+            storage_->submit_func_ = [this](char* buf, std::size_t size)
+            { raw_.append(buf, size); };
+        }
+
+        std::string raw()
+        {
+            sync();
+            std::scoped_lock lock{m_};
+            return raw_;
+        }
+
+        // Decodes the log as xtrdecode would, returning the decoded lines
+        std::vector<std::string> decoded_lines()
+        {
+            std::string raw = this->raw();
+            std::FILE* fp = ::fmemopen(raw.data(), raw.size(), "rb");
+            REQUIRE(fp != nullptr);
+            std::string text;
+            const std::string error = xtrd::binary::decode(
+                fp, [&](std::string_view str) { text += str; });
+            std::fclose(fp);
+            REQUIRE(error == "");
+
+            std::vector<std::string> lines;
+            std::istringstream ss(text);
+            for (std::string line; std::getline(ss, line);)
+                lines.push_back(std::move(line));
+            return lines;
+        }
+
+        std::string raw_;
+    };
+
+    template<typename Options>
+    struct idle_fixture : fixture
+    {
+        idle_fixture() :
+            fixture(
+                std::in_place,
+                test_clock{&clock_nanos_},
+                xtr::null_command_path,
+                xtr::default_log_level_style,
+                Options::value)
+        {
+        }
+
+        // Waits for lines without calling sync, so that the consumer is only
+        // woken by the log statements themselves.
+        bool wait_for_line_count(std::size_t n)
+        {
+            const auto deadline =
+                std::chrono::steady_clock::now() + std::chrono::seconds(10);
+            while (line_count() < n)
+            {
+                if (std::chrono::steady_clock::now() > deadline)
+                    return false;
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            return true;
+        }
+    };
+
+    template<xtr::option_flags_t Options>
+    using idle_options = std::integral_constant<xtr::option_flags_t, Options>;
+
     template<typename StorageType>
     struct template_file_fixture : file_fixture_base, fixture
     {
@@ -392,6 +516,39 @@ namespace
         }
     };
 
+    struct sharded_fixture
+    {
+        static constexpr std::size_t n_shards = 3;
+
+        sharded_fixture() :
+            log_(make_storages(), test_clock{&clock_nanos_}, xtr::null_command_path)
+        {
+        }
+
+        std::vector<xtr::storage_interface_ptr> make_storages()
+        {
+            std::vector<xtr::storage_interface_ptr> result;
+            for (std::size_t i = 0; i != n_shards; ++i)
+            {
+                storages_[i] = new container_storage(m_[i], lines_[i]);
+                result.emplace_back(storages_[i]);
+            }
+            return result;
+        }
+
+        std::vector<std::string> lines(std::size_t shard)
+        {
+            std::scoped_lock lock{m_[shard]};
+            return lines_[shard];
+        }
+
+        std::atomic<std::int64_t> clock_nanos_{946688523123456789L};
+        std::mutex m_[n_shards];
+        std::vector<std::string> lines_[n_shards];
+        container_storage* storages_[n_shards] = {};
+        xtr::logger log_;
+    };
+
 #if __cpp_exceptions
     struct thrower
     {
@@ -1042,6 +1199,52 @@ TEST_CASE_METHOD(fixture, "logger string table test", "[logger]")
                            line_));
 }
 
+TEST_CASE_METHOD(fixture, "logger interned string test", "[logger]")
+{
+    const std::string venue = "XLON";
+    const char* symbol = "VOD.L";
+    const std::string_view side{"BuyBADCODE", 3};
+
+    for (int i = 0; i < 3; ++i)
+    {
+        // clang-format off
+        XTR_LOG(s_, "Test {} {} {} {}", interned(venue), interned(symbol), i, interned(side)), line_ = __LINE__;
+        // clang-format on
+        REQUIRE(
+            last_line() == fmt::format(
+                               "I 2000-01-01 01:02:03.123456 Name logger.cpp:{}: "
+                               "Test XLON VOD.L {} Buy",
+                               line_,
+                               i));
+    }
+
+    // Interned strings are not copied into the sink
+    const auto& table = xtrd::global_intern_table();
+    const std::uint32_t n_interned = table.size();
+    XTR_LOG(s_, "{}", interned(venue));
+    REQUIRE(table.size() == n_interned);
+}
+
+TEST_CASE_METHOD(fixture, "logger sso string test", "[logger]")
+{
+    const std::string str = "truncated";
+    const std::string_view sv{"svBADCODE", 2};
+
+    // clang-format off
+    XTR_LOG(s_, "Test {} {} {} {}", sso<8>("hello"), sso<4>(str), sso<16>(sv), sso<1>("")), line_ = __LINE__;
+    // clang-format on
+    REQUIRE(
+        last_line() ==
+        fmt::format(
+            "I 2000-01-01 01:02:03.123456 Name logger.cpp:{}: Test hello trun sv ",
+            line_));
+
+    XTR_LOG(s_, "Test {}", xtr::sso<8>("a\nb")), line_ = __LINE__;
+    REQUIRE(
+        last_line() ==
+        fmt::format("I 2000-01-01 01:02:03.123456 Name logger.cpp:{}: Test a\\x0Ab", line_));
+}
+
 TEST_CASE_METHOD(fixture, "logger string overflow test", "[logger]")
 {
     const std::size_t record_size = sizeof(void*) + 4;
@@ -1168,6 +1371,76 @@ TEST_CASE_METHOD(fixture, "logger custom formatter test", "[logger]")
             line_));
 }
 
+TEST_CASE_METHOD(binary_fixture, "logger binary format test", "[logger]")
+{
+    using namespace std::literals::string_view_literals;
+
+    for (int i = 0; i != 3; ++i)
+        XTR_LOG(s_, "Binary {} {}", i, "str");
+
+    custom_format c{10, 20};
+    XTR_LOG(s_, "Custom {}", c), line_ = __LINE__;
+
+    const std::string raw = this->raw();
+
+    REQUIRE(raw.starts_with("\x7FXTR\x01"sv));
+
+    // Format strings are written once per site, not once per log statement
+    const auto site = raw.find("Binary {} {}");
+    REQUIRE(site != std::string::npos);
+    REQUIRE(raw.find("Binary {} {}", site + 1) == std::string::npos);
+    REQUIRE(raw.find("Binary 0") == std::string::npos);
+
+    // Arguments that cannot be encoded are formatted by the logger
+    REQUIRE(
+        raw.find(fmt::format(
+            "I 2000-01-01 01:02:03.123456 Name logger.cpp:{}: Custom (10, 20)\n",
+            line_)) != std::string::npos);
+}
+
+TEST_CASE("logger binary format decode test", "[logger]")
+{
+    // The same statements are logged in binary and text mode, decoding the
+    // binary log must reproduce the text log
+    const auto log_statements = [](fixture& f)
+    {
+        auto other = f.log_.get_sink("Other");
+
+        std::timespec ts;
+        ts.tv_sec = 631155723;
+        ts.tv_nsec = 654321000;
+
+        // Each sink is synced before logging to the other, as records of
+        // different sinks may otherwise be written in any order
+        for (int i = 0; i != 3; ++i)
+            XTR_LOG(f.s_, "Integers {} {} {}", i, -i, std::uint64_t(i) << 40);
+        XTR_LOGL(error, f.s_, "Floats {} {:.3f}", 1.5f, 2.25);
+        XTR_LOG(f.s_, "Strings {} {} {}", "str", std::string("string"), "\x01");
+        XTR_LOG(f.s_, "Custom {}", custom_format{10, 20});
+        XTR_LOG_TS(f.s_, xtr::timespec(ts), "Explicit timestamp");
+        f.s_.sync();
+
+        XTR_LOGL(warning, other, "Bool {} char {}", true, 'c');
+        XTR_LOG(other, "Pointer {}", static_cast<const void*>(nullptr));
+        XTR_LOG(other, "Timespec {}", xtr::timespec(ts));
+        other.sync();
+
+        XTR_LOG(f.s_, "No arguments");
+    };
+
+    binary_fixture binary;
+    log_statements(binary);
+
+    fixture text;
+    log_statements(text);
+    text.sync();
+
+    const std::vector<std::string> lines = binary.decoded_lines();
+    std::scoped_lock lock{text.m_};
+    REQUIRE(lines.size() == 11);
+    REQUIRE(lines == text.lines_);
+}
+
 TEST_CASE_METHOD(fixture, "logger timestamp test", "[logger]")
 {
     clock_nanos_ = 0;
@@ -1419,6 +1692,58 @@ TEST_CASE_METHOD(fixture, "logger argument move test", "[logger]")
         fmt::format("I 2000-01-01 01:02:03.123456 Name logger.cpp:{}: Test 42", line_));
 }
 
+TEST_CASE_METHOD(fixture, "logger rate limited test", "[logger]")
+{
+    for (int i = 0; i < 10; ++i)
+        XTR_LOG_EVERY_N(s_, 4, "Every {}", i), line_ = __LINE__;
+    sync();
+    REQUIRE(lines_.size() == 3);
+    REQUIRE(
+        lines_[0] ==
+        fmt::format("I 2000-01-01 01:02:03.123456 Name logger.cpp:{}: Every 0", line_));
+    REQUIRE(
+        lines_[1] ==
+        fmt::format(
+            "I 2000-01-01 01:02:03.123456 Name logger.cpp:{}: Every 4 (3 suppressed)",
+            line_));
+    REQUIRE(
+        lines_[2] ==
+        fmt::format(
+            "I 2000-01-01 01:02:03.123456 Name logger.cpp:{}: Every 8 (3 suppressed)",
+            line_));
+    lines_.clear();
+
+    for (int i = 0; i < 10; ++i)
+        XTR_LOG_FIRST_N(s_, 2, "First {}", i), line_ = __LINE__;
+    sync();
+    REQUIRE(lines_.size() == 2);
+    REQUIRE(
+        lines_[1] ==
+        fmt::format("I 2000-01-01 01:02:03.123456 Name logger.cpp:{}: First 1", line_));
+    lines_.clear();
+
+    for (int i = 0; i < 10; ++i)
+        XTR_LOG_EVERY_MS(s_, 60000, "Every ms"), line_ = __LINE__;
+    sync();
+    REQUIRE(lines_.size() == 1);
+    lines_.clear();
+
+    for (int i = 0; i < 10; ++i)
+    {
+        XTR_LOG_SAMPLED(s_, 0.0, "Never");
+        XTR_LOG_SAMPLED(s_, 1.0, "Always");
+    }
+    sync();
+    REQUIRE(lines_.size() == 10);
+    lines_.clear();
+
+    s_.set_level(xtr::log_level_t::error);
+    for (int i = 0; i < 10; ++i)
+        XTR_LOGL_EVERY_N(warning, s_, 2, "Filtered");
+    sync();
+    REQUIRE(lines_.empty());
+}
+
 TEST_CASE_METHOD(fixture, "logger non-blocking test", "[logger]")
 {
     XTR_TRY_LOG(s_, "Test"), line_ = __LINE__;
@@ -1494,6 +1819,148 @@ TEST_CASE_METHOD(fixture, "logger non-blocking drop test", "[logger]")
                 n_dropped)) == 1);
 }
 
+TEST_CASE_METHOD(fixture, "logger drop when full test", "[logger]")
+{
+    const std::size_t n_dropped = 100;
+    const std::size_t blocker_sz = 16;
+    const std::size_t msg_sz = 8;
+
+    auto s = log_.get_sink("Full", 4096, xtr::sink_flags_t::drop_when_full);
+    auto next_sink = log_.get_sink("next");
+    const std::size_t n = (s.capacity() - blocker_sz) / msg_sz + n_dropped;
+
+    blocker b;
+
+    XTR_LOG(s, "{}", b);
+
+    for (std::size_t i = 0; i < n; ++i)
+        XTR_LOG(s, "Test");
+
+    b.release();
+    s.sync();
+    // See "logger non-blocking drop test"
+    next_sink.sync();
+
+    REQUIRE(
+        std::ranges::count(
+            lines_,
+            fmt::format(
+                "W 2000-01-01 01:02:03.123456 Full: {} messages dropped",
+                n_dropped)) == 1);
+
+    const xtr::io_stats st = log_.get_io_stats();
+    REQUIRE(st.total.n_dropped == n_dropped);
+    const auto it = std::ranges::find(st.sinks, "Full", &xtr::sink_io_stats::name);
+    REQUIRE(it != st.sinks.end());
+    REQUIRE(it->dropped_count == n_dropped);
+}
+
+TEST_CASE_METHOD(paused_fixture, "logger overwrite oldest test", "[logger]")
+{
+    auto s = log_.get_sink("Recorder", 4096, xtr::sink_flags_t::overwrite_oldest);
+
+    // Each record is 16 bytes (function pointer and lambda capturing int),
+    // so at most the most recent 256 records fit into the sink.
+    constexpr std::size_t n = 1000;
+
+    for (std::size_t i = 0; i != n; ++i)
+        XTR_LOG(s, "Test {}", i), line_ = __LINE__;
+
+    resume();
+    s.sync();
+    // See "logger non-blocking drop test", sync is called on the fixture's
+    // sink to ensure that the consumer has reported the dropped count of s.
+    sync();
+
+    // Records are discarded to make space for the sync command, so slightly
+    // fewer than 256 records are kept.
+    REQUIRE(lines_.size() > 200);
+    const std::size_t n_kept = lines_.size() - 1;
+    for (std::size_t i = 0; i != n_kept; ++i)
+    {
+        REQUIRE(
+            lines_[i] ==
+            fmt::format(
+                "I 2000-01-01 01:02:03.123456 Recorder logger.cpp:{}: Test {}",
+                line_,
+                n - n_kept + i));
+    }
+    REQUIRE(
+        lines_.back() ==
+        fmt::format(
+            "W 2000-01-01 01:02:03.123456 Recorder: {} messages dropped",
+            n - n_kept));
+}
+
+TEST_CASE_METHOD(fixture, "logger overwrite oldest concurrent test", "[logger]")
+{
+    auto s = log_.get_sink("Recorder", 4096, xtr::sink_flags_t::overwrite_oldest);
+
+    // Strings are copied into the sink and std::string r-values are moved
+    // (and so are pinned), exercising records of varying sizes.
+    constexpr std::size_t n = 100000;
+    for (std::size_t i = 0; i != n; ++i)
+    {
+        if (i % 1000 == 0)
+            XTR_LOG(s, "Test {}", std::string(i % 100, 'y'));
+        else
+            XTR_LOG(s, "Test {} {}", i, std::string_view("xxxxxxxxxx", i % 11));
+    }
+    s.sync();
+    sync();
+
+    std::size_t n_logged = 0;
+    std::size_t n_dropped = 0;
+    for (const auto& line : lines_)
+    {
+        if (line.find(": Test ") != std::string::npos)
+            ++n_logged;
+        else if (const auto pos = line.find("Recorder: "); pos != std::string::npos)
+            n_dropped += std::stoul(line.substr(pos + 10));
+    }
+    REQUIRE(n_logged + n_dropped == n);
+}
+
+TEST_CASE_METHOD(fixture, "logger overwrite oldest mpsc test", "[logger]")
+{
+#if __cpp_exceptions
+    REQUIRE_THROWS_AS(
+        log_.get_mpsc_sink("Shared", 4096, xtr::sink_flags_t::overwrite_oldest),
+        std::invalid_argument);
+#endif
+}
+
+TEST_CASE_METHOD(fixture, "logger wait when full test", "[logger]")
+{
+    const auto flags =
+        GENERATE(xtr::sink_flags_t::yield_when_full, xtr::sink_flags_t::sleep_when_full);
+
+    auto s = log_.get_sink("Full", 4096, flags);
+    const std::size_t n = 10 * s.capacity() / 8;
+
+    blocker b;
+
+    XTR_LOG(s, "{}", b);
+
+    std::thread producer(
+        [&]()
+        {
+            for (std::size_t i = 0; i < n; ++i)
+                XTR_LOG(s, "Test");
+        });
+
+    // Give the producer time to fill the queue and begin waiting
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    b.release();
+    producer.join();
+    s.sync();
+
+    REQUIRE(std::ranges::count_if(
+                lines_,
+                [](const std::string& line) { return line.ends_with(": Test"); }) ==
+            std::ptrdiff_t(n));
+}
+
 // Calling these tests `soak' tests is stretching things but I can't think
 // of a better name.
 
@@ -1857,34 +2324,456 @@ TEST_CASE_METHOD(fixture, "logger sink copy test", "[logger]")
             line_));
 }
 
-TEST_CASE_METHOD(fixture, "logger sink name overwrite test", "[logger]")
+TEST_CASE_METHOD(paused_fixture, "logger sink assign keeps capacity and flags test", "[logger]")
 {
-    xtr::sink s = log_.get_sink("Overwritten");
+    auto big = log_.get_sink("Big", 1 << 20);
 
-    s = s_;
+    // The sink is not open, so assigning to it does not wait for the paused
+    // consumer to close it
+    xtr::sink recorder(
+        xtr::log_level_t::info, 4096, xtr::sink_flags_t::overwrite_oldest);
+    const std::size_t capacity = recorder.capacity();
+    recorder = big;
 
-    XTR_LOG(s, "Test"), line_ = __LINE__;
-    s.sync();
+    REQUIRE(recorder.capacity() == capacity);
+    REQUIRE(big.capacity() != capacity);
+
+    // The sink still overwrites records, so this does not block although the
+    // consumer is paused
+    constexpr std::size_t n = 1000;
+    for (std::size_t i = 0; i != n; ++i)
+        XTR_LOG(recorder, "Test {}", i), line_ = __LINE__;
+
+    resume();
+    recorder.sync();
+    sync();
+
+    std::scoped_lock lock{m_};
+    REQUIRE(lines_.size() > 1);
+    REQUIRE(lines_.size() < n);
     REQUIRE(
-        last_line() ==
-        fmt::format("I 2000-01-01 01:02:03.123456 Name logger.cpp:{}: Test", line_));
+        lines_[lines_.size() - 2] ==
+        fmt::format(
+            "I 2000-01-01 01:02:03.123456 Big logger.cpp:{}: Test {}", line_, n - 1));
+    REQUIRE(lines_.back().starts_with("W 2000-01-01 01:02:03.123456 Big: "));
 }
 
-TEST_CASE_METHOD(fixture, "logger sink assign from closed sink test", "[logger]")
+TEST_CASE_METHOD(fixture, "logger sink reopen test", "[logger]")
 {
-    xtr::sink s1 = log_.get_sink("Test1");
-    xtr::sink s2;
+    // Sinks that are closed release their doorbell slot to be reused by sinks
+    // opened later, so both new and reopened sinks must still be read.
+    constexpr std::size_t n_sinks = 130;
 
-    REQUIRE(s1.is_open());
-    REQUIRE(!s2.is_open());
+    std::vector<xtr::sink> sinks;
+    for (std::size_t i = 0; i < n_sinks; ++i)
+        sinks.push_back(log_.get_sink("Sink" + std::to_string(i)));
 
-    s1 = s2;
+    for (std::size_t i = 0; i < n_sinks; i += 2)
+        sinks[i].close();
 
-    REQUIRE(!s1.is_open());
-    REQUIRE(!s2.is_open());
+    auto extra = log_.get_sink("Extra");
+    XTR_LOG(extra, "Test"), line_ = __LINE__;
+    extra.sync();
+    REQUIRE(
+        last_line() ==
+        fmt::format("I 2000-01-01 01:02:03.123456 Extra logger.cpp:{}: Test", line_));
+
+    for (std::size_t i = 0; i < n_sinks; ++i)
+    {
+        if (!sinks[i].is_open())
+            sinks[i] = log_.get_sink("Reopened" + std::to_string(i));
+        XTR_LOG(sinks[i], "Test"), line_ = __LINE__;
+        sinks[i].sync();
+        REQUIRE(
+            last_line() ==
+            fmt::format(
+                "I 2000-01-01 01:02:03.123456 {}{} logger.cpp:{}: Test",
+                i % 2 == 0 ? "Reopened" : "Sink",
+                i,
+                line_));
+    }
 }
 
-TEST_CASE_METHOD(fixture, "logger sink self assign test", "[logger]")
+TEST_CASE_METHOD(fixture, "logger doorbell enable test", "[logger]")
+{
+    // The doorbell is only enabled once enough sinks have been added, at
+    // which point records already written to existing sinks must still be
+    // read. Each sink is synced as records of other sinks may be written in
+    // any order.
+    constexpr std::size_t n_sinks = 64;
+
+    const auto count = [&](std::size_t i, int line)
+    {
+        std::scoped_lock lock{m_};
+        return std::ranges::count(
+            lines_,
+            fmt::format(
+                "I 2000-01-01 01:02:03.123456 Sink{} logger.cpp:{}: Test", i, line));
+    };
+
+    std::vector<xtr::sink> sinks;
+    for (std::size_t i = 0; i < n_sinks; ++i)
+    {
+        sinks.push_back(log_.get_sink("Sink" + std::to_string(i)));
+        XTR_LOG(sinks.back(), "Test"), line_ = __LINE__;
+    }
+
+    for (auto& s : sinks)
+        s.sync();
+    for (std::size_t i = 0; i < n_sinks; ++i)
+        REQUIRE(count(i, line_) == 1);
+
+    for (auto& s : sinks)
+        XTR_LOG(s, "Test"), line_ = __LINE__;
+
+    for (auto& s : sinks)
+        s.sync();
+    for (std::size_t i = 0; i < n_sinks; ++i)
+        REQUIRE(count(i, line_) == 1);
+
+    REQUIRE(line_count() == 2 * n_sinks);
+}
+
+TEST_CASE_METHOD(sharded_fixture, "logger sharded test", "[logger]")
+{
+    REQUIRE(log_.shard_count() == n_shards);
+
+    std::vector<xtr::sink> sinks;
+    for (std::size_t i = 0; i != n_shards; ++i)
+    {
+        sinks.push_back(log_.get_sink(
+            "Sink" + std::to_string(i),
+            XTR_SINK_CAPACITY,
+            xtr::sink_flags_t::none,
+            i));
+    }
+
+    // Sinks with no explicit shard are assigned by name, copies are consumed
+    // by the same shard as their source sink
+    auto hashed = log_.get_sink("Hashed");
+    auto copied = sinks[1];
+
+    int line = 0;
+    for (auto& s : sinks)
+        XTR_LOG(s, "Test"), line = __LINE__;
+    XTR_LOG(copied, "Copy");
+    XTR_LOG(hashed, "Hashed");
+
+    for (auto& s : sinks)
+        s.sync();
+    hashed.sync();
+
+    for (std::size_t i = 0; i != n_shards; ++i)
+    {
+        const auto lines = this->lines(i);
+        REQUIRE(!lines.empty());
+        REQUIRE(
+            lines[0] ==
+            fmt::format("I 2000-01-01 01:02:03.123456 Sink{} logger.cpp:{}: Test", i, line));
+        const std::size_t expected = 1 + (i == 1) +
+            (i == std::hash<std::string>{}("Hashed") % n_shards);
+        REQUIRE(lines.size() == expected);
+    }
+}
+
+#if __cpp_exceptions
+namespace
+{
+    // Clock whose copy constructor throws once copies_left reaches zero
+    struct throwing_clock : std::chrono::system_clock
+    {
+        throwing_clock() = default;
+
+        throwing_clock(const throwing_clock&)
+        {
+            if (copies_left-- == 0)
+                throw std::runtime_error("Clock copy error");
+        }
+
+        inline static int copies_left = 0;
+    };
+}
+
+TEST_CASE("logger sharded constructor error test", "[logger]")
+{
+    // Each shard copies the clock, so failing on successive copies makes
+    // construction fail at successive shards, after earlier shards have been
+    // constructed. None of the failures may hang.
+    int n_failures = 0;
+    for (;; ++n_failures)
+    {
+        throwing_clock::copies_left = n_failures;
+        std::vector<xtr::storage_interface_ptr> storages;
+        for (std::size_t i = 0; i != 3; ++i)
+            storages.push_back(xtr::make_fd_storage("/dev/null"));
+        try
+        {
+            xtr::logger log(std::move(storages), throwing_clock(), xtr::null_command_path);
+            auto s = log.get_sink("Name");
+            XTR_LOG(s, "Test");
+            s.sync();
+            break;
+        }
+        catch (const std::runtime_error& e)
+        {
+            REQUIRE(e.what() == std::string_view("Clock copy error"));
+        }
+    }
+    REQUIRE(n_failures >= 3);
+}
+
+TEST_CASE("logger shared stats constructor error test", "[logger]")
+{
+    auto storage = xtr::make_fd_storage("/dev/null");
+
+    // Prevent any more file descriptors from being created, so that creating
+    // the shared statistics region fails
+    const int lowest_fd = ::dup(0);
+    REQUIRE(lowest_fd != -1);
+    ::close(lowest_fd);
+
+    struct ::rlimit old_limit;
+    REQUIRE(::getrlimit(RLIMIT_NOFILE, &old_limit) == 0);
+    struct ::rlimit new_limit = old_limit;
+    new_limit.rlim_cur = ::rlim_t(lowest_fd);
+    REQUIRE(::setrlimit(RLIMIT_NOFILE, &new_limit) == 0);
+
+    bool threw = false;
+    try
+    {
+        xtr::logger log(
+            std::move(storage),
+            std::chrono::system_clock(),
+            xtr::null_command_path,
+            xtr::default_log_level_style,
+            xtr::option_flags_t::shared_stats);
+    }
+    catch (const std::system_error&)
+    {
+        threw = true;
+    }
+
+    REQUIRE(::setrlimit(RLIMIT_NOFILE, &old_limit) == 0);
+    REQUIRE(threw);
+}
+#endif
+
+TEST_CASE_METHOD(fixture, "logger format threads test", "[logger]")
+{
+    log_.set_format_threads(3);
+
+    constexpr std::size_t n_sinks = 16;
+    constexpr std::size_t n_lines = 1000;
+
+    std::vector<xtr::sink> sinks;
+    for (std::size_t i = 0; i < n_sinks; ++i)
+        sinks.push_back(log_.get_sink("Sink" + std::to_string(i)));
+    auto mp = log_.get_mpsc_sink("MP");
+    // Overwrite sinks are read by the consumer thread rather than by format
+    // threads
+    auto ow = log_.get_sink("OW", XTR_SINK_CAPACITY, xtr::sink_flags_t::overwrite_oldest);
+
+    for (std::size_t n = 0; n < n_lines; ++n)
+    {
+        for (std::size_t i = 0; i < n_sinks; ++i)
+            XTR_LOG(sinks[i], "{} {}", std::to_string(i), n);
+        XTR_LOG(mp, "{} {}", n_sinks, n);
+        XTR_LOG(ow, "{} {}", n_sinks + 1, n);
+        // Commands are interleaved with records, and must be run in order
+        if (n % 100 == 0)
+            sinks[n / 100].sync();
+    }
+
+    // Closing a sink (a command) must not lose the records preceding it
+    sinks.back().close();
+    sinks.pop_back();
+
+    for (auto& s : sinks)
+        s.sync();
+    mp.sync();
+    ow.sync();
+
+    std::scoped_lock lock{m_};
+    REQUIRE(lines_.size() == (n_sinks + 2) * n_lines);
+
+    std::vector<std::size_t> next(n_sinks + 2);
+    for (const auto& line : lines_)
+    {
+        std::size_t i;
+        std::size_t n;
+        const auto msg = line.substr(line.find(": ") + 2);
+        REQUIRE(std::sscanf(msg.c_str(), "%zu %zu", &i, &n) == 2);
+        REQUIRE(i <= n_sinks + 1);
+        REQUIRE(n == next[i]++);
+    }
+}
+
+TEST_CASE_METHOD(paused_fixture, "logger format threads dropped test", "[logger]")
+{
+    // The consumer is paused, so it is run from this thread until the
+    // threads have been started
+    std::atomic<bool> set{false};
+    std::thread t(
+        [&]()
+        {
+            log_.set_format_threads(1);
+            set = true;
+        });
+    while (!set)
+        log_.pump_io();
+    t.join();
+
+    auto a = log_.get_sink("A", 4096, xtr::sink_flags_t::drop_when_full);
+    auto b = log_.get_sink("B");
+
+    // Both sinks are read in the same pass, by different threads
+    const std::size_t n = a.capacity() / 8 + 100;
+    for (std::size_t i = 0; i < n; ++i)
+        XTR_LOG(a, "Test");
+    XTR_LOG(b, "Test"), line_ = __LINE__;
+
+    const auto warned = [&]()
+    {
+        std::scoped_lock lock{m_};
+        return std::ranges::any_of(
+            lines_, [](const auto& line) { return line.ends_with("messages dropped"); });
+    };
+    while (!warned())
+        log_.pump_io();
+    resume();
+    b.sync();
+
+    // The warning is written after the records of A, before those of B
+    std::scoped_lock lock{m_};
+    REQUIRE(
+        lines_.back() ==
+        fmt::format("I 2000-01-01 01:02:03.123456 B logger.cpp:{}: Test", line_));
+    REQUIRE(lines_[lines_.size() - 2].starts_with("W 2000-01-01 01:02:03.123456 A: "));
+}
+
+TEST_CASE_METHOD(paused_fixture, "logger reorder window test", "[logger]")
+{
+    // The consumer is paused, so it is run from this thread until the
+    // window has been set
+    std::atomic<bool> set{false};
+    std::thread t(
+        [&]()
+        {
+            log_.set_reorder_window(std::chrono::seconds(1));
+            set = true;
+        });
+    while (!set)
+        log_.pump_io();
+    t.join();
+
+    auto a = log_.get_sink("A");
+    auto b = log_.get_sink("B");
+
+    // Timestamps are later than the clock, so records are only released
+    // once the consumer finds all sinks empty
+    const auto ts = [](long nanos)
+    { return xtr::timespec(std::timespec{.tv_sec = 946688524, .tv_nsec = nanos}); };
+
+    XTR_LOG_TS(a, ts(3), "Test {}", 3);
+    XTR_LOG_TS(a, ts(5), "Test {}", 5);
+    XTR_LOG_TS(b, ts(1), "Test {}", 1);
+    XTR_LOG_TS(b, ts(2), "Test {}", 2);
+    XTR_LOG_TS(b, ts(5), "Test {}", 6);
+    XTR_LOG_TS(a, ts(4), "Test {}", 4);
+
+    // Syncing a sink would write the records held by the window before the
+    // consumer is guaranteed to have read the other sink, so the consumer
+    // is run from this thread until all records have been written, and only
+    // then resumed (so that the sinks can be closed).
+    const auto n_lines = [&]()
+    {
+        std::scoped_lock lock{m_};
+        return lines_.size();
+    };
+    while (n_lines() < 6)
+        log_.pump_io();
+    resume();
+
+    std::scoped_lock lock{m_};
+    REQUIRE(lines_.size() == 6);
+    for (std::size_t i = 0; i != lines_.size(); ++i)
+        REQUIRE(lines_[i].ends_with(fmt::format("Test {}", i + 1)));
+}
+
+TEST_CASE_METHOD(fixture, "logger consumer affinity test", "[logger]")
+{
+    cpu_set_t cpus;
+    REQUIRE(::sched_getaffinity(0, sizeof(cpus), &cpus) == 0);
+    int cpu = 0;
+    while (!CPU_ISSET(cpu, &cpus))
+        ++cpu;
+
+    log_.set_consumer_affinity({cpu});
+    log_.set_consumer_scheduling(SCHED_OTHER, 0);
+
+    REQUIRE(
+        ::pthread_getaffinity_np(
+            log_.consumer_thread_native_handle(), sizeof(cpus), &cpus) == 0);
+    REQUIRE(CPU_COUNT(&cpus) == 1);
+    REQUIRE(CPU_ISSET(cpu, &cpus));
+
+#if __cpp_exceptions
+    REQUIRE_THROWS_AS(log_.set_consumer_affinity({-1}), std::system_error);
+    REQUIRE_THROWS_AS(log_.set_consumer_affinity({0}, 1), std::invalid_argument);
+#endif
+
+    XTR_LOG(s_, "Test"), line_ = __LINE__;
+    REQUIRE(
+        last_line() ==
+        fmt::format("I 2000-01-01 01:02:03.123456 Name logger.cpp:{}: Test", line_));
+}
+
+TEST_CASE_METHOD(fixture, "logger numa sink test", "[logger]")
+{
+    auto local = log_.get_sink("Local", XTR_SINK_CAPACITY, xtr::sink_flags_t::numa_local);
+    auto node = log_.get_sink("Node", XTR_SINK_CAPACITY, xtr::numa_node(0));
+    auto copy = node;
+
+    XTR_LOG(local, "Test"), line_ = __LINE__;
+    local.sync();
+    REQUIRE(
+        last_line() ==
+        fmt::format("I 2000-01-01 01:02:03.123456 Local logger.cpp:{}: Test", line_));
+    XTR_LOG(copy, "Test"), line_ = __LINE__;
+    copy.sync();
+    REQUIRE(
+        last_line() ==
+        fmt::format("I 2000-01-01 01:02:03.123456 Node logger.cpp:{}: Test", line_));
+}
+
+TEST_CASE_METHOD(fixture, "logger sink name overwrite test", "[logger]")
+{
+    xtr::sink s = log_.get_sink("Overwritten");
+
+    s = s_;
+
+    XTR_LOG(s, "Test"), line_ = __LINE__;
+    s.sync();
+    REQUIRE(
+        last_line() ==
+        fmt::format("I 2000-01-01 01:02:03.123456 Name logger.cpp:{}: Test", line_));
+}
+
+TEST_CASE_METHOD(fixture, "logger sink assign from closed sink test", "[logger]")
+{
+    xtr::sink s1 = log_.get_sink("Test1");
+    xtr::sink s2;
+
+    REQUIRE(s1.is_open());
+    REQUIRE(!s2.is_open());
+
+    s1 = s2;
+
+    REQUIRE(!s1.is_open());
+    REQUIRE(!s2.is_open());
+}
+
+TEST_CASE_METHOD(fixture, "logger sink self assign test", "[logger]")
 {
     xtr::sink s = log_.get_sink("Test1");
 
@@ -1997,6 +2886,41 @@ TEST_CASE_METHOD(fixture, "logger log level test", "[logger]")
     REQUIRE(lines_.size() == 10);
 }
 
+#undef XTR_MODULE_LEVEL
+#define XTR_MODULE_LEVEL warning
+
+TEST_CASE_METHOD(fixture, "logger module level test", "[logger]")
+{
+    s_.set_level(xtr::log_level_t::debug);
+
+    int n_calls = 0;
+    auto f = [&] { return ++n_calls; };
+
+    XTR_LOGL(error, s_, "Test {}", f()), line_ = __LINE__;
+    REQUIRE(
+        last_line() ==
+        fmt::format("E 2000-01-01 01:02:03.123456 Name logger.cpp:{}: Test 1", line_));
+    XTR_LOGL(warning, s_, "Test {}", f()), line_ = __LINE__;
+    REQUIRE(
+        last_line() ==
+        fmt::format("W 2000-01-01 01:02:03.123456 Name logger.cpp:{}: Test 2", line_));
+
+    // Removed at compile time, so arguments are not evaluated
+    XTR_LOGL(info, s_, "Test {}", f());
+    XTR_LOGL(debug, s_, "Test {}", f());
+    XTR_LOGL_TSC(info, s_, "Test {}", f());
+    XTR_TRY_LOGL(info, s_, "Test {}", f());
+    XTR_LOGL_EVERY_N(info, s_, 1, "Test {}", f());
+    XTR_LOGL_TLS(info, log_, "Test {}", f());
+
+    sync();
+    REQUIRE(n_calls == 2);
+    REQUIRE(lines_.size() == 2);
+}
+
+#undef XTR_MODULE_LEVEL
+#define XTR_MODULE_LEVEL XTR_MIN_LEVEL
+
 TEST_CASE_METHOD(command_fixture<>, "logger status command test", "[logger]")
 {
     auto p0 = log_.get_sink("Producer0");
@@ -2055,6 +2979,392 @@ TEST_CASE_METHOD(command_fixture<>, "logger status command test", "[logger]")
     REQUIRE(infos[4].dropped_count == 0);
 }
 
+TEST_CASE_METHOD(command_fixture<>, "logger status command throughput test", "[logger]")
+{
+    auto p = log_.get_sink("Producer");
+
+    const std::size_t n = 10;
+    for (std::size_t i = 0; i != n; ++i)
+        XTR_LOG(p, "Test {}", i);
+    p.sync();
+
+    xtrd::frame<xtrd::status> st;
+    st->pattern.type = xtrd::pattern_type_t::wildcard;
+    std::strcpy(st->pattern.text, "Producer");
+
+    auto infos = send_frame<xtrd::sink_info>(st);
+    REQUIRE(infos.size() == 1);
+
+    // The sync request is also a record
+    const std::size_t n_records = infos[0].n_records;
+    const std::size_t n_bytes = infos[0].n_bytes;
+    REQUIRE(n_records == n + 1);
+    REQUIRE(n_bytes >= n_records * sizeof(void*));
+
+    XTR_LOG(p, "Test");
+    p.sync();
+
+    reconnect();
+    infos = send_frame<xtrd::sink_info>(st);
+    REQUIRE(infos.size() == 1);
+    REQUIRE(infos[0].n_records == n_records + 2);
+    REQUIRE(infos[0].n_bytes > n_bytes);
+}
+
+TEST_CASE_METHOD(command_fixture<>, "logger status command sink capacity test", "[logger]")
+{
+    auto big = log_.get_sink("Big", 16 * 1024 * 1024);
+    auto small = log_.get_sink("Small", 5000);
+
+    REQUIRE(s_.capacity() == XTR_SINK_CAPACITY);
+    REQUIRE(big.capacity() == 16 * 1024 * 1024);
+    REQUIRE(small.capacity() == 8192);
+
+    // Copies use the capacity of the source sink
+    auto small_copy = small;
+    REQUIRE(small_copy.capacity() == 8192);
+
+    REQUIRE_THROWS_AS(log_.get_sink("Huge", std::size_t(1) << 32), std::invalid_argument);
+
+    // Fill the small sink to check that wrapping works with a non-default
+    // capacity.
+    for (std::size_t i = 0; i != 1000; ++i)
+        XTR_LOG(small, "Test {}", i), line_ = __LINE__;
+    small.sync();
+    REQUIRE(
+        last_line() ==
+        fmt::format("I 2000-01-01 01:02:03.123456 Small logger.cpp:{}: Test 999", line_));
+
+    xtrd::frame<xtrd::status> st;
+
+    st->pattern.type = xtrd::pattern_type_t::none;
+
+    const auto infos = send_frame<xtrd::sink_info>(st);
+
+    using namespace std::literals::string_view_literals;
+
+    REQUIRE(infos.size() == 4);
+
+    REQUIRE(infos[1].name == "Big"sv);
+    REQUIRE(infos[1].buf_capacity == big.capacity());
+
+    REQUIRE(infos[2].name == "Small"sv);
+    REQUIRE(infos[2].buf_capacity == small.capacity());
+
+    REQUIRE(infos[3].name == "Small"sv);
+    REQUIRE(infos[3].buf_capacity == small_copy.capacity());
+}
+
+TEST_CASE_METHOD(command_fixture<>, "logger latency command test", "[logger]")
+{
+    auto timed = log_.get_sink("Timed", XTR_SINK_CAPACITY, xtr::sink_flags_t::measure_latency);
+    auto shared =
+        log_.get_mpsc_sink("Shared", XTR_SINK_CAPACITY, xtr::sink_flags_t::measure_latency);
+    auto copy = timed;
+
+    const std::size_t n = 100;
+    for (std::size_t i = 0; i != n; ++i)
+        XTR_LOG(timed, "Test {}", i);
+    XTR_LOG(copy, "Test");
+    XTR_LOG(shared, "Test {}", "string");
+    XTR_LOG(s_, "Test");
+
+    timed.sync();
+    copy.sync();
+    shared.sync();
+    REQUIRE(lines_.size() == n + 3);
+
+    xtrd::frame<xtrd::latency> lt;
+    auto infos = send_frame<xtrd::latency_info>(lt);
+
+    std::ranges::sort(infos, std::greater{}, &xtrd::latency_info::count);
+
+    using namespace std::literals::string_view_literals;
+
+    // Sinks created without measure_latency, such as s_, are not reported,
+    // and the fixture's storage does not measure write latency.
+    REQUIRE(infos.size() == 3);
+
+    REQUIRE(infos[0].kind == xtrd::latency_kind_t::queue);
+    REQUIRE(infos[0].name == "Timed"sv);
+    REQUIRE(infos[0].count == n);
+    REQUIRE(infos[0].p50 <= infos[0].p90);
+    REQUIRE(infos[0].p90 <= infos[0].p99);
+    REQUIRE(infos[0].p99 <= infos[0].p999);
+    REQUIRE(infos[0].p999 <= infos[0].max);
+
+    REQUIRE(infos[1].count == 1);
+    REQUIRE(infos[2].count == 1);
+    REQUIRE(infos[1].p50 == infos[1].max);
+
+    reconnect();
+    lt->pattern.type = xtrd::pattern_type_t::basic_regex;
+    std::strcpy(lt->pattern.text, "Shared");
+    infos = send_frame<xtrd::latency_info>(lt);
+    REQUIRE(infos.size() == 1);
+    REQUIRE(infos[0].name == "Shared"sv);
+}
+
+TEST_CASE_METHOD(command_fixture<>, "logger latency record count test", "[logger]")
+{
+    auto timed = log_.get_sink(
+        "Timed",
+        4096,
+        xtr::sink_flags_t::measure_latency | xtr::sink_flags_t::drop_when_full);
+
+    // Fill the sink while the consumer is blocked, so that some statements
+    // are dropped. Each statement is written along with its enqueue time, so
+    // a dropped statement must not leave a latency sample behind.
+    blocker b;
+    XTR_LOG(timed, "{}", b);
+
+    const std::size_t n = 200;
+    for (std::size_t i = 0; i != n; ++i)
+        XTR_LOG(timed, "Test");
+    for (std::size_t i = 0; i != n; ++i)
+        XTR_LOG(timed, "Test {}", std::string("string"));
+
+    b.release();
+    timed.sync();
+
+    const xtr::io_stats st = log_.get_io_stats();
+    const auto it = std::ranges::find(st.sinks, "Timed", &xtr::sink_io_stats::name);
+    REQUIRE(it != st.sinks.end());
+    REQUIRE(it->dropped_count > 0);
+
+    const std::size_t n_logged = 2 * n + 1 - it->dropped_count;
+
+    // Enqueue times are not counted as records, the sync is
+    REQUIRE(it->n_records == n_logged + 1);
+
+    xtrd::frame<xtrd::latency> lt;
+    const auto infos = send_frame<xtrd::latency_info>(lt);
+    REQUIRE(infos.size() == 1);
+    REQUIRE(infos[0].count == n_logged);
+}
+
+TEST_CASE_METHOD(command_fixture<>, "logger latency format threads test", "[logger]")
+{
+    // Samples are recorded in the histogram of the sink being read, by the
+    // consumer thread or by format threads, including for overwrite sinks
+    log_.set_format_threads(2);
+
+    auto a = log_.get_sink("A", XTR_SINK_CAPACITY, xtr::sink_flags_t::measure_latency);
+    auto b = log_.get_sink("B", XTR_SINK_CAPACITY, xtr::sink_flags_t::measure_latency);
+    auto c = log_.get_sink(
+        "C",
+        XTR_SINK_CAPACITY,
+        xtr::sink_flags_t::measure_latency | xtr::sink_flags_t::overwrite_oldest);
+
+    const std::size_t n = 1000;
+    for (std::size_t i = 0; i != n; ++i)
+    {
+        XTR_LOG(a, "Test {}", i);
+        XTR_LOG(b, "Test {}", std::string("string"));
+        XTR_LOG(s_, "Test {}", i);
+        if (i % 2 == 0)
+            XTR_LOG(c, "Test");
+    }
+
+    a.sync();
+    b.sync();
+    c.sync();
+    s_.sync();
+    REQUIRE(line_count() == 3 * n + n / 2);
+
+    xtrd::frame<xtrd::latency> lt;
+    auto infos = send_frame<xtrd::latency_info>(lt);
+
+    std::ranges::sort(infos, {}, [](const auto& li) { return std::string(li.name); });
+
+    using namespace std::literals::string_view_literals;
+
+    REQUIRE(infos.size() == 3);
+    REQUIRE(infos[0].name == "A"sv);
+    REQUIRE(infos[0].count == n);
+    REQUIRE(infos[1].name == "B"sv);
+    REQUIRE(infos[1].count == n);
+    REQUIRE(infos[2].name == "C"sv);
+    REQUIRE(infos[2].count == n / 2);
+}
+
+TEST_CASE_METHOD(command_fixture<>, "logger metrics command test", "[logger]")
+{
+    std::vector<xtr::sink> sinks;
+    for (std::size_t i = 0; i != 8; ++i)
+        sinks.push_back(log_.get_sink(fmt::format("Metrics test sink {}", i)));
+    auto quoted = log_.get_sink("Quoted \"sink\" \\");
+
+    XTR_LOG(sinks[0], "Test");
+    XTR_LOG(quoted, "Test");
+    sinks[0].sync();
+    quoted.sync();
+
+    xtrd::frame<xtrd::metrics> mt;
+    const auto frames = send_frame<xtrd::metrics_text>(mt);
+
+    // The response is too large for one frame
+    REQUIRE(frames.size() > 1);
+
+    std::string text;
+    for (const auto& f : frames)
+    {
+        REQUIRE(f.size <= sizeof(f.text));
+        text.append(f.text, f.size);
+    }
+
+    REQUIRE(text.ends_with('\n'));
+
+    const auto value = [&](std::string_view sample) -> std::size_t
+    {
+        const std::string prefix = std::string(sample) + " ";
+        const std::size_t pos = text.find("\n" + prefix);
+        REQUIRE(pos != std::string::npos);
+        return std::stoul(text.substr(pos + 1 + prefix.size()));
+    };
+
+    REQUIRE(
+        text.find("# TYPE xtr_sink_dropped_total counter\n") !=
+        std::string::npos);
+    REQUIRE(value("xtr_sink_dropped_total{sink=\"Name\"}") == 0);
+    REQUIRE(
+        value("xtr_sink_buffer_capacity_bytes{sink=\"Metrics test sink 7\"}") ==
+        sinks[7].capacity());
+    REQUIRE(
+        value("xtr_sink_buffer_used_bytes{sink=\"Quoted \\\"sink\\\" \\\\\"}") ==
+        0);
+    REQUIRE(value("xtr_consumer_events_total{shard=\"0\"}") >= 4);
+    REQUIRE(value("xtr_consumer_written_bytes_total{shard=\"0\"}") > 0);
+    REQUIRE(value("xtr_consumer_storage_errors_total{shard=\"0\"}") == 0);
+}
+
+TEST_CASE_METHOD(command_fixture<>, "logger metrics duplicate name test", "[logger]")
+{
+    // Copies of a sink, and other sinks with the same name, are summed into
+    // one series
+    auto a = log_.get_sink("Same", 4096);
+    auto b = a;
+    auto c = log_.get_sink("Same", 64 * 1024);
+    c.sync();
+
+    xtrd::frame<xtrd::metrics> mt;
+    std::string text;
+    for (const auto& f : send_frame<xtrd::metrics_text>(mt))
+        text.append(f.text, f.size);
+
+    const std::string prefix = "\nxtr_sink_buffer_capacity_bytes{sink=\"Same\"} ";
+    const std::size_t pos = text.find(prefix);
+    REQUIRE(pos != std::string::npos);
+    REQUIRE(text.find(prefix, pos + 1) == std::string::npos);
+    REQUIRE(
+        std::stoul(text.substr(pos + prefix.size())) ==
+        a.capacity() + b.capacity() + c.capacity());
+}
+
+namespace
+{
+    using shared_stats_fixture =
+        idle_fixture<idle_options<xtr::option_flags_t::shared_stats>>;
+
+    // Requests the shared statistics region, returning the memfd attached to
+    // the reply
+    xtrd::file_descriptor recv_stats_region(xtrd::command_client& client)
+    {
+        xtrd::frame<xtrd::stats_region> sr;
+        client.send_frame(sr);
+
+        xtrd::frame_buf buf;
+        xtrd::file_descriptor fd;
+        const ::ssize_t nread = xtrd::command_recv(client.fd_.get(), buf, &fd);
+        REQUIRE(nread == sizeof(xtrd::frame<xtrd::stats_region_info>));
+        REQUIRE(buf.hdr.frame_id == xtrd::frame_id_t(xtrd::stats_region_info::frame_id));
+        REQUIRE(fd.is_open());
+        return fd;
+    }
+
+    std::map<std::string, xtrd::sink_stats> read_stats(int fd)
+    {
+        std::map<std::string, xtrd::sink_stats> result;
+        xtrd::shared_stats_reader reader(fd);
+        for (std::size_t i = 0; i != reader.size(); ++i)
+        {
+            xtrd::sink_stats stats;
+            char name[128];
+            if (xtrd::read_sink_stats(reader[i], stats, name))
+                result.emplace(name, stats);
+        }
+        return result;
+    }
+
+    // Statistics are published after sync returns, so tests must wait for
+    // them to be updated
+    template<typename Predicate>
+    std::map<std::string, xtrd::sink_stats> wait_for_stats(int fd, Predicate&& pred)
+    {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        auto stats = read_stats(fd);
+        while (!pred(stats) && std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            stats = read_stats(fd);
+        }
+        return stats;
+    }
+}
+
+TEST_CASE_METHOD(
+    command_fixture<shared_stats_fixture>, "logger shared stats test", "[logger]")
+{
+    auto a = log_.get_sink("A", 8192);
+    a.set_level(xtr::log_level_t::debug);
+    for (std::size_t i = 0; i != 5; ++i)
+        XTR_LOG(a, "Test");
+    a.sync();
+
+    const xtrd::file_descriptor fd = recv_stats_region(*this);
+
+    // Five log statements plus the sync control record
+    auto stats = wait_for_stats(
+        fd.get(), [](auto& st) { return st.contains("A") && st["A"].n_records == 6; });
+    REQUIRE(stats.size() == 2);
+    REQUIRE(stats.contains("Name"));
+    REQUIRE(stats.contains("A"));
+    REQUIRE(stats["A"].level == xtr::log_level_t::debug);
+    REQUIRE(stats["A"].buf_capacity == 8192);
+    REQUIRE(stats["A"].buf_nbytes == 0);
+    REQUIRE(stats["A"].dropped_count == 0);
+    REQUIRE(stats["A"].n_records == 6);
+    REQUIRE(stats["A"].n_bytes > 0);
+
+    // The region is updated without further commands
+    a.set_name("B");
+    a.sync();
+    stats = wait_for_stats(
+        fd.get(), [](auto& st) { return st.contains("B") && st["B"].n_records == 8; });
+    REQUIRE(stats.size() == 2);
+    REQUIRE(stats.contains("B"));
+    REQUIRE(stats["B"].n_records == 8);
+
+    // Closed sinks are removed
+    a.close();
+    stats = wait_for_stats(fd.get(), [](auto& st) { return st.size() == 1; });
+    REQUIRE(stats.size() == 1);
+    REQUIRE(stats.contains("Name"));
+}
+
+TEST_CASE_METHOD(
+    command_fixture<>, "logger shared stats disabled test", "[logger]")
+{
+    xtrd::frame<xtrd::stats_region> sr;
+
+    const auto errors = send_frame<xtrd::error>(sr);
+
+    using namespace std::literals::string_view_literals;
+
+    REQUIRE(errors.size() == 1);
+    REQUIRE(errors[0].reason == "Shared statistics are not enabled"sv);
+}
+
 TEST_CASE_METHOD(
     command_fixture<>, "logger status command dropped count test", "[logger]")
 {
@@ -2565,6 +3875,128 @@ TEST_CASE_METHOD(command_fixture<>, "logger reopen command test", "[logger]")
     REQUIRE(reopened);
 }
 
+TEST_CASE_METHOD(
+    command_fixture<sharded_fixture>, "logger sharded command test", "[logger]")
+{
+    auto p0 = log_.get_sink("Producer0", XTR_SINK_CAPACITY, xtr::sink_flags_t::none, 0);
+    auto p1 = log_.get_sink("Producer1", XTR_SINK_CAPACITY, xtr::sink_flags_t::none, 1);
+    auto p2 = log_.get_sink("Producer2", XTR_SINK_CAPACITY, xtr::sink_flags_t::none, 2);
+
+    p0.sync();
+    p1.sync();
+    p2.sync();
+
+    xtrd::frame<xtrd::set_level> sl;
+    sl->level = xtr::log_level_t::debug;
+    sl->pattern.type = xtrd::pattern_type_t::none;
+    send_frame<xtrd::success>(sl);
+
+    REQUIRE(p0.level() == xtr::log_level_t::debug);
+    REQUIRE(p1.level() == xtr::log_level_t::debug);
+    REQUIRE(p2.level() == xtr::log_level_t::debug);
+
+    reconnect();
+
+    xtrd::frame<xtrd::status> st;
+    st->pattern.type = xtrd::pattern_type_t::none;
+    const auto infos = send_frame<xtrd::sink_info>(st);
+
+    using namespace std::literals::string_view_literals;
+
+    REQUIRE(infos.size() == 3);
+    REQUIRE(infos[0].name == "Producer0"sv);
+    REQUIRE(infos[1].name == "Producer1"sv);
+    REQUIRE(infos[2].name == "Producer2"sv);
+
+    bool reopened[n_shards] = {};
+    for (std::size_t i = 0; i != n_shards; ++i)
+        storages_[i]->reopen_func_ = [&reopened, i]()
+        {
+            reopened[i] = true;
+            return 0;
+        };
+
+    reconnect();
+
+    xtrd::frame<xtrd::reopen> ro;
+    send_frame<xtrd::success>(ro);
+
+    // The reply is only sent once every shard has reopened
+    REQUIRE(reopened[0]);
+    REQUIRE(reopened[1]);
+    REQUIRE(reopened[2]);
+}
+
+TEST_CASE_METHOD(
+    command_fixture<sharded_fixture>, "logger sharded reopen error test", "[logger]")
+{
+    for (std::size_t i = 0; i != n_shards; ++i)
+        storages_[i]->reopen_func_ = [i]() { return i == 2 ? EACCES : 0; };
+
+    xtrd::frame<xtrd::reopen> ro;
+    const auto errors = send_frame<xtrd::error>(ro);
+
+    using namespace std::literals::string_view_literals;
+
+    REQUIRE(errors.size() == 1);
+    REQUIRE(errors[0].reason == "Permission denied"sv);
+
+    // Subsequent reopens are not blocked by the failed one
+    storages_[2]->reopen_func_ = []() { return 0; };
+    reconnect();
+    send_frame<xtrd::success>(ro);
+}
+
+TEST_CASE("logger sharded pump_io reopen test", "[logger]")
+{
+    // With disable_worker_thread every shard is run by the thread calling
+    // pump_io, so the first shard must not wait for the others to reopen
+    // while processing the command.
+    constexpr std::size_t n_shards = 2;
+    std::mutex m[n_shards];
+    std::vector<std::string> lines[n_shards];
+    std::atomic<bool> reopened[n_shards] = {};
+
+    std::vector<xtr::storage_interface_ptr> storages;
+    for (std::size_t i = 0; i != n_shards; ++i)
+    {
+        auto storage = std::make_unique<container_storage>(m[i], lines[i]);
+        storage->reopen_func_ = [&reopened, i]()
+        {
+            reopened[i] = true;
+            return 0;
+        };
+        storages.push_back(std::move(storage));
+    }
+
+    const std::string& path = xtr::default_command_path();
+
+    // Declared before the logger so that it is joined after the logger has
+    // stopped
+    std::jthread worker;
+    xtr::logger log(
+        std::move(storages),
+        std::chrono::system_clock(),
+        path,
+        xtr::default_log_level_style,
+        xtr::option_flags_t::disable_worker_thread);
+    worker = std::jthread(
+        [&]()
+        {
+            while (log.pump_io())
+                ;
+        });
+
+    xtrd::command_client client;
+    client.connect(path);
+
+    xtrd::frame<xtrd::reopen> ro;
+    client.send_frame<xtrd::success>(ro);
+
+    REQUIRE(reopened[0]);
+    REQUIRE(reopened[1]);
+}
+
 TEST_CASE_METHOD(
     command_fixture<>, "logger reopen command error test", "[logger]")
 {
@@ -2579,6 +4011,107 @@ TEST_CASE_METHOD(
     REQUIRE(errors[0].reason == "Bad file descriptor"sv);
 }
 
+TEST_CASE_METHOD(command_fixture<>, "logger site command test", "[logger]")
+{
+    auto log_debug = [this] { XTR_LOGL(debug, s_, "Site debug"); };
+    const int debug_line = __LINE__ - 1;
+    auto log_info = [this] { XTR_LOG(s_, "Site info {}", 42); };
+    const int info_line = __LINE__ - 1;
+
+    using namespace std::literals::string_view_literals;
+
+    xtrd::frame<xtrd::site_status> ss;
+    ss->pattern.type = xtrd::pattern_type_t::wildcard;
+    fmt::format_to(ss->pattern.text, "logger.cpp:{}\0", debug_line);
+
+    const auto sites = send_frame<xtrd::site_info>(ss);
+
+    REQUIRE(sites.size() == 1);
+    REQUIRE(sites[0].file == "logger.cpp"sv);
+    REQUIRE(sites[0].line == std::uint32_t(debug_line));
+    REQUIRE(sites[0].level == xtr::log_level_t::debug);
+    REQUIRE(sites[0].state == xtrd::site_state_t::normal);
+    REQUIRE(sites[0].format == "Site debug"sv);
+
+    log_debug();
+    s_.sync();
+    REQUIRE(lines_.empty());
+
+    // Enabling the debug statement logs it without changing the sink level
+    reconnect();
+    xtrd::frame<xtrd::set_site_state> sss;
+    sss->state = xtrd::site_state_t::enabled;
+    sss->pattern = ss->pattern;
+    send_frame<xtrd::success>(sss);
+
+    log_debug();
+    REQUIRE(
+        last_line() ==
+        fmt::format(
+            "D 2000-01-01 01:02:03.123456 Name logger.cpp:{}: Site debug",
+            debug_line));
+    REQUIRE(s_.level() == xtr::log_level_t::info);
+
+    // Disabled statements do not log, including those without a log level
+    reconnect();
+    sss->state = xtrd::site_state_t::disabled;
+    fmt::format_to(sss->pattern.text, "logger.cpp:{}\0", info_line);
+    send_frame<xtrd::success>(sss);
+
+    log_info();
+    s_.sync();
+    REQUIRE(lines_.size() == 1);
+
+    reconnect();
+    sss->state = xtrd::site_state_t::normal;
+    send_frame<xtrd::success>(sss);
+
+    log_info();
+    REQUIRE(
+        last_line() ==
+        fmt::format(
+            "I 2000-01-01 01:02:03.123456 Name logger.cpp:{}: Site info 42",
+            info_line));
+
+    reconnect();
+    sss->state = static_cast<xtrd::site_state_t>(42);
+    const auto errors = send_frame<xtrd::error>(sss);
+    REQUIRE(errors.size() == 1);
+    REQUIRE(errors[0].reason == "Invalid state"sv);
+
+    // The suppressed count of rate limited statements is not part of the
+    // statement's format string
+    XTR_LOG_EVERY_N(s_, 2, "Site limited {}", 42);
+    const int limited_line = __LINE__ - 1;
+
+    reconnect();
+    fmt::format_to(ss->pattern.text, "logger.cpp:{}\0", limited_line);
+    const auto limited = send_frame<xtrd::site_info>(ss);
+    REQUIRE(limited.size() == 1);
+    REQUIRE(limited[0].format == "Site limited {}"sv);
+
+    // Sites of a statement in a template are listed once and share a state
+    auto log_generic = [this](auto value) { XTR_LOG(s_, "Site generic {}", value); };
+    const int generic_line = __LINE__ - 1;
+    log_generic(1);
+    log_generic(2.5);
+
+    reconnect();
+    fmt::format_to(ss->pattern.text, "logger.cpp:{}\0", generic_line);
+    REQUIRE(send_frame<xtrd::site_info>(ss).size() == 1);
+
+    reconnect();
+    sss->state = xtrd::site_state_t::disabled;
+    sss->pattern = ss->pattern;
+    send_frame<xtrd::success>(sss);
+
+    const std::size_t n_lines = line_count();
+    log_generic(3);
+    log_generic(4.5);
+    s_.sync();
+    REQUIRE(line_count() == n_lines);
+}
+
 TEST_CASE_METHOD(
     command_fixture<path_fixture>, "logger reopen command path test", "[logger]")
 {
@@ -2697,6 +4230,161 @@ TEST_CASE_METHOD(fixture, "logger re-register sink test", "[logger]")
             line_));
 }
 
+TEST_CASE_METHOD(fixture, "logger mpsc sink test", "[logger]")
+{
+    constexpr std::size_t n_threads = 4;
+    constexpr std::size_t n_messages = 2000;
+
+    xtr::mpsc_sink ms = log_.get_mpsc_sink("Shared");
+
+    {
+        std::vector<std::thread> threads;
+        for (std::size_t t = 0; t != n_threads; ++t)
+        {
+            threads.emplace_back(
+                [&ms, t]()
+                {
+                    for (std::size_t i = 0; i != n_messages; ++i)
+                    {
+                        // Alternate between fixed and variable length records
+                        if (i % 2 == 0)
+                            XTR_LOG(ms, "{} {}", t, i);
+                        else
+                            XTR_LOG(ms, "{} {} {}", t, i, std::string(i % 7, 'x'));
+                    }
+                });
+        }
+        for (auto& thread : threads)
+            thread.join();
+    }
+
+    ms.sync();
+
+    // Each thread's messages must all be present, and in the order they
+    // were logged by that thread.
+    std::vector<std::size_t> next(n_threads);
+    {
+        std::scoped_lock lock{m_};
+        for (const auto& line : lines_)
+        {
+            std::size_t t, i;
+            REQUIRE(std::sscanf(line.c_str(), "%*s %*s %*s Shared %*s %zu %zu", &t, &i) == 2);
+            REQUIRE(t < n_threads);
+            REQUIRE(i == next[t]++);
+        }
+    }
+
+    for (std::size_t t = 0; t != n_threads; ++t)
+        REQUIRE(next[t] == n_messages);
+
+    ms.set_name("Renamed");
+    XTR_LOG(ms, "Test"), line_ = __LINE__;
+    ms.sync();
+    REQUIRE(
+        last_line() ==
+        fmt::format("I 2000-01-01 01:02:03.123456 Renamed logger.cpp:{}: Test", line_));
+
+    ms.close();
+    log_.register_sink(ms, "Reregistered");
+    XTR_TRY_LOG(ms, "Test"), line_ = __LINE__;
+    ms.sync();
+    REQUIRE(
+        last_line() ==
+        fmt::format(
+            "I 2000-01-01 01:02:03.123456 Reregistered logger.cpp:{}: Test",
+            line_));
+}
+
+TEST_CASE_METHOD(fixture, "logger batch test", "[logger]")
+{
+    {
+        xtr::sink::batch b(s_);
+        for (std::size_t i = 0; i != 20; ++i)
+            XTR_LOG(b, "Test {}", i);
+        XTR_LOGL(info, b, "Test");
+        XTR_LOG(b, "Test {}", std::string_view("string")), line_ = __LINE__;
+    }
+    s_.sync();
+    REQUIRE(line_count() == 22);
+    REQUIRE(
+        last_line() ==
+        fmt::format(
+            "I 2000-01-01 01:02:03.123456 Name logger.cpp:{}: Test string",
+            line_));
+
+    // Batches larger than the sink capacity must publish when the queue
+    // is full, otherwise the background thread could not make space.
+    clear_lines();
+    xtr::sink small = log_.get_sink("Small", 4096);
+    const std::size_t n = 10 * small.capacity() / 32;
+    {
+        xtr::sink::batch b(small);
+        for (std::size_t i = 0; i != n; ++i)
+        {
+            if (i % 2 == 0)
+                XTR_LOG(b, "{}", i);
+            else
+                XTR_LOG(b, "{}", std::string(i % 64, 'x'));
+        }
+        b.sync();
+        REQUIRE(line_count() == n);
+        XTR_LOG(b, "Test"), line_ = __LINE__;
+    }
+    small.sync();
+    REQUIRE(
+        last_line() ==
+        fmt::format("I 2000-01-01 01:02:03.123456 Small logger.cpp:{}: Test", line_));
+}
+
+TEST_CASE_METHOD(fixture, "logger thread sink test", "[logger]")
+{
+    XTR_LOG_TLS(log_, "Test"), line_ = __LINE__;
+    log_.thread_sink().sync();
+    REQUIRE(last_line().starts_with("I 2000-01-01 01:02:03.123456 thread-"));
+    REQUIRE(last_line().ends_with(fmt::format(" logger.cpp:{}: Test", line_)));
+
+    xtr::sink& ts = log_.thread_sink();
+    REQUIRE(&ts == &log_.thread_sink());
+    REQUIRE(ts.is_open());
+
+    ts.set_name("Main");
+    ts.set_level(xtr::log_level_t::error);
+    XTR_LOGL_TLS(info, log_, "Test");
+    XTR_TRY_LOGL_TLS(error, log_, "Test {}", 42), line_ = __LINE__;
+    ts.sync();
+    REQUIRE(
+        last_line() ==
+        fmt::format("E 2000-01-01 01:02:03.123456 Main logger.cpp:{}: Test 42", line_));
+
+    // Sinks belonging to other threads are closed (and so fully drained)
+    // when those threads exit.
+    constexpr std::size_t n_threads = 4;
+    constexpr std::size_t n_messages = 100;
+
+    clear_lines();
+    {
+        std::vector<std::thread> threads;
+        for (std::size_t t = 0; t != n_threads; ++t)
+        {
+            threads.emplace_back(
+                [this]()
+                {
+                    for (std::size_t i = 0; i != n_messages; ++i)
+                        XTR_LOG_TLS(log_, "{}", i);
+                });
+        }
+        for (auto& thread : threads)
+            thread.join();
+    }
+    sync();
+    REQUIRE(line_count() == n_threads * n_messages);
+
+    log_.close_thread_sink();
+    XTR_LOG_TLS(log_, "Test"), line_ = __LINE__;
+    log_.thread_sink().sync();
+    REQUIRE(last_line().starts_with("I 2000-01-01 01:02:03.123456 thread-"));
+}
+
 TEST_CASE_METHOD(fixture, "logger macro test", "[logger]")
 {
     xtr::timespec ts{};
@@ -3095,7 +4783,46 @@ TEST_CASE_METHOD(pump_io_fixture, "logger pump_io test", "[logger]")
     REQUIRE(
         last_line() ==
         fmt::format("I 2000-01-01 01:02:03.123456 Name logger.cpp:{}: Test", line_));
+    // The sync above may be read in the same pass as the record, before the
+    // worker has added that pass's stats, but this second sync can only be
+    // read by a later pass.
+    sync();
     REQUIRE(n_events >= 1); // Sink creation, sync() create events
+    REQUIRE(n_bytes_formatted >= last_line().size() + 1);
+}
+
+TEST_CASE_METHOD(fixture, "logger io stats test", "[logger]")
+{
+    auto other = log_.get_sink("Other");
+
+    const std::size_t n = 10;
+    for (std::size_t i = 0; i != n; ++i)
+        XTR_LOG(s_, "Test {}", i);
+    XTR_LOG(other, "Test");
+    other.sync();
+    sync();
+
+    std::size_t n_bytes = 0;
+    for (const auto& line : lines_)
+        n_bytes += line.size() + 1;
+
+    const xtr::io_stats st = log_.get_io_stats();
+    REQUIRE(st.total.n_events >= n + 1);
+    REQUIRE(st.total.n_bytes_formatted >= n_bytes);
+    REQUIRE(st.total.n_bytes_submitted >= n_bytes);
+    REQUIRE(st.total.n_bytes_submitted <= st.total.n_bytes_formatted);
+    REQUIRE(st.total.n_dropped == 0);
+    REQUIRE(st.total.format_time.count() > 0);
+
+    REQUIRE(st.sinks.size() == 2);
+    const auto name = std::ranges::find(st.sinks, "Name", &xtr::sink_io_stats::name);
+    REQUIRE(name != st.sinks.end());
+    REQUIRE(name->n_records >= n);
+    REQUIRE(name->dropped_count == 0);
+    const auto o = std::ranges::find(st.sinks, "Other", &xtr::sink_io_stats::name);
+    REQUIRE(o != st.sinks.end());
+    REQUIRE(o->n_records >= 1);
+    REQUIRE(o->n_records < n);
 }
 
 TEST_CASE_METHOD(fixture, "logger vcopy test", "[logger]")
@@ -3167,3 +4894,31 @@ TEST_CASE_METHOD(fixture, "logger vcopy overflow test", "[logger]")
         fmt::format("W 2000-01-01 01:02:03.123456 Name: 1 messages dropped"));
     REQUIRE(w.expired());
 }
+
+TEMPLATE_TEST_CASE_METHOD(
+    idle_fixture,
+    "logger idle strategy test",
+    "[logger][template]",
+    idle_options<xtr::option_flags_t::idle_backoff>,
+    idle_options<xtr::option_flags_t::idle_sleep>,
+    idle_options<xtr::option_flags_t::idle_umwait>)
+{
+    xtr::mpsc_sink ms = this->log_.get_mpsc_sink("Shared");
+
+    for (std::size_t i = 1; i != 4; ++i)
+    {
+        // Give the consumer time to park itself
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        XTR_LOG(this->s_, "Test {}", i), this->line_ = __LINE__;
+        REQUIRE(this->wait_for_line_count(2 * i - 1));
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        XTR_LOG(ms, "Test {}", i);
+        REQUIRE(this->wait_for_line_count(2 * i));
+    }
+
+    REQUIRE(
+        this->last_line() ==
+        fmt::format(
+            "I 2000-01-01 01:02:03.123456 Shared logger.cpp:{}: Test 3",
+            this->line_ + 3));
+}
@@ -27,6 +27,7 @@
 #include <utility>
 
 #include <stdlib.h>
+#include <sys/mman.h>
 #include <unistd.h>
 
 namespace xtrd = xtr::detail;
@@ -99,6 +100,61 @@ TEST_CASE("mirrored_memory_mapping file mapping", "[mirrored_memory_mapping]")
     ::close(fd);
 }
 
+TEST_CASE("mirrored_memory_mapping huge pages", "[mirrored_memory_mapping]")
+{
+    // Explicit huge pages are used if available (2MiB being the most common
+    // huge page size), otherwise transparent huge pages are requested.
+    xtrd::mirrored_memory_mapping m1(2UL << 20, -1, 0, 0, xtrd::mirror_huge_pages);
+    test_mirroring(m1);
+
+    // Not a multiple of the huge page size, so must fall back
+    xtrd::mirrored_memory_mapping m2(
+        xtrd::align_to_page_size(1),
+        -1,
+        0,
+        0,
+        xtrd::mirror_huge_pages);
+    test_mirroring(m2);
+}
+
+TEST_CASE("mirrored_memory_mapping lock memory", "[mirrored_memory_mapping]")
+{
+    const std::size_t len = xtrd::align_to_page_size(1);
+
+    xtrd::mirrored_memory_mapping m(
+        len,
+        -1,
+        0,
+        0,
+        xtrd::mirror_huge_pages | xtrd::mirror_lock_memory);
+
+    unsigned char vec[2];
+    REQUIRE(::mincore(m.get(), len * 2, vec) == 0);
+    REQUIRE((vec[0] & vec[1] & 1) == 1);
+
+    test_mirroring(m);
+}
+
+TEST_CASE("mirrored_memory_mapping numa", "[mirrored_memory_mapping]")
+{
+    const std::size_t len = xtrd::align_to_page_size(1);
+
+    for (const int flags :
+         {xtrd::mirror_numa_local,
+          xtrd::mirror_numa_node(0),
+          // Nodes that do not exist are ignored
+          xtrd::mirror_numa_node(1000)})
+    {
+        xtrd::mirrored_memory_mapping m(len, -1, 0, 0, flags);
+
+        unsigned char vec[2];
+        REQUIRE(::mincore(m.get(), len * 2, vec) == 0);
+        REQUIRE((vec[0] & vec[1] & 1) == 1);
+
+        test_mirroring(m);
+    }
+}
+
 #if __cpp_exceptions
 TEST_CASE(
     "mirrored_memory_mapping size not page aligned", "[mirrored_memory_mapping]")
@@ -0,0 +1,97 @@
+// Copyright 2026 Chris E. Holloway
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "xtr/detail/record_index.hpp"
+
+#include <catch2/catch.hpp>
+
+namespace xtrd = xtr::detail;
+
+TEST_CASE("record_index discard range test", "[record_index]")
+{
+    constexpr std::size_t capacity = 4096;
+    xtrd::record_index ri(capacity);
+
+    // Records of 8, 24 and 16 bytes, repeated
+    std::size_t pos = 0;
+    for (std::size_t i = 0; i != 10; ++i)
+    {
+        ri.mark(pos, 8, false);
+        ri.mark(pos + 8, 24, false);
+        ri.mark(pos + 32, 16, false);
+        pos += 48;
+    }
+
+    auto r = ri.find_discard_range(0, 1, pos);
+    REQUIRE(r.end == 8);
+    REQUIRE(r.count == 1);
+
+    r = ri.find_discard_range(0, 9, pos);
+    REQUIRE(r.end == 32);
+    REQUIRE(r.count == 2);
+
+    r = ri.find_discard_range(8, 100, pos);
+    REQUIRE(r.end == 104);
+    REQUIRE(r.count == 6);
+
+    // No records begin at or after the target
+    r = ri.find_discard_range(0, pos - 8, pos);
+    REQUIRE(r.end == pos);
+    REQUIRE(r.count == 30);
+}
+
+TEST_CASE("record_index pinned test", "[record_index]")
+{
+    xtrd::record_index ri(4096);
+
+    ri.mark(0, 8, false);
+    ri.mark(8, 8, true);
+    ri.mark(16, 8, false);
+
+    auto r = ri.find_discard_range(0, 24, 24);
+    REQUIRE(r.end == 8);
+    REQUIRE(r.count == 1);
+
+    r = ri.find_discard_range(8, 24, 24);
+    REQUIRE(r.end == 8);
+    REQUIRE(r.count == 0);
+}
+
+TEST_CASE("record_index wrap around test", "[record_index]")
+{
+    constexpr std::size_t capacity = 4096;
+    xtrd::record_index ri(capacity);
+
+    // Fill the index with 8 byte records, then overwrite it with 32 byte
+    // records that wrap around the end of the index.
+    for (std::size_t pos = 0; pos != capacity; pos += 8)
+        ri.mark(pos, 8, false);
+    for (std::size_t pos = capacity + 8; pos < 2 * capacity + 8; pos += 32)
+        ri.mark(pos, 32, false);
+
+    // Stale 8 byte records within the 32 byte records must not be found
+    auto r = ri.find_discard_range(capacity + 8, capacity + 9, 2 * capacity + 8);
+    REQUIRE(r.end == capacity + 40);
+    REQUIRE(r.count == 1);
+
+    r = ri.find_discard_range(2 * capacity - 24, 2 * capacity - 23, 2 * capacity + 8);
+    REQUIRE(r.end == 2 * capacity + 8);
+    REQUIRE(r.count == 1);
+}
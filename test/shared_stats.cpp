@@ -0,0 +1,131 @@
+// Copyright 2026 Chris E. Holloway
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "xtr/detail/shared_stats.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <string>
+
+namespace xtrd = xtr::detail;
+
+TEST_CASE("shared_stats publish test", "[shared_stats]")
+{
+    xtrd::shared_stats stats;
+
+    const std::uint32_t a = stats.allocate("a");
+    const std::uint32_t b = stats.allocate("b");
+    REQUIRE(a != xtrd::shared_stats::npos);
+    REQUIRE(b != xtrd::shared_stats::npos);
+    REQUIRE(a != b);
+
+    stats.publish(
+        b,
+        xtrd::sink_stats{
+            .level = xtr::log_level_t::debug,
+            .buf_capacity = 4096,
+            .buf_nbytes = 64,
+            .dropped_count = 2,
+            .n_records = 10,
+            .n_bytes = 320});
+
+    xtrd::shared_stats_reader reader(stats.fd());
+    REQUIRE(reader.size() == 2);
+
+    xtrd::sink_stats s;
+    char name[128];
+
+    REQUIRE(xtrd::read_sink_stats(reader[a], s, name));
+    REQUIRE(std::string(name) == "a");
+    REQUIRE(s.n_records == 0);
+
+    REQUIRE(xtrd::read_sink_stats(reader[b], s, name));
+    REQUIRE(std::string(name) == "b");
+    REQUIRE(s.level == xtr::log_level_t::debug);
+    REQUIRE(s.buf_capacity == 4096);
+    REQUIRE(s.buf_nbytes == 64);
+    REQUIRE(s.dropped_count == 2);
+    REQUIRE(s.n_records == 10);
+    REQUIRE(s.n_bytes == 320);
+
+    // Updates are visible through an existing reader
+    stats.set_name(a, "renamed");
+    REQUIRE(xtrd::read_sink_stats(reader[a], s, name));
+    REQUIRE(std::string(name) == "renamed");
+}
+
+TEST_CASE("shared_stats release test", "[shared_stats]")
+{
+    xtrd::shared_stats stats;
+
+    const std::uint32_t a = stats.allocate("a");
+    stats.release(a);
+
+    xtrd::shared_stats_reader reader(stats.fd());
+    xtrd::sink_stats s;
+    char name[128];
+    REQUIRE(!xtrd::read_sink_stats(reader[a], s, name));
+
+    // Released slots are reused, and are reset when reallocated
+    REQUIRE(stats.allocate("b") == a);
+    REQUIRE(xtrd::read_sink_stats(reader[a], s, name));
+    REQUIRE(std::string(name) == "b");
+    REQUIRE(s.n_records == 0);
+}
+
+TEST_CASE("shared_stats growth test", "[shared_stats]")
+{
+    xtrd::shared_stats stats;
+
+    constexpr std::uint32_t n = 1000;
+    for (std::uint32_t i = 0; i != n; ++i)
+    {
+        REQUIRE(stats.allocate(std::to_string(i)) == i);
+        xtrd::sink_stats s{};
+        s.n_records = i;
+        stats.publish(i, s);
+    }
+
+    xtrd::shared_stats_reader reader(stats.fd());
+    REQUIRE(reader.size() == n);
+
+    for (std::uint32_t i = 0; i != n; ++i)
+    {
+        xtrd::sink_stats s;
+        char name[128];
+        REQUIRE(xtrd::read_sink_stats(reader[i], s, name));
+        REQUIRE(std::string(name) == std::to_string(i));
+        REQUIRE(s.n_records == i);
+    }
+}
+
+TEST_CASE("shared_stats long name test", "[shared_stats]")
+{
+    xtrd::shared_stats stats;
+
+    const std::string long_name(200, 'x');
+    const std::uint32_t a = stats.allocate(long_name);
+
+    xtrd::shared_stats_reader reader(stats.fd());
+    xtrd::sink_stats s;
+    char name[128];
+    REQUIRE(xtrd::read_sink_stats(reader[a], s, name));
+    REQUIRE(std::string(name) == long_name.substr(0, sizeof(name) - 1));
+}
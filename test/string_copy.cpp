@@ -0,0 +1,129 @@
+// Copyright 2026 Chris E. Holloway
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "xtr/detail/string_copy.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <iterator>
+
+namespace xtrd = xtr::detail;
+
+namespace
+{
+    using kernel_t = std::function<std::size_t(std::byte*, std::size_t, const char*)>;
+
+    std::array<std::pair<const char*, kernel_t>, 4> kernels()
+    {
+        return {{
+            {"default", xtrd::copy_c_string},
+            {"scalar", [](auto dst, auto n, auto src)
+             { return xtrd::copy_c_string_scalar(dst, n, src); }},
+#if defined(__x86_64__)
+            {"sse2", xtrd::copy_c_string_sse2},
+            {"avx2", xtrd::has_avx2() ? kernel_t(xtrd::copy_c_string_avx2) : kernel_t()},
+#endif
+        }};
+    }
+}
+
+TEST_CASE("copy_c_string test", "[string_copy]")
+{
+    for (const auto& [name, kernel] : kernels())
+    {
+        if (!kernel)
+            continue;
+        INFO("kernel " << name);
+
+        alignas(64) char src[384];
+        alignas(64) std::byte dst[384];
+
+        for (std::size_t offset = 0; offset != 64; ++offset)
+        {
+            for (std::size_t length = 0; length != 200; ++length)
+            {
+                std::memset(src, 'x', sizeof(src));
+                for (std::size_t i = 0; i != length; ++i)
+                    src[offset + i] = char('a' + i % 26);
+                src[offset + length] = '\0';
+
+                for (const std::size_t n : {std::size_t(0),
+                                            std::size_t(1),
+                                            length / 2,
+                                            length,
+                                            length + 1,
+                                            length + 31,
+                                            std::size_t(256)})
+                {
+                    INFO("offset " << offset << " length " << length << " n " << n);
+                    std::memset(dst, 0xFF, sizeof(dst));
+                    REQUIRE(kernel(dst, n, src + offset) == length);
+                    const std::size_t copied = std::min(length, n);
+                    REQUIRE(std::memcmp(dst, src + offset, copied) == 0);
+                    // Nothing is written beyond the capacity
+                    REQUIRE(std::all_of(
+                        dst + n,
+                        std::end(dst),
+                        [](std::byte b) { return b == std::byte{0xFF}; }));
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("copy_c_string page boundary test", "[string_copy]")
+{
+    // The string ends immediately before an inaccessible page, so any read
+    // past the terminator that crosses a page boundary faults.
+    const std::size_t page = std::size_t(::sysconf(_SC_PAGESIZE));
+    void* mem =
+        ::mmap(nullptr, page * 2, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    REQUIRE(mem != MAP_FAILED);
+    char* const base = static_cast<char*>(mem);
+    REQUIRE(::mprotect(base + page, page, PROT_NONE) == 0);
+
+    for (const auto& [name, kernel] : kernels())
+    {
+        if (!kernel)
+            continue;
+        INFO("kernel " << name);
+
+        for (std::size_t length = 0; length != 100; ++length)
+        {
+            INFO("length " << length);
+            char* src = base + page - length - 1;
+            std::memset(src, 'y', length);
+            src[length] = '\0';
+            std::byte dst[256];
+            REQUIRE(kernel(dst, sizeof(dst), src) == length);
+            REQUIRE(std::memcmp(dst, src, length) == 0);
+        }
+    }
+
+    ::munmap(mem, page * 2);
+}